@@ -0,0 +1,163 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * For an explanation of Loop parallelism, please see for.cpp.
+ *
+ * Filters a vector with parallel_copy_if, partitions it in place with
+ * parallel_partition and removes the duplicates from a sorted copy of it
+ * with parallel_unique. The time taken by each is compared with that of a
+ * serial loop that does the same.
+ */
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/parallel_compact.hpp>
+
+/**
+ * Tells if a number is divisible by three.
+ */
+struct divisible_by_three {
+  bool operator() (const int value) const { return 0 == value%3; }
+};
+
+/**
+ * Define the PFunc instance. Note that we HAVE TO USE PFUNC::USE_DEFAULT as
+ * the type of the FUNCTOR because of the way in which the compaction
+ * algorithms are defined!
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::task task;
+typedef generator_type::taskmgr taskmgr;
+
+typedef std::vector<int>::iterator iterator;
+
+/**
+ * Runs one of the compaction algorithms as the root task.
+ * @param[in] global_taskmgr The task manager to use.
+ * @param[in] algorithm The algorithm to run.
+ * @return The time taken in seconds.
+ */
+static double run (taskmgr& global_taskmgr, pfunc::virtual_functor& algorithm) {
+  task root_task;
+  attribute root_attribute (false /*nested*/, false /*grouped*/);
+
+  double time = micro_time();
+  pfunc::spawn (global_taskmgr, root_task, root_attribute, algorithm);
+  pfunc::wait (global_taskmgr, root_task);
+  return micro_time() - time;
+}
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'n': How big a vector to work on.
+ * (2) 'blocksize': The number of elements in a block; 0 to use the default.
+ * (3) 'nqueues': The number of task queues to create
+ * (4) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (5 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./compact <n> <blocksize> <nqueues> <nthreads>"
+              << std::endl;
+    exit (3);
+  }
+
+  const size_t n = static_cast<size_t>(atoi(argv[1]));
+  const size_t blocksize = static_cast<size_t>(atoi(argv[2]));
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[3]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[4]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  // Create the input
+  std::vector<int> input (n);
+  for (size_t i=0; i<n; ++i) input[i] = rand ()%1000;
+  std::vector<int> sorted_input (input);
+  std::sort (sorted_input.begin(), sorted_input.end());
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+  const divisible_by_three pred = divisible_by_three ();
+
+  // copy_if
+  std::vector<int> serial_output (n);
+  double serial_time = micro_time();
+  iterator serial_end = serial_output.begin();
+  for (size_t i=0; i<n; ++i) if (pred (input[i])) *serial_end++ = input[i];
+  serial_time = micro_time() - serial_time;
+
+  std::vector<int> parallel_output (n);
+  pfunc::parallel_copy_if<generator_type, iterator, iterator,
+                          divisible_by_three>
+    root_copy_if (input.begin(), input.end(), parallel_output.begin(),
+                  pred, global_taskmgr, blocksize);
+  double parallel_time = run (global_taskmgr, root_copy_if);
+
+  bool correct = std::equal (serial_output.begin(), serial_end,
+                             parallel_output.begin()) &&
+    (serial_end-serial_output.begin()) ==
+    (root_copy_if.get_result()-parallel_output.begin());
+
+  std::cout << "Copying from " << n << " elements took " << serial_time
+            << " seconds with a loop and " << parallel_time
+            << " seconds with parallel_copy_if"
+            << (correct ? "" : " (WRONG ANSWER!)") << std::endl;
+
+  // partition in place: partition a copy back into the input
+  std::vector<int> serial_input (input);
+  serial_time = micro_time();
+  std::stable_partition (serial_input.begin(), serial_input.end(), pred);
+  serial_time = micro_time() - serial_time;
+
+  std::vector<int> scratch (input);
+  const size_t num_true = static_cast<size_t>(
+    root_copy_if.get_result()-parallel_output.begin());
+  pfunc::parallel_partition<generator_type, iterator, iterator, iterator,
+                            divisible_by_three>
+    root_partition (scratch.begin(), scratch.end(), input.begin(),
+                    input.begin()+num_true, pred, global_taskmgr, blocksize);
+  parallel_time = run (global_taskmgr, root_partition);
+
+  correct = (serial_input == input);
+
+  std::cout << "Partitioning " << n << " elements took " << serial_time
+            << " seconds with std::stable_partition and " << parallel_time
+            << " seconds with parallel_partition"
+            << (correct ? "" : " (WRONG ANSWER!)") << std::endl;
+
+  // unique
+  serial_time = micro_time();
+  serial_end = std::unique_copy (sorted_input.begin(), sorted_input.end(),
+                                 serial_output.begin());
+  serial_time = micro_time() - serial_time;
+
+  pfunc::parallel_unique<generator_type, iterator, iterator>
+    root_unique (sorted_input.begin(), sorted_input.end(),
+                 parallel_output.begin(), global_taskmgr,
+                 std::equal_to<int> (), blocksize);
+  parallel_time = run (global_taskmgr, root_unique);
+
+  correct = std::equal (serial_output.begin(), serial_end,
+                        parallel_output.begin()) &&
+    (serial_end-serial_output.begin()) ==
+    (root_unique.get_result()-parallel_output.begin());
+
+  std::cout << "Removing duplicates from " << n << " elements took "
+            << serial_time << " seconds with std::unique_copy and "
+            << parallel_time << " seconds with parallel_unique"
+            << (correct ? "" : " (WRONG ANSWER!)") << std::endl;
+
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
@@ -54,7 +54,19 @@
  * are overhead, which increases with increase in the depth of the tree. An
  * alternative is to split the iteration space into equal size chunks at the 
  * very beginning. In fact, this is the model used in MPI-style algorithms and
- * can be mimiced in PFunc using GROUP structures.
+ * can be mimiced in PFunc using GROUP structures. parallel_for can also do
+ * this directly when it is given one of the OpenMP-style loop schedules 
+ * (static, dynamic or guided) in place of the partitioner. This example times
+ * the recursive splitting against each of the loop schedules; the chunk size
+ * is used as the chunk size of the dynamic schedule and as the minimum chunk
+ * size of the guided schedule. It also times splitting the space 8 ways at a
+ * time (pfunc::basic_space_1D<8>), which makes the tree shallower, and
+ * splitting only at cache line boundaries, so that no two chunks write to 
+ * the same cache line.
+ *
+ * Finally, the vector is scaled twice with the same affinity_partitioner.
+ * The second loop hands each piece of the vector to the task queue that
+ * scaled it the first time, which is where the piece is likely to be cached.
  *
  * NOTE: Please see pfunc/ directory for space_1D and parallel_for
  */
@@ -86,7 +98,8 @@ struct vector_scale {
   /**
    * Operator that takes in a space and scales the vector in this space
    */
-  void operator() (const pfunc::space_1D& space) const {
+  template <typename SpaceType>
+  void operator() (const SpaceType& space) const {
     for (size_t i = space.begin(); i<space.end(); ++i) {
       my_vector[i] *= scaling_factor;
     }
@@ -123,6 +136,30 @@ static inline void print_vector (Iterator first, Iterator last) {
   std::cout.flags(original_flags);
 }
 
+/**
+ * Runs parallel_for over a space and times it.
+ * @param[in] global_taskmgr The task manager to run the loop on.
+ * @param[in] space The iteration space.
+ * @param[in] scale The function to execute over the space.
+ * @param[in] partitioner Decides how the space is split or handed out.
+ * @return The time taken in seconds.
+ */
+template <typename SpaceType, typename Partitioner>
+static double time_for (taskmgr& global_taskmgr, 
+                        const SpaceType& space,
+                        const vector_scale& scale,
+                        const Partitioner& partitioner) {
+  task root_task;
+  attribute root_attribute (false /*nested*/, false /*grouped*/);
+  pfunc::parallel_for<generator_type, vector_scale, SpaceType, Partitioner> 
+    root_for (space, scale, global_taskmgr, partitioner);
+
+  double time = micro_time();
+  pfunc::spawn (global_taskmgr, root_task, root_attribute, root_for);
+  pfunc::wait (global_taskmgr, root_task);
+  return micro_time() - time;
+}
+
 /**
  * Main harness. Takes in the following parameters:
  * (1) 'n': How big an array to create --- [0,n)
@@ -172,21 +209,50 @@ int main (int argc, char** argv) {
   // Initialize PFunc
   taskmgr global_taskmgr (nqueues, threads_per_queue_array);
 
-  // Spawn the root task
-  task root_task;
-  attribute root_attribute (false /*nested*/, false /*grouped*/);
-  pfunc::parallel_for<generator_type, vector_scale, pfunc::space_1D> 
-    root_for (pfunc::space_1D (0,n), 
-              vector_scale (my_vector, scaling_factor), 
-              global_taskmgr);
-
-  double time = micro_time();
-  pfunc::spawn (global_taskmgr, root_task, root_attribute, root_for);
-  pfunc::wait (global_taskmgr, root_task);
-  time = micro_time() - time;
+  // Scale the vector with each of the ways of handing out the space
+  const vector_scale scale (my_vector, scaling_factor);
+  const pfunc::space_1D space (0,n);
+  const double recursive_time = 
+    time_for (global_taskmgr, space, scale, pfunc::simple_partitioner ());
+  const double static_time = 
+    time_for (global_taskmgr, space, scale, pfunc::static_schedule ());
+  const double dynamic_time = 
+    time_for (global_taskmgr, space, scale, 
+              pfunc::dynamic_schedule (chunk_size));
+  const double guided_time = 
+    time_for (global_taskmgr, space, scale, 
+              pfunc::guided_schedule (chunk_size));
+  const double eight_way_time = 
+    time_for (global_taskmgr, pfunc::basic_space_1D<8> (0,n), scale, 
+              pfunc::simple_partitioner ());
+  const double aligned_time = 
+    time_for (global_taskmgr, 
+              pfunc::space_1D (0,n,pfunc::space_1D::granularity<double> ()), 
+              scale, 
+              pfunc::simple_partitioner ());
+  const pfunc::affinity_partitioner affinity;
+  const double first_affinity_time = 
+    time_for (global_taskmgr, space, scale, affinity);
+  const double second_affinity_time = 
+    time_for (global_taskmgr, space, scale, affinity);
 
   std::cout << "Scaling of " << n << " elements in " << chunk_size 
-            << " chunks took " << time << " seconds" << std::endl;
+            << " chunks took " << recursive_time << " seconds" << std::endl
+            << "Scaling of " << n << " elements in " << chunk_size 
+            << " chunks with 8-way splits took " << eight_way_time 
+            << " seconds" << std::endl
+            << "Scaling of " << n << " elements in " << chunk_size 
+            << " chunks split at cache line boundaries took " << aligned_time
+            << " seconds" << std::endl
+            << "Scaling of " << n << " elements with a static schedule took " 
+            << static_time << " seconds" << std::endl
+            << "Scaling of " << n << " elements with a dynamic schedule took " 
+            << dynamic_time << " seconds" << std::endl
+            << "Scaling of " << n << " elements with a guided schedule took " 
+            << guided_time << " seconds" << std::endl
+            << "Scaling of " << n << " elements with an affinity partitioner "
+            << "took " << first_affinity_time << " seconds the first time and "
+            << second_affinity_time << " seconds the second time" << std::endl;
 
   if (please_print) print_vector (my_vector.begin(), my_vector.end());
 
@@ -0,0 +1,141 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * Demonstrates futures. The vector is split into 'nchunks' chunks. For each
+ * chunk, the sum of the chunk is computed by a spawned task and the square
+ * root of the sum is computed by a continuation (then) of that task. Finally,
+ * all the square roots are collected together (when_all) and added up. The
+ * main thread waits only once, for the final value.
+ */
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/future.hpp>
+
+/**
+ * Computes the sum of a chunk of the vector.
+ */
+struct chunk_sum {
+  typedef double result_type;
+
+  private:
+  const std::vector<double>* my_vector;
+  size_t begin;
+  size_t end;
+
+  public:
+  chunk_sum (const std::vector<double>& my_vector,
+             const size_t begin,
+             const size_t end) : my_vector (&my_vector),
+                                 begin (begin),
+                                 end (end) {}
+
+  double operator() () const {
+    double sum = 0.0;
+    for (size_t i=begin; i<end; ++i) sum += (*my_vector)[i];
+    return sum;
+  }
+};
+
+/**
+ * Computes the square root of a value; used as a continuation.
+ */
+struct square_root {
+  typedef double result_type;
+
+  double operator() (const double& value) const { return sqrt (value); }
+};
+
+/**
+ * Adds up the values; used as a continuation of when_all.
+ */
+struct add_up {
+  typedef double result_type;
+
+  double operator() (const std::vector<double>& values) const {
+    double sum = 0.0;
+    for (size_t i=0; i<values.size (); ++i) sum += values[i];
+    return sum;
+  }
+};
+
+/**
+ * Define the PFunc instance. Note that we HAVE TO USE PFUNC::USE_DEFAULT as
+ * the type of the FUNCTOR because of the way in which pfunc::future is
+ * defined!
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::taskmgr taskmgr;
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'n': How big an array to create --- [0,n)
+ * (2) 'nchunks': Number of chunks to split the array into.
+ * (3) 'nqueues': The number of task queues to create
+ * (4) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (5 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./future <n> <nchunks> <nqueues> <nthreads>" << std::endl;
+    exit (3);
+  }
+
+  const size_t n = static_cast<size_t>(atoi(argv[1]));
+  const size_t nchunks = static_cast<size_t>(atoi(argv[2]));
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[3]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[4]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  // Create the vector
+  std::vector<double> my_vector (n);
+  for (size_t i=0; i<n; ++i) my_vector[i] = get_next_rand();
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+
+  // The main thread is not a PFunc thread; so, do not nest the tasks.
+  const attribute root_attribute (false /*nested*/, false /*grouped*/);
+
+  double time = micro_time();
+  std::vector<pfunc::future<double> > roots;
+  for (size_t i=0; i<nchunks; ++i) {
+    pfunc::future<double> sum =
+      pfunc::spawn (global_taskmgr,
+                    root_attribute,
+                    chunk_sum (my_vector, (i*n)/nchunks, ((i+1)*n)/nchunks));
+    roots.push_back (sum.then (square_root ()));
+  }
+  pfunc::future<double> total =
+    pfunc::when_all (roots.begin (), roots.end ()).then (add_up ());
+  const double parallel_total = total.get ();
+  time = micro_time() - time;
+
+  // Check the answer serially
+  double serial_total = 0.0;
+  for (size_t i=0; i<nchunks; ++i)
+    serial_total +=
+      square_root () (chunk_sum (my_vector,
+                                 (i*n)/nchunks,
+                                 ((i+1)*n)/nchunks) ());
+
+  std::cout << "Summing the square roots of " << nchunks << " chunks of "
+            << n << " elements took " << time << " seconds"
+            << ((fabs (parallel_total - serial_total) < 1e-6) ?
+                "" : " (WRONG ANSWER!)") << std::endl;
+
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
@@ -0,0 +1,194 @@
+/**
+ * Author: Prabhanjan Kambadur
+ *
+ * Runs the DAG in a DOT file as a task graph. Every vertex of the DAG does a
+ * fixed amount of (made up) work, and a vertex can only start once all the
+ * vertices that have an edge to it are done. pfunc::task_graph runs a vertex
+ * as soon as its last predecessor finishes, without any thread having to
+ * wait for it.
+ *
+ * The time taken by the task graph is compared with that of running the
+ * vertices serially in topological order, and the order in which the
+ * vertices were run is checked against the edges.
+ */
+
+#include <iostream>
+#include <vector>
+#include "dot_reader/dag.h"
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/pfunc_atomics.h>
+#include <pfunc/task_graph.hpp>
+
+/**< A global list of all the nodes */
+vertex_list_t HEAD = {NULL, NULL};
+
+/**< A count of the number of vertices added */
+int num_vertices = 0;
+
+/**< A count of the number of edges added */
+int num_edges = 0;
+
+/**< The order in which the vertices were run */
+static std::vector<int> finish_order;
+
+/**< The number of vertices run so far */
+static volatile int num_finished = 0;
+
+/**
+ * The work done at every vertex. Spins for 'work' iterations and then
+ * records when it finished.
+ */
+struct vertex_work {
+  private:
+  int id;
+  int work;
+
+  public:
+  vertex_work (const int id, const int work) : id (id), work (work) {}
+
+  void operator() () {
+    volatile double dummy = 0.0;
+    for (int i=0; i<work; ++i) dummy += static_cast<double>(i);
+    finish_order[id] = pfunc_fetch_and_add_32 (&num_finished, 1);
+  }
+};
+
+/**
+ * Define the PFunc instance. Note that we HAVE TO USE PFUNC::USE_DEFAULT as
+ * the type of the FUNCTOR because of the way in which pfunc::task_graph is
+ * defined!
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::taskmgr taskmgr;
+typedef pfunc::task_graph<generator_type, vertex_work> graph_type;
+
+/**
+ * Checks that every edge was respected during the run.
+ * @return true if every vertex finished after all its predecessors.
+ */
+static bool check_order () {
+  if (num_finished != num_vertices) return false;
+  struct vertex_list_t* vertex_iterator = &HEAD;
+  while (NULL != vertex_iterator) {
+    if (NULL != vertex_iterator->data) {
+      struct vertex_t* source = vertex_iterator->data;
+      struct edge_t* edge_iterator = get_first_edge (source);
+      while (NULL != edge_iterator) {
+        if (finish_order[source->id] >=
+            finish_order[edge_iterator->destination->id]) return false;
+        edge_iterator = edge_iterator->next;
+      }
+    }
+    vertex_iterator = vertex_iterator->next;
+  }
+  return true;
+}
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'filename': Name of the file containing the DOT file. The vertices
+ *                 have to be numbered 0 through n.
+ * (2) 'work': The number of iterations of work done at each vertex.
+ * (3) 'nqueues': The number of task queues to create
+ * (4) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (5 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./graph <filename> <work> <nqueues> <nthreads>"
+              << std::endl;
+    exit (3);
+  }
+
+  const char* filename = argv[1];
+  const int work = atoi (argv[2]);
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[3]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[4]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  // Create the dag from the file
+  fclose (stdin);
+  if (NULL == (stdin = fopen (filename, "r"))) {
+    std::cout << "Could not open " << filename << " for reading" << std::endl;
+    exit (3);
+  }
+  yyparse ();
+
+  // Create the task graph; vertex i is node i.
+  graph_type graph;
+  graph.reserve (num_vertices, num_edges);
+  for (int i=0; i<num_vertices; ++i) graph.add_node (vertex_work (i, work));
+
+  struct vertex_list_t* vertex_iterator = &HEAD;
+  while (NULL != vertex_iterator) {
+    if (NULL != vertex_iterator->data) {
+      struct vertex_t* source = vertex_iterator->data;
+      struct edge_t* edge_iterator = get_first_edge (source);
+      while (NULL != edge_iterator) {
+        graph.add_edge (source->id, edge_iterator->destination->id);
+        edge_iterator = edge_iterator->next;
+      }
+    }
+    vertex_iterator = vertex_iterator->next;
+  }
+  finish_order.resize (num_vertices);
+
+  // Run the vertices serially in topological order (Kahn's algorithm).
+  std::vector<int> in_degree (num_vertices);
+  std::vector<vertex_t*> ready;
+  vertex_iterator = &HEAD;
+  while (NULL != vertex_iterator) {
+    if (NULL != vertex_iterator->data) {
+      in_degree[vertex_iterator->data->id] = vertex_iterator->data->in_degree;
+      if (0 == vertex_iterator->data->in_degree)
+        ready.push_back (vertex_iterator->data);
+    }
+    vertex_iterator = vertex_iterator->next;
+  }
+
+  double serial_time = micro_time ();
+  while (!ready.empty ()) {
+    vertex_t* vertex = ready.back ();
+    ready.pop_back ();
+    vertex_work (vertex->id, work) ();
+    struct edge_t* edge_iterator = get_first_edge (vertex);
+    while (NULL != edge_iterator) {
+      if (0 == --in_degree[edge_iterator->destination->id])
+        ready.push_back (edge_iterator->destination);
+      edge_iterator = edge_iterator->next;
+    }
+  }
+  serial_time = micro_time () - serial_time;
+  const bool serial_correct = check_order ();
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+
+  // Run the task graph
+  num_finished = 0;
+  double graph_time = micro_time ();
+  const bool graph_ran = graph.run (global_taskmgr);
+  graph_time = micro_time () - graph_time;
+  const bool graph_correct = graph_ran && check_order ();
+
+  std::cout << "Ran " << num_vertices << " vertices and " << num_edges
+            << " edges serially in " << serial_time << " seconds"
+            << (serial_correct ? "" : " (WRONG ORDER!)") << std::endl
+            << "Ran " << num_vertices << " vertices and " << num_edges
+            << " edges as a task graph in " << graph_time << " seconds"
+            << (graph_correct ? "" : " (WRONG ORDER!)") << std::endl;
+
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * For an explanation of Loop parallelism, please see for.cpp.
+ *
+ * Demonstrates enumerable_thread_specific. A histogram of 'n' pseudo-random
+ * numbers is built with parallel_for; every thread counts into a histogram
+ * of its own, which is constructed the first time the thread needs it, and
+ * the histograms are added up once the loop is done. No locks are taken
+ * and no two threads write to the same cache line.
+ */
+#include <iostream>
+#include <vector>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/space_1D.hpp>
+#include <pfunc/parallel_for.hpp>
+#include <pfunc/enumerable_thread_specific.hpp>
+
+typedef std::vector<size_t> histogram;
+typedef pfunc::enumerable_thread_specific<histogram> thread_histograms;
+
+/**
+ * @return The bin of the number i.
+ */
+static size_t bin_of (const size_t i, const size_t nbins) {
+  return static_cast<size_t>((i*2654435761UL) % 1000003) % nbins;
+}
+
+/**
+ * Counts the numbers of a range into the histogram of the calling thread.
+ */
+struct count_bins {
+  private:
+  thread_histograms* histograms;
+  size_t nbins;
+
+  public:
+  count_bins (thread_histograms& histograms, const size_t nbins) :
+    histograms (&histograms), nbins (nbins) {}
+
+  void operator() (const pfunc::space_1D& space) const {
+    histogram& my_histogram = histograms->local ();
+    for (size_t i=space.begin(); i<space.end(); ++i)
+      ++my_histogram[bin_of (i, nbins)];
+  }
+};
+
+/**
+ * Adds up two histograms.
+ */
+struct add_histograms {
+  histogram operator() (const histogram& left, const histogram& right) const {
+    histogram sum (left);
+    for (size_t i=0; i<sum.size(); ++i) sum[i] += right[i];
+    return sum;
+  }
+};
+
+/**
+ * Define the PFunc instance. Note that we HAVE TO USE PFUNC::USE_DEFAULT as
+ * the type of the FUNCTOR because of the way in which pfunc::parallel_for
+ * is defined!
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::task task;
+typedef generator_type::taskmgr taskmgr;
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'n': How many numbers to count.
+ * (2) 'nbins': The number of bins in the histogram.
+ * (3) 'chunksize': The number of numbers below which we do not split.
+ * (4) 'nqueues': The number of task queues to create
+ * (5) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (6 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./histogram <n> <nbins> <chunksize> <nqueues> <nthreads>"
+              << std::endl;
+    exit (3);
+  }
+
+  const size_t n = static_cast<size_t>(atoi(argv[1]));
+  const size_t nbins = static_cast<size_t>(atoi(argv[2]));
+  const size_t chunksize = static_cast<size_t>(atoi(argv[3]));
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[4]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[5]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  if (0 == nbins || 0 == chunksize) {
+    std::cout << "Please choose nbins and chunksize >= 1" << std::endl;
+    exit (3);
+  }
+
+  // Count serially
+  histogram serial_histogram (nbins, 0);
+  for (size_t i=0; i<n; ++i) ++serial_histogram[bin_of (i, nbins)];
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+  pfunc::space_1D::base_case_size = chunksize;
+
+  // Every thread starts with an empty histogram
+  thread_histograms histograms (global_taskmgr, histogram (nbins, 0));
+  count_bins counter (histograms, nbins);
+
+  task root_task;
+  attribute root_attribute (false /*nested*/, false /*grouped*/);
+  pfunc::parallel_for<generator_type, count_bins, pfunc::space_1D>
+    root_for (pfunc::space_1D (0, n), counter, global_taskmgr);
+
+  double time = micro_time();
+  pfunc::spawn (global_taskmgr, root_task, root_attribute, root_for);
+  pfunc::wait (global_taskmgr, root_task);
+  const histogram parallel_histogram = histograms.combine (add_histograms ());
+  time = micro_time() - time;
+
+  std::cout << "Counting " << n << " numbers into " << nbins << " bins took "
+            << time << " seconds with " << histograms.size ()
+            << " per-thread histograms"
+            << ((serial_histogram == parallel_histogram) ?
+                "" : " (WRONG ANSWER!)") << std::endl;
+
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
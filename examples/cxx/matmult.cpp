@@ -23,16 +23,9 @@
  * as they write to independent locations. That is, we compute C in the 
  * following manner:
  *
- * spawn C11 = B11*A11 
- * spawn C21 = B21*A12 
- * spawn C12 = B12*A11 
- * spawn C22 = B12*A21 
- * sync
- * spawn C11 += B21*A12
- * spawn C21 += B21*A22
- * spawn C12 += B22*A12
- * spawn C22 += B22*A22
- * sync 
+ * parallel_invoke (C11 = B11*A11, C21 = B21*A12, C12 = B12*A11, C22 = B12*A21)
+ * parallel_invoke (C11 += B21*A12, C21 += B21*A22, C12 += B22*A12, 
+ *                  C22 += B22*A22)
  *
  * Matrix representation:
  * The matrix is represented in ROW-MAJOR format. That is, 
@@ -42,7 +35,8 @@
  * Recursion is ended when we reach small enough matrices that we can multiply
  * them without further division. Ideally, this is done when A, B, and C can
  * fit into cache. The base case multiplication is done here using the 3-loop
- * formula, but can be replaced by DGEMM kernel as well.
+ * formula, but can be replaced by DGEMM kernel as well (perf_tests/dgemm.cpp
+ * does this with packed panels and a SIMD micro-kernel).
  * 
  * Optimization:
  * As this example is meant for demonstration purposes only, we will only deal 
@@ -65,6 +59,7 @@
 #include <vector>
 #include <pfunc/pfunc.hpp>
 #include <pfunc/utility.h>
+#include <pfunc/parallel_invoke.hpp>
 
 /**
  * First, let us get the definition of the PFunc instance.
@@ -280,29 +275,13 @@ struct dgemm_op {
       dgemm_op q4_op_1 (q3_A, q2_B, q4_C);
       dgemm_op q4_op_2 (q4_A, q4_B, q4_C);
 
-      // Create the task objects
-      task q1_task;
-      task q2_task;
-      task q3_task;
-      // we will execute Q4 ourselves -- no need for a task
+      // Run the first four products in parallel (we execute Q4 ourselves)
+      pfunc::global::parallel_invoke<generator_type> (q1_op_1, q2_op_1,
+                                                      q3_op_1, q4_op_1);
 
-      // spawn the first four tasks
-      pfunc::global::spawn (q1_task, q1_op_1);
-      pfunc::global::spawn (q2_task, q2_op_1);
-      pfunc::global::spawn (q3_task, q3_op_1);
-      q4_op_1();
-      pfunc::global::wait (q1_task);
-      pfunc::global::wait (q2_task);
-      pfunc::global::wait (q3_task);
-
-      // spawn the next four tasks
-      pfunc::global::spawn (q1_task, q1_op_2);
-      pfunc::global::spawn (q2_task, q2_op_2);
-      pfunc::global::spawn (q3_task, q3_op_2);
-      q4_op_2();
-      pfunc::global::wait (q1_task);
-      pfunc::global::wait (q2_task);
-      pfunc::global::wait (q3_task);
+      // Run the next four products in parallel
+      pfunc::global::parallel_invoke<generator_type> (q1_op_2, q2_op_2,
+                                                      q3_op_2, q4_op_2);
     }
   }
 };
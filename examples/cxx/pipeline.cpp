@@ -0,0 +1,168 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * Runs a stream of numbers through a three stage parallel_pipeline: the
+ * first stage parses the numbers out of a string stream, the second works
+ * out how many steps each number takes to reach 1 in the Collatz sequence
+ * and the third writes out the results in the order of the input. The time
+ * taken is compared with that of a serial loop that does the same.
+ */
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/parallel_pipeline.hpp>
+
+/**
+ * An item that goes through the pipeline.
+ */
+struct item {
+  unsigned long number; /**< The number parsed */
+  unsigned long steps; /**< The number of steps it takes to reach 1 */
+};
+
+/**
+ * Works out the number of steps that a number takes to reach 1.
+ * @param[in] number The number to start from.
+ * @return The number of steps.
+ */
+static unsigned long collatz_steps (unsigned long number) {
+  unsigned long steps = 0;
+  for (; 1 < number; ++steps)
+    number = (0 == number%2) ? (number/2) : (3*number+1);
+  return steps;
+}
+
+/**
+ * Parses the numbers; this is the input of the pipeline.
+ */
+struct parse_filter : public pfunc::pipeline_filter {
+  std::istream& input;
+
+  parse_filter (std::istream& input) :
+    pfunc::pipeline_filter (serial_in_order), input (input) {}
+
+  void* operator() (void*) {
+    unsigned long number;
+    if (!(input >> number)) return NULL;
+    item* new_item = new item;
+    new_item->number = number;
+    return new_item;
+  }
+};
+
+/**
+ * Works out the number of steps for each item.
+ */
+struct collatz_filter : public pfunc::pipeline_filter {
+  collatz_filter () : pfunc::pipeline_filter (parallel) {}
+
+  void* operator() (void* current) {
+    item* current_item = static_cast<item*>(current);
+    current_item->steps = collatz_steps (current_item->number);
+    return current_item;
+  }
+};
+
+/**
+ * Writes out the results in order.
+ */
+struct write_filter : public pfunc::pipeline_filter {
+  std::vector<unsigned long>& output;
+
+  write_filter (std::vector<unsigned long>& output) :
+    pfunc::pipeline_filter (serial_in_order), output (output) {}
+
+  void* operator() (void* current) {
+    item* current_item = static_cast<item*>(current);
+    output.push_back (current_item->steps);
+    delete current_item;
+    return NULL;
+  }
+};
+
+/**
+ * Define the PFunc instance. Note that we HAVE TO USE PFUNC::USE_DEFAULT as
+ * the type of the FUNCTOR because of the way in which pfunc::parallel_pipeline
+ * is defined!
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::task task;
+typedef generator_type::taskmgr taskmgr;
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'n': How many numbers to stream.
+ * (2) 'ntokens': The maximum number of items in flight.
+ * (3) 'nqueues': The number of task queues to create
+ * (4) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (5 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./pipeline <n> <ntokens> <nqueues> <nthreads>"
+              << std::endl;
+    exit (3);
+  }
+
+  const size_t n = static_cast<size_t>(atoi(argv[1]));
+  const size_t ntokens = static_cast<size_t>(atoi(argv[2]));
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[3]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[4]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  // Create the input
+  std::ostringstream input_text;
+  for (size_t i=0; i<n; ++i) input_text << (rand()%1000000 + 1) << " ";
+
+  // Serial baseline
+  std::istringstream serial_input (input_text.str ());
+  std::vector<unsigned long> serial_output;
+  double serial_time = micro_time();
+  unsigned long number;
+  while (serial_input >> number)
+    serial_output.push_back (collatz_steps (number));
+  serial_time = micro_time() - serial_time;
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+
+  std::istringstream parallel_input (input_text.str ());
+  std::vector<unsigned long> parallel_output;
+  parse_filter parse (parallel_input);
+  collatz_filter collatz;
+  write_filter write (parallel_output);
+
+  pfunc::parallel_pipeline<generator_type> root_pipeline (global_taskmgr,
+                                                          ntokens);
+  root_pipeline.add_filter (parse);
+  root_pipeline.add_filter (collatz);
+  root_pipeline.add_filter (write);
+
+  task root_task;
+  attribute root_attribute (false /*nested*/, false /*grouped*/);
+  double parallel_time = micro_time();
+  pfunc::spawn (global_taskmgr, root_task, root_attribute, root_pipeline);
+  pfunc::wait (global_taskmgr, root_task);
+  parallel_time = micro_time() - parallel_time;
+
+  std::cout << "Streaming " << n << " numbers took " << serial_time
+            << " seconds with a loop and " << parallel_time
+            << " seconds with parallel_pipeline"
+            << ((serial_output == parallel_output) ? "" : " (WRONG ANSWER!)")
+            << std::endl;
+
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
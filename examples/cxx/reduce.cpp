@@ -2,15 +2,23 @@
  * @author Prabhanjan Kambadur
  * 
  * For an explanation of Loop parallelism, please see for.cpp.
+ *
+ * parallel_reduce only splits the function object when a subspace is stolen
+ * by another thread; the number of splits is printed along with the times.
  */
 #include <iostream>
 #include <cassert>
+#include <cmath>
 #include <vector>
 #include <pfunc/pfunc.hpp>
 #include <pfunc/utility.h>
+#include <pfunc/pfunc_atomics.h>
 #include <pfunc/space_1D.hpp>
 #include <pfunc/parallel_reduce.hpp>
 
+/**< Number of times that an accumulate was split */
+static volatile int num_splits = 0;
+
 /**
  * A scaling operator for a vector.
  */
@@ -39,7 +47,10 @@ struct accumulate {
    * Split --- create a functor that is properly initialized.
    * @return A functor that is correctly initialized.
    */
-  accumulate split () const { return accumulate (my_vector, 0.0); }
+  accumulate split () const { 
+    pfunc_fetch_and_add_32 (&num_splits, 1);
+    return accumulate (my_vector, 0.0); 
+  }
 
   /**
    * Join from a previous iterator.
@@ -51,15 +62,6 @@ struct accumulate {
    * @return The sum of elements accumulated by this functor.
    */
   double get_sum () const { return sum; }
-
-  /**
-   * Assignable --- need it to make accumulate work with std::vector.
-   * @param[in] other The other functor from which we need to assign.
-   */
-  accumulate& operator= (const accumulate& other) { 
-    my_vector = other.my_vector;
-    sum = other.sum;
-  }
 };
 
 /**
@@ -150,7 +152,31 @@ int main (int argc, char** argv) {
   time = micro_time() - time;
 
   std::cout << "Accumulating " << n << " elements in " << chunk_size 
-            << " chunks took " << time << " seconds" << std::endl;
+            << " chunks took " << time << " seconds (" << num_splits 
+            << " splits)" << std::endl;
+  num_splits = 0;
+
+  // Do it again, but only split as far as is needed to keep threads busy
+  accumulate auto_accumulate (my_vector, 0.0);
+  pfunc::parallel_reduce<generator_type, 
+                         accumulate, 
+                         pfunc::space_1D, 
+                         pfunc::auto_partitioner> 
+  auto_reduce (pfunc::space_1D (0,n), 
+               auto_accumulate, 
+               global_taskmgr, 
+               pfunc::auto_partitioner ());
+
+  double auto_time = micro_time();
+  pfunc::spawn (global_taskmgr, root_task, root_attribute, auto_reduce);
+  pfunc::wait (global_taskmgr, root_task);
+  auto_time = micro_time() - auto_time;
+
+  std::cout << "Accumulating " << n << " elements with auto_partitioner took "
+            << auto_time << " seconds (" << num_splits << " splits)" 
+            << ((fabs (auto_accumulate.get_sum () - root_accumulate.get_sum ())
+                 < 1e-6*fabs (root_accumulate.get_sum ())) ? 
+                "" : " (WRONG ANSWER!)") << std::endl;
 
   if (please_print) {
     print_vector (my_vector.begin(), my_vector.end());
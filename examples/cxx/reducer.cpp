@@ -0,0 +1,187 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * Demonstrates reducers. A range of numbers is split recursively into two
+ * halves; the first half is spawned and the second half is run by the
+ * spawning task itself. The leaves add up the values of the numbers, keep
+ * the smallest and the largest values, append the numbers that are
+ * multiples of 'stride' to a list and write them out to a stream. None of
+ * the tasks take a lock, and the list and the text come out in the same
+ * order as they would if the program was run serially.
+ */
+#include <iostream>
+#include <sstream>
+#include <list>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/reducer.hpp>
+
+/**
+ * Define the PFunc instance.
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::task task;
+typedef generator_type::taskmgr taskmgr;
+
+/**
+ * @return A pseudo-random value for the number i.
+ */
+static long value_of (const size_t i) {
+  return static_cast<long>((i*2654435761UL) % 1000003);
+}
+
+/**
+ * The reducers that the leaves update.
+ */
+struct results {
+  pfunc::reducer_sum<long> sum;
+  pfunc::reducer_min<long> min;
+  pfunc::reducer_max<long> max;
+  pfunc::reducer_list_append<size_t> multiples;
+  pfunc::reducer_ostream text;
+
+  /**
+   * @param[in,out] global_taskmgr The task manager of the tasks.
+   * @param[out] stream The stream to write the multiples to.
+   */
+  results (taskmgr& global_taskmgr, std::ostream& stream) :
+    sum (global_taskmgr),
+    min (global_taskmgr, value_of (0)),
+    max (global_taskmgr, value_of (0)),
+    multiples (global_taskmgr),
+    text (global_taskmgr, stream) {}
+};
+
+/**
+ * Splits [begin, end) till it has at most 'grain' numbers.
+ */
+struct range_walk : public pfunc::virtual_functor {
+  private:
+  taskmgr& global_taskmgr;
+  results& result;
+  size_t begin;
+  size_t end;
+  size_t grain;
+  size_t stride;
+
+  public:
+  range_walk (taskmgr& global_taskmgr, results& result,
+              const size_t begin, const size_t end,
+              const size_t grain, const size_t stride) :
+    global_taskmgr (global_taskmgr), result (result),
+    begin (begin), end (end), grain (grain), stride (stride) {}
+
+  void operator() (void) {
+    if (end-begin <= grain) {
+      for (size_t i=begin; i<end; ++i) {
+        const long value = value_of (i);
+        result.sum += value;
+        result.min.calc_min (value);
+        result.max.calc_max (value);
+        if (0 == i%stride) {
+          result.multiples.push_back (i);
+          result.text << i << " ";
+        }
+      }
+    } else {
+      const size_t middle = begin + (end-begin)/2;
+      task first_task;
+      attribute first_attribute;
+      range_walk first_half (global_taskmgr, result,
+                             begin, middle, grain, stride);
+      range_walk second_half (global_taskmgr, result,
+                              middle, end, grain, stride);
+
+      pfunc::spawn (global_taskmgr, first_task, first_attribute, first_half);
+      second_half ();
+      pfunc::wait (global_taskmgr, first_task);
+    }
+  }
+};
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'n': How many numbers to go over.
+ * (2) 'grain': The number of numbers below which we do not split.
+ * (3) 'stride': Numbers that are multiples of stride are collected.
+ * (4) 'nqueues': The number of task queues to create
+ * (5) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (6 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./reducer <n> <grain> <stride> <nqueues> <nthreads>"
+              << std::endl;
+    exit (3);
+  }
+
+  const size_t n = static_cast<size_t>(atoi(argv[1]));
+  const size_t grain = static_cast<size_t>(atoi(argv[2]));
+  const size_t stride = static_cast<size_t>(atoi(argv[3]));
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[4]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[5]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  if (0 == n || 0 == grain || 0 == stride) {
+    std::cout << "Please choose n, grain and stride >= 1" << std::endl;
+    exit (3);
+  }
+
+  // Compute the answers serially
+  long serial_sum = 0;
+  long serial_min = value_of (0);
+  long serial_max = value_of (0);
+  std::list<size_t> serial_multiples;
+  std::ostringstream serial_text;
+  for (size_t i=0; i<n; ++i) {
+    const long value = value_of (i);
+    serial_sum += value;
+    if (value < serial_min) serial_min = value;
+    if (value > serial_max) serial_max = value;
+    if (0 == i%stride) {
+      serial_multiples.push_back (i);
+      serial_text << i << " ";
+    }
+  }
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+
+  // Create the reducers before spawning the tasks that update them
+  std::ostringstream parallel_text;
+  results result (global_taskmgr, parallel_text);
+
+  task root_task;
+  attribute root_attribute (false /*nested*/, false /*grouped*/);
+  range_walk root_walk (global_taskmgr, result, 0, n, grain, stride);
+
+  double time = micro_time();
+  pfunc::spawn (global_taskmgr, root_task, root_attribute, root_walk);
+  pfunc::wait (global_taskmgr, root_task);
+  result.text.flush ();
+  time = micro_time() - time;
+
+  const bool correct = (serial_sum == result.sum.get_value () &&
+                        serial_min == result.min.get_value () &&
+                        serial_max == result.max.get_value () &&
+                        serial_multiples == result.multiples.get_value () &&
+                        serial_text.str () == parallel_text.str ());
+
+  std::cout << "Going over " << n << " numbers took " << time << " seconds; "
+            << result.multiples.get_value ().size () << " multiples of "
+            << stride << " were collected"
+            << (correct ? "" : " (WRONG ANSWER!)") << std::endl;
+
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
@@ -0,0 +1,192 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * Demonstrates capturing and replaying the tasks of an iterative solver.
+ * Every iteration of a Jacobi-style smoother splits the vector into 'nchunks'
+ * chunks, spawns one task per chunk to compute the new values of the chunk
+ * and waits for all of them. The iterations only differ in which of the two
+ * vectors is read and which is written.
+ *
+ * The smoother is run twice: once by spawning the tasks afresh in every
+ * iteration, and once by capturing the tasks of the first iteration with
+ * pfunc::task_recording and replaying them for the other iterations. Since
+ * the function objects are held on to by the recording, the vectors are
+ * swapped between iterations by binding the chunks to the other vector.
+ */
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/task_recording.hpp>
+
+/**
+ * Computes the new values of a chunk of the vector from the old values.
+ */
+struct smooth_chunk : public pfunc::virtual_functor {
+  private:
+  const std::vector<double>* source;
+  std::vector<double>* target;
+  size_t begin;
+  size_t end;
+
+  public:
+  smooth_chunk () : source (NULL), target (NULL), begin (0), end (0) {}
+
+  smooth_chunk (const size_t begin, const size_t end) : source (NULL),
+                                                        target (NULL),
+                                                        begin (begin),
+                                                        end (end) {}
+
+  /**
+   * Sets the vectors for the next iteration.
+   * @param[in] new_source The values of the previous iteration.
+   * @param[out] new_target The values of the next iteration.
+   */
+  void bind (const std::vector<double>& new_source,
+             std::vector<double>& new_target) {
+    source = &new_source;
+    target = &new_target;
+  }
+
+  void operator() (void) {
+    const size_t n = source->size ();
+    for (size_t i=begin; i<end; ++i) {
+      const double left = (0==i) ? 0.0 : (*source)[i-1];
+      const double right = (n-1==i) ? 0.0 : (*source)[i+1];
+      (*target)[i] = 0.5*(*source)[i] + 0.25*(left + right);
+    }
+  }
+};
+
+/**
+ * Define the PFunc instance. Note that we HAVE TO USE PFUNC::USE_DEFAULT as
+ * the type of the FUNCTOR because of the way in which pfunc::task_recording
+ * is defined!
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::task task;
+typedef generator_type::taskmgr taskmgr;
+
+/**
+ * Runs one iteration by spawning a task per chunk and waiting on all of
+ * them. The tasks and the chunks are created afresh for every iteration.
+ */
+static void spawn_iteration (taskmgr& global_taskmgr,
+                             const attribute& chunk_attribute,
+                             const std::vector<double>& source,
+                             std::vector<double>& target,
+                             const size_t nchunks) {
+  const size_t n = source.size ();
+  task* chunk_tasks = new task [nchunks];
+  smooth_chunk* chunks = new smooth_chunk [nchunks];
+  for (size_t i=0; i<nchunks; ++i) {
+    chunks[i] = smooth_chunk ((i*n)/nchunks, ((i+1)*n)/nchunks);
+    chunks[i].bind (source, target);
+    pfunc::spawn (global_taskmgr, chunk_tasks[i], chunk_attribute, chunks[i]);
+  }
+  pfunc::wait_all (global_taskmgr, chunk_tasks, chunk_tasks+nchunks);
+  delete [] chunks;
+  delete [] chunk_tasks;
+}
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'n': How big a vector to smooth.
+ * (2) 'nchunks': Number of chunks (tasks) per iteration.
+ * (3) 'niterations': Number of iterations.
+ * (4) 'nqueues': The number of task queues to create
+ * (5) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (6 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./replay <n> <nchunks> <niterations> <nqueues> <nthreads>"
+              << std::endl;
+    exit (3);
+  }
+
+  const size_t n = static_cast<size_t>(atoi(argv[1]));
+  const size_t nchunks = static_cast<size_t>(atoi(argv[2]));
+  const int niterations = atoi(argv[3]);
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[4]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[5]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  // Create the vectors
+  std::vector<double> initial (n);
+  for (size_t i=0; i<n; ++i) initial[i] = get_next_rand();
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+
+  // The main thread is not a PFunc thread; so, do not nest the tasks.
+  const attribute chunk_attribute (false /*nested*/, false /*grouped*/);
+
+  // Spawn afresh in every iteration
+  std::vector<double> spawn_even (initial);
+  std::vector<double> spawn_odd (n);
+  double spawn_time = micro_time();
+  for (int i=0; i<niterations; ++i) {
+    if (0==i%2) spawn_iteration (global_taskmgr, chunk_attribute,
+                                 spawn_even, spawn_odd, nchunks);
+    else spawn_iteration (global_taskmgr, chunk_attribute,
+                          spawn_odd, spawn_even, nchunks);
+  }
+  spawn_time = micro_time() - spawn_time;
+
+  // Capture the first iteration and replay the rest
+  std::vector<double> replay_even (initial);
+  std::vector<double> replay_odd (n);
+  std::vector<smooth_chunk> chunks (nchunks);
+  task* chunk_tasks = new task [nchunks];
+  pfunc::task_recording<generator_type> iteration;
+
+  double replay_time = micro_time();
+  for (size_t i=0; i<nchunks; ++i) {
+    chunks[i] = smooth_chunk ((i*n)/nchunks, ((i+1)*n)/nchunks);
+    chunks[i].bind (replay_even, replay_odd);
+  }
+  iteration.begin_capture (global_taskmgr);
+  for (size_t i=0; i<nchunks; ++i)
+    pfunc::spawn (global_taskmgr, chunk_tasks[i], chunk_attribute, chunks[i]);
+  pfunc::wait_all (global_taskmgr, chunk_tasks, chunk_tasks+nchunks);
+  iteration.end_capture ();
+
+  for (int i=1; i<niterations; ++i) {
+    for (size_t j=0; j<nchunks; ++j) {
+      if (0==i%2) chunks[j].bind (replay_even, replay_odd);
+      else chunks[j].bind (replay_odd, replay_even);
+    }
+    iteration.replay (true /*same placement*/);
+  }
+  replay_time = micro_time() - replay_time;
+
+  // Both should have ended up with the same values
+  const std::vector<double>& spawn_result =
+    (0==niterations%2) ? spawn_even : spawn_odd;
+  const std::vector<double>& replay_result =
+    (0==niterations%2) ? replay_even : replay_odd;
+  bool correct = true;
+  for (size_t i=0; i<n; ++i)
+    if (fabs (spawn_result[i]-replay_result[i]) > 1e-12) correct = false;
+
+  std::cout << niterations << " iterations of " << nchunks << " tasks took "
+            << spawn_time << " seconds when spawned afresh and "
+            << replay_time << " seconds when replayed"
+            << (correct ? "" : " (WRONG ANSWER!)") << std::endl;
+
+  delete [] chunk_tasks;
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * For an explanation of Loop parallelism, please see for.cpp.
+ *
+ * Computes the prefix sums of a vector with parallel_scan and compares the
+ * time taken with that of std::partial_sum. The scan makes two passes over
+ * the elements when there is more than one thread; so, it only pays off
+ * with a few threads.
+ */
+#include <iostream>
+#include <vector>
+#include <numeric>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/space_1D.hpp>
+#include <pfunc/parallel_scan.hpp>
+
+/**
+ * Computes the running sum of a vector. This is a model of the
+ * ScanExecutable concept.
+ */
+struct prefix_sum {
+  private:
+  const std::vector<long>* input;
+  std::vector<long>* output;
+  long sum;
+
+  public:
+  /**
+   * Constructor
+   * @param[in] input The values to add up.
+   * @param[out] output The running sums.
+   */
+  prefix_sum (const std::vector<long>& input, std::vector<long>& output) :
+    input (&input), output (&output), sum (0) {}
+
+  /**
+   * Adds up a range of the vector; the running sums are written out only
+   * in the final scan.
+   */
+  template <typename ScanTag>
+  void operator() (const pfunc::space_1D& space, ScanTag) {
+    long running_sum = sum;
+    for (size_t i=space.begin(); i<space.end(); ++i) {
+      running_sum += (*input)[i];
+      if (ScanTag::is_final_scan ()) (*output)[i] = running_sum;
+    }
+    sum = running_sum;
+  }
+
+  /**
+   * Split --- create a functor that starts from 0.
+   * @return A functor that is correctly initialized.
+   */
+  prefix_sum split () const { return prefix_sum (*input, *output); }
+
+  /**
+   * @param[in] left The functor that covers the range before ours.
+   */
+  void reverse_join (const prefix_sum& left) { sum = left.sum + sum; }
+
+  /**
+   * @param[in] other The functor whose sum we take over.
+   */
+  void assign (const prefix_sum& other) { sum = other.sum; }
+
+  /**
+   * @return The sum accumulated.
+   */
+  long get_sum () const { return sum; }
+};
+
+/**
+ * Define the PFunc instance. Note that we HAVE TO USE PFUNC::USE_DEFAULT as
+ * the type of the FUNCTOR because of the way in which pfunc::parallel_scan
+ * is defined!
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::task task;
+typedef generator_type::taskmgr taskmgr;
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'n': How big a vector to scan.
+ * (2) 'chunksize': The number of elements below which we do not split.
+ * (3) 'nqueues': The number of task queues to create
+ * (4) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (5 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./scan <n> <chunksize> <nqueues> <nthreads>"
+              << std::endl;
+    exit (3);
+  }
+
+  const size_t n = static_cast<size_t>(atoi(argv[1]));
+  const size_t chunksize = static_cast<size_t>(atoi(argv[2]));
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[3]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[4]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  // Create the input
+  std::vector<long> input (n);
+  for (size_t i=0; i<n; ++i) input[i] = static_cast<long>(i%1000) - 500;
+
+  // Serial baseline
+  std::vector<long> serial_output (n);
+  double serial_time = micro_time();
+  std::partial_sum (input.begin(), input.end(), serial_output.begin());
+  serial_time = micro_time() - serial_time;
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+  pfunc::space_1D::base_case_size = chunksize;
+
+  std::vector<long> parallel_output (n);
+  prefix_sum root_sum (input, parallel_output);
+  task root_task;
+  attribute root_attribute (false /*nested*/, false /*grouped*/);
+  pfunc::parallel_scan<generator_type, prefix_sum, pfunc::space_1D>
+    root_scan (pfunc::space_1D (0, n), root_sum, global_taskmgr);
+
+  double parallel_time = micro_time();
+  pfunc::spawn (global_taskmgr, root_task, root_attribute, root_scan);
+  pfunc::wait (global_taskmgr, root_task);
+  parallel_time = micro_time() - parallel_time;
+
+  const bool correct = (serial_output == parallel_output &&
+                        (0 == n || serial_output[n-1] == root_sum.get_sum ()));
+
+  std::cout << "Scanning " << n << " elements took " << serial_time
+            << " seconds with std::partial_sum and " << parallel_time
+            << " seconds with parallel_scan"
+            << (correct ? "" : " (WRONG ANSWER!)") << std::endl;
+
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
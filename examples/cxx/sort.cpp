@@ -0,0 +1,141 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * Sorts a vector of random keys with parallel_sort and compares the time
+ * taken with that of std::sort and that of std::stable_sort (a serial merge
+ * sort, which is what parallel_sort does in parallel). Then, merges the two
+ * sorted halves of a vector with parallel_merge and compares the time taken
+ * with that of std::merge.
+ *
+ * To see the speedup, use at least 10^6 keys; up to 10^9 keys (8GB for the
+ * keys and as much again for the scratch buffer) work if there is memory.
+ */
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/parallel_sort.hpp>
+
+/**
+ * Define the PFunc instance. Note that we HAVE TO USE PFUNC::USE_DEFAULT as
+ * the type of the FUNCTOR because of the way in which pfunc::parallel_sort
+ * is defined!
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::task task;
+typedef generator_type::taskmgr taskmgr;
+
+typedef std::vector<unsigned long long> key_vector;
+
+/**
+ * A 64-bit linear congruential generator; rand() does not give enough bits
+ * for large inputs.
+ * @param[in,out] state The state of the generator.
+ * @return The next key.
+ */
+static unsigned long long next_key (unsigned long long& state) {
+  state = state*6364136223846793005ULL + 1442695040888963407ULL;
+  return state >> 16;
+}
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'n': How many keys to sort.
+ * (2) 'cutoff': The number of keys at or below which we sort (or merge)
+ *               serially.
+ * (3) 'nqueues': The number of task queues to create
+ * (4) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (5 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./sort <n> <cutoff> <nqueues> <nthreads>"
+              << std::endl;
+    exit (3);
+  }
+
+  const size_t n = static_cast<size_t>(atol(argv[1]));
+  const size_t cutoff = static_cast<size_t>(atol(argv[2]));
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[3]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[4]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  // Create the input
+  key_vector input (n);
+  unsigned long long state = 2009;
+  for (size_t i=0; i<n; ++i) input[i] = next_key (state);
+
+  // Serial baselines
+  key_vector serial_keys (input);
+  double serial_time = micro_time();
+  std::sort (serial_keys.begin(), serial_keys.end());
+  serial_time = micro_time() - serial_time;
+
+  key_vector stable_keys (input);
+  double stable_time = micro_time();
+  std::stable_sort (stable_keys.begin(), stable_keys.end());
+  stable_time = micro_time() - stable_time;
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+
+  key_vector parallel_keys (input);
+  task root_task;
+  attribute root_attribute (false /*nested*/, false /*grouped*/);
+  pfunc::parallel_sort<generator_type, key_vector::iterator>
+    root_sort (parallel_keys.begin(), parallel_keys.end(), global_taskmgr,
+               std::less<unsigned long long> (), cutoff);
+
+  double parallel_time = micro_time();
+  pfunc::spawn (global_taskmgr, root_task, root_attribute, root_sort);
+  pfunc::wait (global_taskmgr, root_task);
+  parallel_time = micro_time() - parallel_time;
+
+  std::cout << "Sorting " << n << " keys took " << serial_time
+            << " seconds with std::sort, " << stable_time
+            << " seconds with std::stable_sort and " << parallel_time
+            << " seconds with parallel_sort"
+            << ((serial_keys == parallel_keys) ? "" : " (WRONG ANSWER!)")
+            << std::endl;
+
+  // Merge the two sorted halves of the input
+  const size_t half = n/2;
+  std::sort (input.begin(), input.begin()+half);
+  std::sort (input.begin()+half, input.end());
+
+  double merge_time = micro_time();
+  std::merge (input.begin(), input.begin()+half,
+              input.begin()+half, input.end(), stable_keys.begin());
+  merge_time = micro_time() - merge_time;
+
+  pfunc::parallel_merge<generator_type, key_vector::iterator,
+                        key_vector::iterator, key_vector::iterator>
+    root_merge (input.begin(), input.begin()+half,
+                input.begin()+half, input.end(), parallel_keys.begin(),
+                global_taskmgr, std::less<unsigned long long> (), cutoff);
+
+  double parallel_merge_time = micro_time();
+  pfunc::spawn (global_taskmgr, root_task, root_attribute, root_merge);
+  pfunc::wait (global_taskmgr, root_task);
+  parallel_merge_time = micro_time() - parallel_merge_time;
+
+  std::cout << "Merging " << n << " keys took " << merge_time
+            << " seconds with std::merge and " << parallel_merge_time
+            << " seconds with parallel_merge"
+            << ((stable_keys == parallel_keys) ? "" : " (WRONG ANSWER!)")
+            << std::endl;
+
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
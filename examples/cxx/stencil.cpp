@@ -0,0 +1,282 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * For an explanation of Loop parallelism, please see for.cpp.
+ *
+ * Stencils sweep over 2-D and 3-D grids, and every point reads its
+ * neighbours in all the dimensions. Flattening such a loop into a space_1D
+ * hands out strips of whole rows; the neighbouring rows of a strip are only
+ * reused if the strips are long enough to hold them in the cache.
+ * space_2D and space_3D split along the longest dimension instead, so the
+ * leaves are tiles that are close to square (or cubical) at every level of
+ * the recursion, whatever the size of the cache.
+ *
+ * This example runs a 5-point Jacobi sweep over an n x n grid with a
+ * flattened space_1D, with a space_2D, and with a space_2D whose leaves are
+ * visited in Z-order. It then sums the squares of a 3-D grid of the same
+ * size with parallel_reduce over a space_3D.
+ */
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/space_1D.hpp>
+#include <pfunc/space_2D.hpp>
+#include <pfunc/space_3D.hpp>
+#include <pfunc/parallel_for.hpp>
+#include <pfunc/parallel_reduce.hpp>
+
+/**
+ * One Jacobi sweep of the 5-point stencil over the interior of an n x n
+ * grid that is stored row-major.
+ */
+struct jacobi_sweep {
+  private:
+  const std::vector<double>& source;
+  std::vector<double>& target;
+  size_t n;
+
+  /**
+   * Computes the new value of one point.
+   */
+  void update (const size_t row, const size_t col) const {
+    const size_t i = row*n + col;
+    target[i] = 0.25*(source[i-n] + source[i+n] + source[i-1] + source[i+1]);
+  }
+
+  public:
+  /**
+   * Constructor
+   * @param[in] source The values of the previous sweep.
+   * @param[out] target The values of this sweep.
+   * @param[in] n The number of rows (and columns) of the grid.
+   */
+  jacobi_sweep (const std::vector<double>& source,
+                std::vector<double>& target,
+                const size_t n) : source (source), target (target), n (n) {}
+
+  /**
+   * Sweeps over a strip of the flattened interior of the grid.
+   */
+  void operator() (const pfunc::space_1D& space) const {
+    for (size_t i=space.begin(); i<space.end(); ++i)
+      update (1 + i/(n-2), 1 + i%(n-2));
+  }
+
+  /**
+   * Sweeps over a tile of the interior of the grid.
+   */
+  void operator() (const pfunc::space_2D& space) const {
+    for (size_t row=space.row_begin(); row<space.row_end(); ++row)
+      for (size_t col=space.col_begin(); col<space.col_end(); ++col)
+        update (row, col);
+  }
+};
+
+/**
+ * Sums the squares of the points of an m x m x m grid.
+ */
+struct sum_squares {
+  private:
+  const std::vector<double>* grid;
+  size_t m;
+  double sum;
+
+  public:
+  /**
+   * Constructor
+   * @param[in] grid The grid, stored with the last dimension contiguous.
+   * @param[in] m The length of each dimension of the grid.
+   */
+  sum_squares (const std::vector<double>& grid, const size_t m) :
+    grid (&grid), m (m), sum (0.0) {}
+
+  /**
+   * Adds up the squares of a block of the grid.
+   */
+  void operator() (const pfunc::space_3D& space) {
+    for (size_t i=space.begin(0); i<space.end(0); ++i)
+      for (size_t j=space.begin(1); j<space.end(1); ++j)
+        for (size_t k=space.begin(2); k<space.end(2); ++k) {
+          const double value = (*grid)[(i*m + j)*m + k];
+          sum += value*value;
+        }
+  }
+
+  /**
+   * Split --- create a functor that is properly initialized.
+   * @return A functor that is correctly initialized.
+   */
+  sum_squares split () const { return sum_squares (*grid, m); }
+
+  /**
+   * Join from a previous iterator.
+   * @param[in] other The functor from which we need to join.
+   */
+  void join (const sum_squares& other) { sum += other.get_sum (); }
+
+  /**
+   * @return The sum of squares accumulated by this functor.
+   */
+  double get_sum () const { return sum; }
+};
+
+/**
+ * Define the PFunc instance. Note that we HAVE TO USE PFUNC::USE_DEFAULT as
+ * the type of the FUNCTOR because of the way in which pfunc::parallel_for
+ * is defined!
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::task task;
+typedef generator_type::taskmgr taskmgr;
+
+/**
+ * Runs 'niterations' Jacobi sweeps over the space and times them.
+ * @param[in] global_taskmgr The task manager to run the sweeps on.
+ * @param[in] space The interior of the grid.
+ * @param[in,out] even The initial grid; the result if niterations is even.
+ * @param[in,out] odd The result if niterations is odd.
+ * @param[in] n The number of rows (and columns) of the grid.
+ * @param[in] niterations The number of sweeps.
+ * @return The time taken in seconds.
+ */
+template <typename SpaceType>
+static double time_sweeps (taskmgr& global_taskmgr,
+                           const SpaceType& space,
+                           std::vector<double>& even,
+                           std::vector<double>& odd,
+                           const size_t n,
+                           const int niterations) {
+  task root_task;
+  attribute root_attribute (false /*nested*/, false /*grouped*/);
+  const jacobi_sweep even_sweep (even, odd, n);
+  const jacobi_sweep odd_sweep (odd, even, n);
+
+  double time = micro_time();
+  for (int i=0; i<niterations; ++i) {
+    pfunc::parallel_for<generator_type, jacobi_sweep, SpaceType>
+      root_for (space, (0==i%2) ? even_sweep : odd_sweep, global_taskmgr);
+    pfunc::spawn (global_taskmgr, root_task, root_attribute, root_for);
+    pfunc::wait (global_taskmgr, root_task);
+  }
+  return micro_time() - time;
+}
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'n': The number of rows (and columns) of the 2-D grid.
+ * (2) 'grain': The number of rows (and columns) below which a tile is
+ *              executed serially. The flattened loop uses grain*grain.
+ * (3) 'niterations': The number of Jacobi sweeps.
+ * (4) 'nqueues': The number of task queues to create
+ * (5) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (6 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./stencil <n> <grain> <niterations> <nqueues> <nthreads>"
+              << std::endl;
+    exit (3);
+  }
+
+  const size_t n = static_cast<size_t>(atoi(argv[1]));
+  const size_t grain = static_cast<size_t>(atoi(argv[2]));
+  const int niterations = atoi(argv[3]);
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[4]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[5]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  if (3 > n || 0 == grain) {
+    std::cout << "Please choose n >= 3 and grain >= 1" << std::endl;
+    exit (3);
+  }
+
+  // Set up the base case sizes
+  pfunc::space_1D::base_case_size = grain*grain;
+  pfunc::space_2D::base_case_size[0] = grain;
+  pfunc::space_2D::base_case_size[1] = grain;
+
+  // Create the grid
+  std::vector<double> initial (n*n);
+  for (size_t i=0; i<n*n; ++i) initial[i] = get_next_rand();
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+
+  // Sweep with each of the spaces
+  std::vector<double> flat_even (initial), flat_odd (initial);
+  const double flat_time = time_sweeps (global_taskmgr,
+                                        pfunc::space_1D (0, (n-2)*(n-2)),
+                                        flat_even, flat_odd, n, niterations);
+
+  std::vector<double> tiled_even (initial), tiled_odd (initial);
+  const double tiled_time = time_sweeps (global_taskmgr,
+                                         pfunc::space_2D (1, n-1, 1, n-1),
+                                         tiled_even, tiled_odd, n,
+                                         niterations);
+
+  std::vector<double> morton_even (initial), morton_odd (initial);
+  const double morton_time = time_sweeps (global_taskmgr,
+                                          pfunc::space_2D (1, n-1, 1, n-1,
+                                                           true /*morton*/),
+                                          morton_even, morton_odd, n,
+                                          niterations);
+
+  // All of them should have ended up with the same values
+  const std::vector<double>& flat_result =
+    (0==niterations%2) ? flat_even : flat_odd;
+  const std::vector<double>& tiled_result =
+    (0==niterations%2) ? tiled_even : tiled_odd;
+  const std::vector<double>& morton_result =
+    (0==niterations%2) ? morton_even : morton_odd;
+  bool correct = true;
+  for (size_t i=0; i<n*n; ++i)
+    if (flat_result[i] != tiled_result[i] ||
+        flat_result[i] != morton_result[i]) correct = false;
+
+  std::cout << niterations << " sweeps over a " << n << "x" << n
+            << " grid took " << flat_time << " seconds flattened, "
+            << tiled_time << " seconds tiled and "
+            << morton_time << " seconds tiled in Z-order"
+            << (correct ? "" : " (WRONG ANSWER!)") << std::endl;
+
+  // Sum the squares of a 3-D grid with as many points
+  const size_t m = static_cast<size_t>(pow (static_cast<double>(n*n), 1.0/3));
+  std::vector<double> grid (m*m*m);
+  double serial_sum = 0.0;
+  for (size_t i=0; i<m*m*m; ++i) {
+    grid[i] = get_next_rand();
+    serial_sum += grid[i]*grid[i];
+  }
+
+  task root_task;
+  attribute root_attribute (false /*nested*/, false /*grouped*/);
+  sum_squares root_sum (grid, m);
+  pfunc::parallel_reduce<generator_type, sum_squares, pfunc::space_3D>
+    root_reduce (pfunc::space_3D (0, m, 0, m, 0, m), root_sum, global_taskmgr);
+
+  double reduce_time = micro_time();
+  pfunc::spawn (global_taskmgr, root_task, root_attribute, root_reduce);
+  pfunc::wait (global_taskmgr, root_task);
+  reduce_time = micro_time() - reduce_time;
+
+  std::cout << "Summing the squares of a " << m << "x" << m << "x" << m
+            << " grid took " << reduce_time << " seconds"
+            << ((fabs (root_sum.get_sum () - serial_sum) <
+                 1e-6*fabs (serial_sum)) ? "" : " (WRONG ANSWER!)")
+            << std::endl;
+
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
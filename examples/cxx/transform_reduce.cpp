@@ -0,0 +1,153 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * For an explanation of Loop parallelism, please see for.cpp.
+ *
+ * Works out the sum, dot product, smallest and largest elements and the
+ * norm of vectors of doubles with parallel_transform_reduce, in both of its
+ * summation modes. The time taken by each is compared with that of a serial
+ * loop that does the same. The elements are small integers, so all the
+ * answers are exact whatever the order of the additions.
+ */
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/parallel_transform_reduce.hpp>
+
+/**
+ * Define the PFunc instance. Note that we HAVE TO USE PFUNC::USE_DEFAULT as
+ * the type of the FUNCTOR because of the way in which
+ * pfunc::parallel_transform_reduce is defined!
+ */
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  pfunc::use_default /* any function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::task task;
+typedef generator_type::taskmgr taskmgr;
+
+/**
+ * Runs parallel_transform_reduce as the root task in both summation modes
+ * and prints out how it fared against the serial loop.
+ * @param[in] global_taskmgr The task manager to use.
+ * @param[in] name What is being worked out.
+ * @param[in] x The first vector.
+ * @param[in] y The second vector; only used for dot products.
+ * @param[in] blocksize The number of elements in a block; 0 for the default.
+ * @param[in] serial_result What the serial loop got.
+ * @param[in] serial_time The time taken by the serial loop.
+ */
+template <typename Kernel>
+static void run (taskmgr& global_taskmgr,
+                 const char* name,
+                 const std::vector<double>& x,
+                 const std::vector<double>& y,
+                 const size_t blocksize,
+                 const double serial_result,
+                 const double serial_time) {
+  const double* first = &x[0];
+  const double* last = first + x.size();
+  const pfunc::summation_mode modes [2] = {pfunc::fast_summation,
+                                           pfunc::reproducible_summation};
+  double times [2];
+  bool correct = true;
+
+  for (int i=0; i<2; ++i) {
+    pfunc::parallel_transform_reduce<generator_type, Kernel, double>
+      root_reduce (first, last, &y[0], global_taskmgr, modes[i], blocksize);
+
+    task root_task;
+    attribute root_attribute (false /*nested*/, false /*grouped*/);
+    times[i] = micro_time();
+    pfunc::spawn (global_taskmgr, root_task, root_attribute, root_reduce);
+    pfunc::wait (global_taskmgr, root_task);
+    times[i] = micro_time() - times[i];
+
+    correct = correct && (serial_result == root_reduce.get_result ());
+  }
+
+  std::cout << name << " took " << serial_time << " seconds with a loop, "
+            << times[0] << " seconds in the fast mode and " << times[1]
+            << " seconds in the reproducible mode"
+            << (correct ? "" : " (WRONG ANSWER!)") << std::endl;
+}
+
+/**
+ * Main harness. Takes in the following parameters:
+ * (1) 'n': How big the vectors are.
+ * (2) 'blocksize': The number of elements in a block; 0 to use the default.
+ * (3) 'nqueues': The number of task queues to create
+ * (4) 'nthreads': The number of threads PER QUEUE. Total number of threads is
+ *                 'nqueues'*'nthreads'.
+ */
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (5 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./transform_reduce <n> <blocksize> <nqueues> <nthreads>"
+              << std::endl;
+    exit (3);
+  }
+
+  const size_t n = static_cast<size_t>(atoi(argv[1]));
+  const size_t blocksize = static_cast<size_t>(atoi(argv[2]));
+  const unsigned int nqueues = static_cast<unsigned int>(atoi(argv[3]));
+  const unsigned int threads_per_queue =
+                               static_cast<unsigned int>(atoi(argv[4]));
+  unsigned int* threads_per_queue_array = new unsigned int [nqueues];
+  for (unsigned int i=0; i<nqueues; ++i)
+    threads_per_queue_array[i] = threads_per_queue;
+
+  // Create the input
+  std::vector<double> x (n), y (n);
+  for (size_t i=0; i<n; ++i) {
+    x[i] = static_cast<double>(rand ()%1000 - 500);
+    y[i] = static_cast<double>(rand ()%1000 - 500);
+  }
+
+  // Serial baselines
+  double sum = 0.0, dot = 0.0, squares = 0.0;
+  double smallest = HUGE_VAL, largest = -HUGE_VAL;
+  double sum_time = micro_time();
+  for (size_t i=0; i<n; ++i) sum += x[i];
+  sum_time = micro_time() - sum_time;
+  double dot_time = micro_time();
+  for (size_t i=0; i<n; ++i) dot += x[i]*y[i];
+  dot_time = micro_time() - dot_time;
+  double min_time = micro_time();
+  for (size_t i=0; i<n; ++i) if (x[i] < smallest) smallest = x[i];
+  min_time = micro_time() - min_time;
+  double max_time = micro_time();
+  for (size_t i=0; i<n; ++i) if (largest < x[i]) largest = x[i];
+  max_time = micro_time() - max_time;
+  double norm_time = micro_time();
+  for (size_t i=0; i<n; ++i) squares += x[i]*x[i];
+  const double norm = std::sqrt (squares);
+  norm_time = micro_time() - norm_time;
+
+  // Initialize PFunc
+  taskmgr global_taskmgr (nqueues, threads_per_queue_array);
+
+  pfunc::parallel_transform_reduce<generator_type, pfunc::sum_kernel, double>
+    probe (&x[0], &x[0], global_taskmgr);
+  std::cout << "Using the " << probe.get_instruction_set () << " kernels"
+            << std::endl;
+
+  run<pfunc::sum_kernel> (global_taskmgr, "Sum", x, y, blocksize,
+                          sum, sum_time);
+  run<pfunc::dot_kernel> (global_taskmgr, "Dot product", x, y, blocksize,
+                          dot, dot_time);
+  run<pfunc::min_kernel> (global_taskmgr, "Smallest element", x, y,
+                          blocksize, smallest, min_time);
+  run<pfunc::max_kernel> (global_taskmgr, "Largest element", x, y,
+                          blocksize, largest, max_time);
+  run<pfunc::norm_kernel> (global_taskmgr, "Norm", x, y, blocksize,
+                           norm, norm_time);
+
+  delete [] threads_per_queue_array;
+
+  return 0;
+}
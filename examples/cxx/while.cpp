@@ -80,31 +80,29 @@ struct dag_iterator {
  * A structure that does BFS traversal for the nodes. This is a model of 
  * the WhileExecutable concept.
  */
-template <typename PFuncInstanceType>
 struct inorder {
   private:
   std::vector<char>& color_map;
-  typename PFuncInstanceType::taskmgr& current_taskmgr;
 
   public:
-  inorder (std::vector<char>& color_map, 
-           typename PFuncInstanceType::taskmgr& current_taskmgr): 
-    color_map (color_map), current_taskmgr (current_taskmgr) {}
+  inorder (std::vector<char>& color_map) : color_map (color_map) {}
   
   /**
    * This is invoked by parallel_while. The operator has to be a const.
    * @param[in] node The current vertex that needs to be explored.
+   * @param[in,out] feeder Adds vertices to the parallel_while.
    *
    * Some of the vertices that we have an edge to might already have been
    * discovered. Check this carefully and ensure that we do not visit the
    * the same vertex twice. This is done using the color_map. If the 
    * color_map is NOT WHITE, we omit expanding. If it is WHITE, then this 
    * vertex might be eligible for expansion. Try to atomically swap its 
-   * color and if successful, start a new parallel_while for the edges 
-   * of that vertex. If not successful, we know that someone else changed
-   * the color and they will perform the expansion.
+   * color and if successful, feed the vertices that its edges lead to 
+   * back into the parallel_while. If not successful, we know that someone
+   * else changed the color and they will perform the expansion.
    */
-  void operator()(vertex_t* vertex) const {
+  void operator()(vertex_t* vertex, 
+                  pfunc::parallel_while_feeder<vertex_t*>& feeder) const {
 
     // Try to compare and swap the value
     if (WHITE == color_map[vertex->id] && 
@@ -112,17 +110,10 @@ struct inorder {
       std::cout << vertex->id << ":" 
                 << ((color_map[vertex->id]==WHITE) ? "WHITE" : "BLACK")
                 << std::endl;
-      // Spawn one for all my edges.
-      pfunc::parallel_while<PFuncInstanceType, 
-                            dag_iterator, 
-                            inorder<PFuncInstanceType> > 
-        edge_while (get_first_edge (vertex), 
-                    get_last_edge (vertex), 
-                    *this,
-                    current_taskmgr);
-      typename PFuncInstanceType::task edge_task;
-      pfunc::spawn (current_taskmgr, edge_task, edge_while);
-      pfunc::wait (current_taskmgr, edge_task);
+      // Feed the vertices at the end of all my edges.
+      dag_iterator last = get_last_edge (vertex);
+      for (dag_iterator edge = get_first_edge (vertex); edge != last; ++edge)
+        feeder.add (*edge);
     }
   }
 };
@@ -200,10 +191,11 @@ int main (int argc, char** argv) {
   // Spawn the root task
   task root_task;
   attribute root_attribute (false /*nested*/, false /*grouped*/);
-  pfunc::parallel_while<generator_type, dag_iterator, inorder<generator_type> > 
+  const inorder root_inorder (color_map);
+  pfunc::parallel_while<generator_type, dag_iterator, inorder> 
   root_while (get_first_edge (start_vertex), 
               get_last_edge (start_vertex), 
-              inorder<generator_type> (color_map, global_taskmgr), 
+              root_inorder, 
               global_taskmgr);
 
   double time = micro_time();
@@ -368,10 +368,14 @@ int pfunc_##sched##_wait_any (pfunc_##sched##_taskmgr_t taskmgr, \
                               int count, \
                               int* completed) { \
   PFUNC_START_TRY_BLOCK() \
+  pfunc::detail::pfunc_##sched##_taskmgr_t& cpp_taskmgr = \
+      *(reinterpret_cast<pfunc::detail::pfunc_##sched##_taskmgr_t*>(taskmgr)); \
+  pfunc::detail::pfunc_##sched##_task_t** cpp_tasks = \
+      reinterpret_cast<pfunc::detail::pfunc_##sched##_task_t**>(tasks); \
+  *completed = pfunc::detail::wait_any (cpp_taskmgr, cpp_tasks, cpp_tasks+count); \
   return PFUNC_SUCCESS; \
   PFUNC_END_TRY_BLOCK() \
   PFUNC_C_CATCH_AND_RETURN_EXCEPTION_CODE() \
-\
 } \
 \
 int pfunc_##sched##_test (pfunc_##sched##_taskmgr_t taskmgr, \
@@ -0,0 +1,457 @@
+/**
+ * @author Prabhanjan Kambadur
+ *
+ * A benchmark of the scalability of the runtime on a compute bound problem:
+ * the product C += A*B of two square, ROW-MAJOR matrices. As in
+ * examples/cxx/matmult.cpp, C is divided into four quadrants and the eight
+ * products of the quadrants of A and B are run in two batches of four with
+ * parallel_invoke, recursively, till the matrices are 'x' by 'x'.
+ *
+ * Unlike matmult.cpp, which uses the three loop formula at the leaves and so
+ * mostly measures cache misses, every leaf here is multiplied the way a
+ * tuned DGEMM would:
+ * (1) A is packed into panels of 'rows' rows and B into panels of 'columns'
+ *     columns, each laid out in the order in which the micro-kernel reads
+ *     it, so that the reads are contiguous.
+ * (2) A micro-kernel works out a 'rows' by 'columns' block of C, which is
+ *     held in vector registers throughout, with one fused multiply-add per
+ *     'rows' x (vector width) elements per step of the inner dimension.
+ * The micro-kernel is built for SSE2, AVX2 and AVX-512; the widest one that
+ * the processor supports is used. The panel of B that is in use is small
+ * enough to stay in the L1 cache; 'x' should be small enough for the packed
+ * leaf of A (8*'x'*'x' bytes) to stay in the L2 cache --- 128 or 256 are
+ * good choices.
+ *
+ * The product is timed with 1, 2, 4, ... and 'nthreads' threads (one task
+ * queue per thread); the best of 'nreps' runs is reported in GFLOP/s along
+ * with the speedup over one thread.
+ *
+ * Inputs:
+ * (1) 'n': The dimension of the square matrix. If this is not a power of two,
+ *          'n' is rounded up to the next power of two.
+ * (2) 'x': The dimension of the matrix below which the leaf multiply is
+ *          used. As a rule, 'x' <= 'n'.
+ * (3) 'nthreads': The largest number of threads to time.
+ * (4) 'nreps': The number of times to time each thread count.
+ */
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cassert>
+#include <vector>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/utility.h>
+#include <pfunc/simd.hpp>
+#include <pfunc/parallel_invoke.hpp>
+
+/**
+ * First, let us get the definition of the PFunc instance.
+ */
+struct dgemm_op;
+typedef
+pfunc::generator <pfunc::cilkS, /* Cilk-style scheduling */
+                  pfunc::use_default, /* No task priorities needed */
+                  dgemm_op /* function type*/> generator_type;
+typedef generator_type::attribute attribute;
+typedef generator_type::task task;
+typedef generator_type::taskmgr taskmgr;
+
+/**
+ * A square submatrix of one big ROW-MAJOR matrix. With each subdivision, the
+ * dimension halves, the stride stays the same and the starting point moves
+ * to the quadrant.
+ */
+struct divisible_matrix {
+  private:
+  int dim;
+  int stride;
+  double* start;
+
+  public:
+  /**
+   * Constructor.
+   * @param[in] dim Dimension of this matrix
+   * @param[in] stride Stride to access succesive rows of this matrix.
+   * @param[in] start The first element of this matrix.
+   */
+  divisible_matrix (const int dim, const int stride, double* start) :
+    dim (dim), stride (stride), start (start) {}
+
+  /**
+   * Return a new matrix, which represents the current matrix's quadarant.
+   * Quadrants are numbered as shown here: Q1 | Q2
+   *                                       -------
+   *                                       Q3 | Q4
+   * @param[in] quadrant 1,2,3 or 4. Determines the starting point.
+   */
+  divisible_matrix split (const int quadrant) const {
+    const int new_dim = dim/2;
+    const int offset = ((1==quadrant) ? 0 :
+                          (2==quadrant) ? new_dim :
+                            (3==quadrant) ? new_dim*stride:
+                              new_dim*stride + new_dim);
+    return divisible_matrix (new_dim, stride, start+offset);
+  }
+
+  /**
+   * @param[in] i The row number [0,dim)
+   * @param[in] j The column number [0,dim)
+   * @return [i][j]th element.
+   */
+  double& operator() (int i, int j) const {
+    assert (i<dim && j<dim);
+    return start[i*stride+j];
+  }
+
+  /**
+   * @return Dimension of the matrix
+   */
+  int dimension () const { return dim; }
+
+  /**
+   * @return Stride to access succesive rows of this matrix.
+   */
+  int row_stride () const { return stride; }
+};
+
+/**
+ * Multiplies the leaves with a micro-kernel that keeps a 'rows' by 'columns'
+ * block of C in vectors of Width doubles.
+ */
+template <size_t Width>
+struct leaf_multiply {
+  typedef typename pfunc::detail::simd_vector<double, Width>::type
+    vector_type;
+  static const int rows = 4; /**< Rows of C in the registers */
+  static const int vectors = (1 == Width) ? 4 : 2; /**< Vectors per row */
+  static const int columns = vectors*Width; /**< Columns of C in registers */
+
+  /**
+   * Packs A into panels of 'rows' rows; within a panel, the 'rows' elements
+   * of a column are next to each other.
+   * @param[in] A The leaf of A.
+   * @param[out] packed Room for all of A.
+   */
+  static void pack_A (const divisible_matrix& A, double* packed) {
+    const int dim = A.dimension();
+    for (int panel=0; panel<dim; panel+=rows)
+      for (int k=0; k<dim; ++k)
+        for (int i=0; i<rows; ++i) *packed++ = A(panel+i, k);
+  }
+
+  /**
+   * Packs B into panels of 'columns' columns; within a panel, the 'columns'
+   * elements of a row are next to each other.
+   * @param[in] B The leaf of B.
+   * @param[out] packed Room for all of B.
+   */
+  static void pack_B (const divisible_matrix& B, double* packed) {
+    const int dim = B.dimension();
+    for (int panel=0; panel<dim; panel+=columns)
+      for (int k=0; k<dim; ++k, packed+=columns)
+        std::memcpy (packed, &B(k, panel), columns*sizeof(double));
+  }
+
+  /**
+   * Adds the product of a panel of A and a panel of B to a block of C.
+   * @param[in] dim The inner dimension.
+   * @param[in] a The panel of A.
+   * @param[in] b The panel of B.
+   * @param[in,out] c The first element of the block of C.
+   * @param[in] stride Stride to access succesive rows of C.
+   */
+  static void micro_kernel (const int dim,
+                            const double* a,
+                            const double* b,
+                            double* c,
+                            const int stride) {
+    vector_type accumulators [rows][vectors];
+    for (int i=0; i<rows; ++i)
+      for (int j=0; j<vectors; ++j) accumulators[i][j] = vector_type ();
+
+    for (int k=0; k<dim; ++k, a+=rows, b+=columns) {
+      for (int j=0; j<vectors; ++j) {
+        vector_type b_vector;
+        std::memcpy (&b_vector, b+j*Width, sizeof (vector_type));
+        for (int i=0; i<rows; ++i) accumulators[i][j] += a[i]*b_vector;
+      }
+    }
+
+    for (int i=0; i<rows; ++i, c+=stride) {
+      for (int j=0; j<vectors; ++j) {
+        vector_type c_vector;
+        std::memcpy (&c_vector, c+j*Width, sizeof (vector_type));
+        c_vector += accumulators[i][j];
+        std::memcpy (c+j*Width, &c_vector, sizeof (vector_type));
+      }
+    }
+  }
+
+  /**
+   * C += A*B for the leaves. The panel of B that is in use stays in the L1
+   * cache while all the panels of A go past it.
+   * @param[in] A The leaf of A.
+   * @param[in] B The leaf of B.
+   * @param[in,out] C The leaf of C.
+   */
+  static void multiply (const divisible_matrix& A,
+                        const divisible_matrix& B,
+                        const divisible_matrix& C) {
+    const int dim = A.dimension();
+    std::vector<double> packed_A (dim*dim);
+    std::vector<double> packed_B (dim*dim);
+    pack_A (A, &packed_A[0]);
+    pack_B (B, &packed_B[0]);
+
+    for (int j=0; j<dim; j+=columns)
+      for (int i=0; i<dim; i+=rows)
+        micro_kernel (dim, &packed_A[i*dim], &packed_B[j*dim],
+                      &C(i, j), C.row_stride());
+  }
+};
+
+#if PFUNC_HAVE_SIMD_DISPATCH == 1
+/**
+ * The leaf multiply built for each instruction set.
+ */
+__attribute__((target("sse2"), flatten))
+static void leaf_multiply_sse2 (const divisible_matrix& A,
+                                const divisible_matrix& B,
+                                const divisible_matrix& C) {
+  leaf_multiply<2>::multiply (A, B, C);
+}
+
+__attribute__((target("avx2,fma"), flatten))
+static void leaf_multiply_avx2 (const divisible_matrix& A,
+                                const divisible_matrix& B,
+                                const divisible_matrix& C) {
+  leaf_multiply<4>::multiply (A, B, C);
+}
+
+__attribute__((target("avx512f"), flatten))
+static void leaf_multiply_avx512 (const divisible_matrix& A,
+                                  const divisible_matrix& B,
+                                  const divisible_matrix& C) {
+  leaf_multiply<8>::multiply (A, B, C);
+}
+#endif
+
+/**
+ * The instruction set that the leaves are multiplied with.
+ */
+static pfunc::detail::simd_isa leaf_isa = pfunc::detail::simd_scalar;
+
+/**
+ * The dimension below which the leaf multiply is used.
+ */
+static int problem_base_case_dim = 128;
+
+/**
+ * Picks the instruction set for the leaves; AVX2 is only used along with
+ * fused multiply-adds.
+ * @return The instruction set to use.
+ */
+static pfunc::detail::simd_isa pick_leaf_isa () {
+  pfunc::detail::simd_isa isa = pfunc::detail::get_simd_isa ();
+#if PFUNC_HAVE_SIMD_DISPATCH == 1
+  if (pfunc::detail::simd_avx2 == isa && !__builtin_cpu_supports ("fma"))
+    isa = pfunc::detail::simd_sse2;
+#endif
+  return isa;
+}
+
+/**
+ * C += A*B for the leaves with the micro-kernel for leaf_isa. Leaves whose
+ * dimension is not a multiple of the register block fall back to the three
+ * loop formula.
+ * @param[in] A The leaf of A.
+ * @param[in] B The leaf of B.
+ * @param[in,out] C The leaf of C.
+ */
+static void dgemm_leaf (const divisible_matrix& A,
+                        const divisible_matrix& B,
+                        const divisible_matrix& C) {
+  const int dim = A.dimension();
+  if (0 != dim%leaf_multiply<8>::columns) { // the widest register block
+    for (int i=0; i<dim; ++i)
+      for (int k=0; k<dim; ++k)
+        for (int j=0; j<dim; ++j) C(i,j) += A(i,k)*B(k,j);
+    return;
+  }
+
+  switch (leaf_isa) {
+#if PFUNC_HAVE_SIMD_DISPATCH == 1
+    case pfunc::detail::simd_avx512: leaf_multiply_avx512 (A, B, C); break;
+    case pfunc::detail::simd_avx2: leaf_multiply_avx2 (A, B, C); break;
+    case pfunc::detail::simd_sse2: leaf_multiply_sse2 (A, B, C); break;
+#endif
+    default: leaf_multiply<1>::multiply (A, B, C); break;
+  }
+}
+
+/**
+ * Parallel function executed by us to compute the matrix product. The matrix
+ * is sub-divided into four quadrants and matrix product computed
+ * recursively; see examples/cxx/matmult.cpp.
+ */
+struct dgemm_op {
+  private:
+  const divisible_matrix& A;
+  const divisible_matrix& B;
+  const divisible_matrix& C;
+
+  public:
+  /**
+   * Constructor
+   * @param[in] A The submatrix A
+   * @param[in] B The submatrix B
+   * @param[in] C The submatrix C, which has been initialized
+   */
+  dgemm_op (const divisible_matrix& A,
+            const divisible_matrix& B,
+            const divisible_matrix& C) : A (A), B (B), C (C) {}
+
+  void operator()(void) {
+    if (A.dimension() <= problem_base_case_dim) {
+      dgemm_leaf (A, B, C);
+    } else {
+      divisible_matrix q1_A = A.split (1);
+      divisible_matrix q2_A = A.split (2);
+      divisible_matrix q3_A = A.split (3);
+      divisible_matrix q4_A = A.split (4);
+      divisible_matrix q1_B = B.split (1);
+      divisible_matrix q2_B = B.split (2);
+      divisible_matrix q3_B = B.split (3);
+      divisible_matrix q4_B = B.split (4);
+      divisible_matrix q1_C = C.split (1);
+      divisible_matrix q2_C = C.split (2);
+      divisible_matrix q3_C = C.split (3);
+      divisible_matrix q4_C = C.split (4);
+
+      dgemm_op q1_op_1 (q1_A, q1_B, q1_C);
+      dgemm_op q1_op_2 (q2_A, q3_B, q1_C);
+      dgemm_op q2_op_1 (q1_A, q2_B, q2_C);
+      dgemm_op q2_op_2 (q2_A, q4_B, q2_C);
+      dgemm_op q3_op_1 (q3_A, q1_B, q3_C);
+      dgemm_op q3_op_2 (q4_A, q3_B, q3_C);
+      dgemm_op q4_op_1 (q3_A, q2_B, q4_C);
+      dgemm_op q4_op_2 (q4_A, q4_B, q4_C);
+
+      pfunc::global::parallel_invoke<generator_type> (q1_op_1, q2_op_1,
+                                                      q3_op_1, q4_op_1);
+      pfunc::global::parallel_invoke<generator_type> (q1_op_2, q2_op_2,
+                                                      q3_op_2, q4_op_2);
+    }
+  }
+};
+
+/**
+ * Checks a few elements of C = A*B against the three loop formula.
+ * @param[in] A The matrix A.
+ * @param[in] B The matrix B.
+ * @param[in] C The matrix C.
+ * @return true if they all match.
+ */
+static bool check (const divisible_matrix& A,
+                   const divisible_matrix& B,
+                   const divisible_matrix& C) {
+  const int dim = A.dimension();
+  for (int sample=0; sample<64; ++sample) {
+    const int i = rand()%dim;
+    const int j = rand()%dim;
+    double expected = 0.0;
+    for (int k=0; k<dim; ++k) expected += A(i,k)*B(k,j);
+    if (std::fabs (expected-C(i,j)) > 1e-10*dim) return false;
+  }
+  return true;
+}
+
+int main (int argc, char** argv) {
+  // All inputs must be given. Else, barf.
+  if (5 != argc) {
+    std::cout << "Please use this program as follows" << std::endl
+              << "./dgemm <n> <x> <nthreads> <nreps>" << std::endl;
+    exit(3);
+  }
+
+  const int problem_dim = get_closest_power_of_2 (atoi(argv[1]));
+  problem_base_case_dim = atoi(argv[2]);
+  assert (problem_dim >= problem_base_case_dim);
+  const unsigned int max_threads = static_cast<unsigned int>(atoi(argv[3]));
+  assert (1 <= max_threads);
+  const int num_reps = atoi(argv[4]);
+  leaf_isa = pick_leaf_isa ();
+
+  // Create the matrices
+  const int num_elements = problem_dim*problem_dim;
+  std::vector<double> A_storage (num_elements);
+  std::vector<double> B_storage (num_elements);
+  std::vector<double> C_storage (num_elements);
+
+  for (int i=0; i<num_elements; ++i) {
+    A_storage[i] = get_next_rand();
+    B_storage[i] = get_next_rand();
+  }
+
+  divisible_matrix A (problem_dim, problem_dim, &A_storage[0]);
+  divisible_matrix B (problem_dim, problem_dim, &B_storage[0]);
+  divisible_matrix C (problem_dim, problem_dim, &C_storage[0]);
+
+  const double flops = 2.0*problem_dim*problem_dim*
+                         static_cast<double>(problem_dim);
+  double single_thread_time = 0.0;
+
+  std::cout << "Multiplying two " << problem_dim << "x" << problem_dim
+            << " random matrices with " << problem_base_case_dim << "x"
+            << problem_base_case_dim << " leaves and the "
+            << pfunc::detail::simd_isa_name (leaf_isa) << " micro-kernel"
+            << std::endl
+            << std::setw (8) << "threads" << std::setw (12) << "seconds"
+            << std::setw (10) << "GFLOP/s" << std::setw (10) << "speedup"
+            << std::endl;
+
+  std::vector<unsigned int> thread_counts;
+  for (unsigned int nthreads=1; nthreads<max_threads; nthreads*=2)
+    thread_counts.push_back (nthreads);
+  thread_counts.push_back (max_threads);
+
+  for (size_t count=0; count<thread_counts.size(); ++count) {
+    const unsigned int nthreads = thread_counts[count];
+
+    // One queue per thread
+    std::vector<unsigned int> threads_per_queue (nthreads, 1);
+    taskmgr global_taskmgr (nthreads, &threads_per_queue[0]);
+    pfunc::global::init (global_taskmgr);
+
+    double best_time = 0.0;
+    bool correct = true;
+    for (int rep=0; rep<num_reps; ++rep) {
+      std::fill (C_storage.begin(), C_storage.end(), 0.0);
+
+      task root_task;
+      attribute root_attribute (false /*nested*/, false /*grouped*/);
+      dgemm_op root_dgemm (A, B, C);
+      double time = micro_time();
+      pfunc::global::spawn (root_task, root_attribute, root_dgemm);
+      pfunc::global::wait (root_task);
+      time = micro_time() - time;
+
+      if (0 == rep || time < best_time) best_time = time;
+      correct = correct && check (A, B, C);
+    }
+    if (1 == nthreads) single_thread_time = best_time;
+
+    std::cout << std::setw (8) << nthreads
+              << std::setw (12) << best_time
+              << std::setw (10) << flops/best_time/1e9
+              << std::setw (10) << single_thread_time/best_time
+              << (correct ? "" : " (WRONG ANSWER!)") << std::endl;
+
+    pfunc::global::clear ();
+  }
+
+  return 0;
+}
@@ -1,9 +1,24 @@
+/**
+ * Measures the throughput of the locks that can guard PFunc's task queues
+ * under contention. Each thread repeatedly acquires the lock, increments a
+ * shared counter a few times (the critical section) and releases the lock.
+ * The number of threads is doubled from 1 till <max_threads>.
+ *
+ * Usage: ./mutex_test [<max_threads> [<iterations_per_thread>]]
+ *
+ * NOTE: ticket_lock and mcs_lock are spin locks that hand over the lock in
+ * FIFO order. When there are more threads than processors, a preempted
+ * waiter stalls everyone behind it; so please read the numbers for thread
+ * counts larger than the number of processors with that in mind.
+ */
 #include <cstdio>
 #include <stdlib.h>
 #include <sys/resource.h>
 #include <math.h>
 #include <pthread.h>
 #include <pfunc/utility.h>
+#include <pfunc/mutex.hpp>
+#include <pfunc/queue_lock.hpp>
 
 struct my_mutex {
   pthread_mutex_t mutex;
@@ -25,45 +40,72 @@ struct my_mutex {
   }
 };
 
-struct my_exception {
-  const char* what (void) const {
-    return "What the hell";
+static const int CRITICAL_SECTION_LENGTH = 16;
+static int num_iterations = 100000;
+
+/**
+ * Holds the lock and the counter that it protects for each type of lock.
+ */
+template <typename LockType>
+struct contention_test {
+  static LockType global_lock;
+  static volatile long int counter;
+
+  static void* pthread_func (void* arg) {
+    for (int i=0; i<num_iterations; ++i) {
+      global_lock.lock ();
+      for (int j=0; j<CRITICAL_SECTION_LENGTH; ++j) ++counter;
+      global_lock.unlock ();
+    }
+    return NULL;
+  }
+
+  /**
+   * Runs the test with the given number of threads.
+   * @param[in] name Name of the lock being tested.
+   * @param[in] num_threads The number of contending threads.
+   */
+  static void run (const char* name, const int num_threads) {
+    pthread_t* threads = new pthread_t [num_threads];
+    counter = 0;
+
+    double time = micro_time ();
+    for (int i=0; i<num_threads; ++i)
+      pthread_create (threads+i, NULL, pthread_func, NULL);
+
+    for (int i=0; i<num_threads; ++i)
+      pthread_join (threads[i], NULL);
+    time = micro_time () - time;
+
+    const long int expected =
+      static_cast<long int>(num_threads)*num_iterations*CRITICAL_SECTION_LENGTH;
+    printf ("%-16s %4d threads: %10.6lf s %12.0lf acquires/s %s\n",
+            name,
+            num_threads,
+            time,
+            (static_cast<double>(num_threads)*num_iterations)/time,
+            (counter == expected) ? "" : "(WRONG COUNT!)");
+
+    delete [] threads;
   }
 };
 
-#ifdef MINE
-static my_mutex global_mutex;
-#else
-static pthread_mutex_t global_mutex = PTHREAD_MUTEX_INITIALIZER;
-#endif
-static long int counter;
-
-void* pthread_func (void* arg) {
-#ifdef MINE
-  global_mutex.lock ();
-#else
-  pthread_mutex_lock (&global_mutex);
-#endif
-  for (int i=0; i<10000000; ++i)
-   ++counter;
-#ifdef MINE
-  global_mutex.unlock ();
-#else
-  pthread_mutex_unlock (&global_mutex);
-#endif
-}
+template <typename LockType>
+LockType contention_test<LockType>::global_lock;
 
-int main () {
-  pthread_t threads[8];
+template <typename LockType>
+volatile long int contention_test<LockType>::counter = 0;
 
-  double time = micro_time ();
-  for (int i=0; i<8; ++i) 
-    pthread_create (threads+i, NULL, pthread_func, NULL);
-  
-  for (int i=0; i<8; ++i)
-    pthread_join (threads[i], NULL);  
+int main (int argc, char** argv) {
+  const int max_threads = (1<argc) ? atoi (argv[1]) : 128;
+  if (2<argc) num_iterations = atoi (argv[2]);
 
-  printf ("%ld: %lf\n", counter, micro_time () - time);
+  for (int num_threads=1; num_threads<=max_threads; num_threads*=2) {
+    contention_test<my_mutex>::run ("pthread_mutex", num_threads);
+    contention_test<pfunc::mutex>::run ("pfunc::mutex", num_threads);
+    contention_test<pfunc::ticket_lock>::run ("pfunc::ticket", num_threads);
+    contention_test<pfunc::mcs_lock>::run ("pfunc::mcs", num_threads);
+  }
 
   return 0;
 }
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <cstring>
 #include <pfunc/pfunc.hpp>
 #include <pfunc/utility.h>
 
@@ -43,11 +44,25 @@ struct work_type {
   double average_time;
 };
 
+/**
+ * \param [in] name Name of the barrier as given on the command line.
+ * \return The type of the barrier; BARRIER_STEAL if the name is unknown.
+ */
+static unsigned int barrier_type (const char* name) {
+  if (0 == strcmp (name, "spin")) return BARRIER_SPIN;
+  else if (0 == strcmp (name, "wait")) return BARRIER_WAIT;
+  else if (0 == strcmp (name, "stealwait")) return BARRIER_STEAL_WAIT;
+  else if (0 == strcmp (name, "tree")) return BARRIER_TREE;
+  else if (0 == strcmp (name, "dissemination")) return BARRIER_DISSEMINATION;
+  else return BARRIER_STEAL;
+}
+
 int main (int argc, char** argv) {
-  if (3 != argc) {
+  if (3 != argc && 4 != argc) {
     std::cout << "Run the program like so"
               << std::endl
-              << "./pfunc_barrier_time <nqueues> <nthreadsperqueue>"
+              << "./pfunc_barrier_time <nqueues> <nthreadsperqueue> "
+              << "[spin|steal|wait|stealwait|tree|dissemination]"
               << std::endl;
     exit (3);
   }
@@ -77,6 +92,8 @@ int main (int argc, char** argv) {
   group world_group (1234, 
                      num_queues*num_threads_per_queue, 
                      BARRIER_STEAL);
+  if (4 == argc)
+    pfunc::group_barrier_set (world_group, barrier_type (argv[3]));
 
   // Spawn the tasks.
   for (unsigned int i=0; i<num_queues*num_threads_per_queue; ++i) {
@@ -89,7 +106,7 @@ int main (int argc, char** argv) {
 
   // Now, wait on the tasks to return
   for (unsigned int i=0; i<num_queues*num_threads_per_queue; ++i) {
-    pfunc::wait (tasks[i]);
+    pfunc::wait (*global_tmanager, tasks[i]);
   }
 
   delete [] threads_per_queue;
@@ -3,39 +3,53 @@
 
 # include <pthread.h>
 
+/**
+ * All the atomic operations below are guarded by one lock. With a lock of
+ * its own for each operation, two different operations on the same word
+ * (say, a fetch-and-store and a compare-and-swap) would not be atomic with
+ * respect to each other. In C++, the lock is a local static of an inline
+ * function, so that there is one for the whole program; in C, there is one
+ * for each translation unit.
+ */
+#if defined (c_plusplus) || defined (__cplusplus)
+inline pthread_mutex_t* pfunc_generic_atomics_lock () {
+  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  return &lock;
+}
+#else
+static pthread_mutex_t pfunc_generic_atomics_lock_instance = 
+                                               PTHREAD_MUTEX_INITIALIZER;
+static PFUNC_INLINE pthread_mutex_t* pfunc_generic_atomics_lock () {
+  return &pfunc_generic_atomics_lock_instance;
+}
+#endif
+
 #define pfunc_compare_and_swap_generic(size_in_bits) \
-  static pthread_mutex_t pfunc_compare_and_swap_##size_in_bits##_lock = PTHREAD_MUTEX_INITIALIZER; \
   int##size_in_bits##_t result; \
   volatile int##size_in_bits##_t* cast_loc = PFUNC_STATIC_CAST(volatile int##size_in_bits##_t*,location); \
-  pthread_mutex_lock (&pfunc_compare_and_swap_##size_in_bits##_lock); \
-  if (*cast_loc == comprnd) {  \
-    *cast_loc = exchg; \
-    result = exchg; \
-  } else { \
-    result = *cast_loc; \
-  } \
-  pthread_mutex_unlock (&pfunc_compare_and_swap_##size_in_bits##_lock); \
+  pthread_mutex_lock (pfunc_generic_atomics_lock ()); \
+  result = *cast_loc; \
+  if (result == comprnd) *cast_loc = exchg; \
+  pthread_mutex_unlock (pfunc_generic_atomics_lock ()); \
   return result; 
 
 #define pfunc_fetch_and_store_generic(size_in_bits) \
-  static pthread_mutex_t pfunc_fetch_and_store_##size_in_bits##_lock = PTHREAD_MUTEX_INITIALIZER; \
   int##size_in_bits##_t result; \
   volatile int##size_in_bits##_t* cast_loc = PFUNC_STATIC_CAST(volatile int##size_in_bits##_t*,location); \
-  pthread_mutex_lock (&pfunc_fetch_and_store_##size_in_bits##_lock); \
+  pthread_mutex_lock (pfunc_generic_atomics_lock ()); \
   result = *cast_loc; \
   *cast_loc = new_val; \
-  pthread_mutex_unlock (&pfunc_fetch_and_store_##size_in_bits##_lock); \
+  pthread_mutex_unlock (pfunc_generic_atomics_lock ()); \
   pfunc_mem_fence(); \
   return result;
 
 #define pfunc_fetch_and_add_generic(size_in_bits) \
-  static pthread_mutex_t pfunc_fetch_and_add_##size_in_bits##_lock = PTHREAD_MUTEX_INITIALIZER; \
   int##size_in_bits##_t result; \
   volatile int##size_in_bits##_t* cast_loc = PFUNC_STATIC_CAST(volatile int##size_in_bits##_t*,location); \
-  pthread_mutex_lock (&pfunc_fetch_and_add_##size_in_bits##_lock); \
+  pthread_mutex_lock (pfunc_generic_atomics_lock ()); \
   result = *cast_loc; \
   *cast_loc += addend; \
-  pthread_mutex_unlock (&pfunc_fetch_and_add_##size_in_bits##_lock); \
+  pthread_mutex_unlock (pfunc_generic_atomics_lock ()); \
   pfunc_mem_fence(); \
   return result;
 
@@ -87,4 +101,28 @@ int32_t pfunc_fetch_and_add_32 (volatile void* location,
   pfunc_fetch_and_add_generic(32)
 }
 
+void* pfunc_compare_and_swap_ptr (volatile void* location, 
+                                  void* exchg, 
+                                  void* comprnd) {
+  void* result;
+  void* volatile* cast_loc = PFUNC_STATIC_CAST(void* volatile*,location);
+  pthread_mutex_lock (pfunc_generic_atomics_lock ());
+  result = *cast_loc;
+  if (result == comprnd) *cast_loc = exchg;
+  pthread_mutex_unlock (pfunc_generic_atomics_lock ());
+  return result;
+}
+
+void* pfunc_fetch_and_store_ptr (volatile void* location, 
+                                 void* new_val) {
+  void* result;
+  void* volatile* cast_loc = PFUNC_STATIC_CAST(void* volatile*,location);
+  pthread_mutex_lock (pfunc_generic_atomics_lock ());
+  result = *cast_loc;
+  *cast_loc = new_val;
+  pthread_mutex_unlock (pfunc_generic_atomics_lock ());
+  pfunc_mem_fence();
+  return result;
+}
+
 #endif /** PFUNC_GENERIC_H */
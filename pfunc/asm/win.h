@@ -160,4 +160,17 @@ int32_t pfunc_fetch_and_add_32 (volatile void* location,
   return result;
 }
 
+void* pfunc_compare_and_swap_ptr (volatile void* dest,
+                                  void* exchg,
+                                  void* comprnd) {
+  return InterlockedCompareExchangePointer 
+         (PFUNC_REINTERPRET_CAST(PVOID volatile*,dest), exchg, comprnd);
+}
+
+void* pfunc_fetch_and_store_ptr (volatile void* location, 
+                                 void* new_val) {
+  return InterlockedExchangePointer 
+         (PFUNC_REINTERPRET_CAST(PVOID volatile*,location), new_val);
+}
+
 #endif /** PFUNC_WINDOWS_H */
@@ -138,5 +138,30 @@ int32_t pfunc_fetch_and_add_32 (volatile void* location,
                         : "memory");
   return result;
 }
+
+/**
+ * The operand size of cmpxchg/xchg is picked up from the register that
+ * holds the pointer, so the same code works on both x86 and x86_64.
+ */
+void* pfunc_compare_and_swap_ptr (volatile void* location, 
+                                  void* exchg, 
+                                  void* comprnd) {
+  void* result;
+  __asm__  __volatile ("lock\n\tcmpxchg %3,(%2)\n" 
+                       :"=a"(result) 
+                       :"0" (comprnd) , "c"(location), "r"(exchg) 
+                       :"memory"); 
+  return result;
+}
+
+void* pfunc_fetch_and_store_ptr (volatile void* location, 
+                                 void* new_val) {
+  void* result;
+  __asm__ __volatile__ ("lock\n\txchg %2,(%1)"
+                        : "=r" (result)
+                        : "r" (location), "0"(new_val)
+                        : "memory");
+  return result;
+}
           
 #endif /** PFUNC_X86_32_H */
@@ -0,0 +1,23 @@
+#ifndef __cplusplus
+#warning "Please compile with a C++ compiler to be sure"
+#endif
+typedef double vector_type __attribute__((vector_size(64)));
+
+__attribute__((target("avx512f"), flatten))
+static double sum (const vector_type* first, const vector_type* last) {
+  vector_type result = *first++;
+  while (first != last) result += *first++;
+  return result[0];
+}
+
+int main (int argc, char** argv) {
+  vector_type values[2] = {{0}};
+  double value = argc;
+  __asm__ ("" : "+x" (value));
+  __builtin_cpu_init ();
+  if (!__builtin_cpu_supports ("sse2") || !__builtin_cpu_supports ("avx2"))
+    return -1;
+  if (__builtin_cpu_supports ("avx512f"))
+    return static_cast<int>(sum (values, values+2));
+  return static_cast<int>(value)-argc;
+}
@@ -0,0 +1,21 @@
+/**
+ * Author: Prabhanjan Kambadur.
+ *
+ * This file gives the requirements for a type T to model Monoid concept. A
+ * model of this concept defines the views of a pfunc::reducer.
+ *
+ * create() returns a new view (allocated with new) that holds the identity;
+ * the reducer deletes the views once they are reduced. reduce() folds right
+ * into left, where left comes before right in the serial order of the
+ * program; right is thrown away afterwards. reduce() must be associative,
+ * but need not be commutative. Both are called concurrently on the same
+ * Monoid object by different threads and must not change it.
+ */
+concept Monoid<typename Model> : CopyConstructible<Model> {
+  /**< Associated types */
+  typename value_type;
+
+  /**< Associated functions */
+  value_type* Model::create () const;
+  void Model::reduce (value_type& left, value_type& right) const;
+}
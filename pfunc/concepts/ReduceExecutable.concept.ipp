@@ -4,6 +4,14 @@
  * This file gives the requirements for a type T to model ReduceExecutable
  * concept.  A model of this concept can be executed in parallel by
  * pfunc::parallel_reduce. 
+ *
+ * split() returns a function object that starts afresh (the identity of the
+ * reduction) and join() folds in the result of a function object that ran
+ * over the subspaces to the right. split() is only called for subspaces that
+ * are run by a thread other than the one that split the space (or out of
+ * order), and it is called by that thread while the original may still be
+ * running; so, split() must only read the parts of the function object that
+ * operator() and join() do not change.
  */
 concept ReduceExecutable<typename Model, typename SpaceType> : 
              Space<SpaceType>, Assignable<Model>, CopyAssignable <Model> {
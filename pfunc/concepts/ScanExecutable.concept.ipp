@@ -0,0 +1,26 @@
+/**
+ * Author: Prabhanjan Kambadur.
+ *
+ * This file gives the requirements for a type T to model ScanExecutable
+ * concept.  A model of this concept can be executed in parallel by
+ * pfunc::parallel_scan.
+ *
+ * split() returns a function object that starts afresh (the identity of the
+ * scan) but refers to the same input and output. With pre_scan_tag,
+ * operator() only accumulates the summary of the space; with
+ * final_scan_tag, it also writes out the prefix of every element, starting
+ * from the summary already held. reverse_join(left) makes this hold left's
+ * summary followed by its own; left covers the part of the space just
+ * before the part covered by this. assign(other) makes this hold the
+ * summary of other. split() is called concurrently by several threads, so
+ * it must only read the function object.
+ */
+concept ScanExecutable<typename Model, typename SpaceType> :
+             Space<SpaceType>, CopyConstructible<Model> {
+  /**< Associated functions */
+  Model Model::split () const;
+  void Model::operator () (const SpaceType&, pre_scan_tag);
+  void Model::operator () (const SpaceType&, final_scan_tag);
+  void Model::reverse_join (const Model& left);
+  void Model::assign (const Model& other);
+}
@@ -11,13 +11,18 @@ concept Space<typename Model> : CopyAssignable <Model> {
   typename subspace_container;/**< type of the subspace container */
   requires Sequence<subspace_container>; /**< See SGI STL definition. 
                                               Required for iterability */
+  /**< split() should not allocate; detail::inline_array holds up to arity
+       subspaces in place and is the container that the spaces use. */
   
-  const static size_t arity;/**< Number of ways in which a space is split */
+  const static size_t arity;/**< Maximum number of ways in which a space is
+                                 split; a split gives 2 to arity subspaces */
   const static size_t dimension;/**< Dimensionality of the space */
 
   /**< Associated functions */
-  size_t Model::begin() const;
-  size_t Model::end() const;
+  size_t Model::begin() const; /**< Only when dimension is 1 */
+  size_t Model::end() const; /**< Only when dimension is 1 */
+  size_t Model::begin(const size_t dim) const; /**< When dimension > 1 */
+  size_t Model::end(const size_t dim) const; /**< When dimension > 1 */
   bool Model::can_split() const;
   subspace_container split() const;
 }
@@ -1,11 +1,17 @@
 /**
  * Author: Prabhanjan Kambadur.
- * 
- * This file gives the requirements for a type T to model WhileExecutable 
- * concept. A model of this concept can be executed in paralle by 
+ *
+ * This file gives the requirements for a type T to model WhileExecutable
+ * concept. A model of this concept can be executed in paralle by
  * pfunc::parallel_while.
+ *
+ * Instead of operator() (ArgumentType), a model can define
+ * operator() (ArgumentType, parallel_while_feeder<ArgumentType>&), where
+ * ArgumentType is either the value_type of the iterator or a const reference
+ * to it. The elements added to the feeder are processed by the same
+ * parallel_while.
  */
-concept WhileExecutable <typename Model, typename ArgumentType> : 
+concept WhileExecutable <typename Model, typename ArgumentType> :
                                            CopyAssignable <Model> {
   /**< Associated types */
   typename argument_type;
@@ -13,6 +19,6 @@ concept WhileExecutable <typename Model, typename ArgumentType> :
   /**< Associated type requirements */
   Model::is_convertible <argument_type, ArgumentType>;
 
-  /**< Associated functions */  
+  /**< Associated functions */
   void Model::operator() (ArgumentType) const;
 }
@@ -0,0 +1,326 @@
+#ifndef PFUNC_ENUMERABLE_THREAD_SPECIFIC_HPP
+#define PFUNC_ENUMERABLE_THREAD_SPECIFIC_HPP
+
+/**
+ * \file enumerable_thread_specific.hpp
+ * \brief Implementation of per-thread storage that can be enumerated
+ * \author Prabhanjan Kambadur
+ *
+ * An enumerable_thread_specific holds one object (slot) per thread of a
+ * task manager; local() returns the slot of the calling thread, which is
+ * constructed on the first call. Since no two threads share a slot, tasks
+ * can accumulate into local() without locking. Once the tasks are done,
+ * the slots can be iterated over or combined into one value:
+ *
+ *   pfunc::enumerable_thread_specific<double> partial_sums (global_taskmgr);
+ *   ... tasks do partial_sums.local () += x ...
+ *   double sum = partial_sums.combine (std::plus<double> ());
+ *
+ * Each slot is on cache lines of its own, so that the threads do not
+ * false share. The slot is allocated and constructed by the thread that
+ * owns it; with the usual first-touch placement of pages, the slot ends up
+ * on the NUMA node of the thread (provided the thread is pinned, see the
+ * affinity argument of taskmgr).
+ *
+ * local() may be called concurrently by any number of threads. The rest
+ * (iteration, size(), combine() and clear()) must only be called when no
+ * thread is constructing its slot; typically after waiting on the tasks.
+ */
+#include <cstddef>
+#include <new>
+#include <iterator>
+#include <pfunc/no_copy.hpp>
+#include <pfunc/environ.hpp>
+#include <pfunc/trampolines.hpp>
+
+namespace pfunc {
+
+/**
+ * \brief Storage with one lazily constructed object per thread.
+ *
+ * \param T The type of the object held by each thread; CopyConstructible.
+ */
+template <typename T>
+struct enumerable_thread_specific : public detail::no_copy {
+  typedef T value_type; /**< Type of the objects */
+  typedef T& reference; /**< Reference to an object */
+  typedef const T& const_reference; /**< Const reference to an object */
+  typedef size_t size_type; /**< Type of the size */
+
+  private:
+  static const size_t cache_line_size = 128; /**< Padding of the objects */
+
+  /**
+   * A slot. The object is placed on cache lines that hold nothing else; the
+   * slot itself is on a cache line of its own so that a thread creating its
+   * object does not disturb the threads that read theirs.
+   */
+  struct aligned_slot {
+    ALIGN128 T* volatile value; /**< The object; NULL till constructed */
+    char* raw; /**< Memory as allocated; the object lies within */
+
+    aligned_slot () : value (NULL), raw (NULL) {}
+
+    /**
+     * Allocates padded storage and copy constructs the object in it.
+     *
+     * \param [in] exemplar The object to copy.
+     */
+    void create (const T& exemplar) {
+      raw = new char [sizeof (T) + 2*cache_line_size];
+      char* aligned = raw + cache_line_size -
+        (reinterpret_cast<size_t>(raw) % cache_line_size);
+      value = new (aligned) T (exemplar);
+    }
+
+    /**
+     * Destroys the object and frees the storage.
+     */
+    void destroy () {
+      value->~T ();
+      value = NULL;
+      delete [] raw;
+      raw = NULL;
+    }
+  };
+
+  detail::taskmgr_virtual_base& taskmgr; /**< Task manager of the threads */
+  const unsigned int num_slots; /**< Number of threads including main */
+  aligned_slot* slots; /**< One slot per thread */
+  const T exemplar; /**< The slots start out as copies of this */
+
+  public:
+  /**
+   * \brief Iterates over the slots that have been constructed, in the order
+   * of the thread IDs.
+   *
+   * \param Container The (possibly const) enumerable_thread_specific.
+   * \param Value The (possibly const) type of the objects.
+   */
+  template <typename Container, typename Value>
+  struct slot_iterator {
+    typedef std::forward_iterator_tag iterator_category; /**< Category */
+    typedef Value value_type; /**< Type of the objects */
+    typedef ptrdiff_t difference_type; /**< Type of the difference */
+    typedef Value* pointer; /**< Pointer to an object */
+    typedef Value& reference; /**< Reference to an object */
+
+    private:
+    Container* container; /**< The slots being iterated over */
+    unsigned int index; /**< The current slot */
+
+    /**
+     * Moves forward to the first slot from index that has been constructed.
+     */
+    void skip_empty () {
+      while (index < container->num_slots &&
+             NULL == container->slots[index].value) ++index;
+    }
+
+    public:
+    /**
+     * \param [in] container The slots to iterate over.
+     * \param [in] index The slot to start from.
+     */
+    slot_iterator (Container* container, const unsigned int& index) :
+      container (container), index (index) { skip_empty (); }
+
+    /**
+     * Allows conversion from iterator to const_iterator.
+     *
+     * \param [in] other The iterator to copy.
+     */
+    template <typename OtherContainer, typename OtherValue>
+    slot_iterator (const slot_iterator<OtherContainer, OtherValue>& other) :
+      container (other.get_container ()), index (other.get_index ()) {}
+
+    /**
+     * \return The container being iterated over.
+     */
+    Container* get_container () const { return container; }
+
+    /**
+     * \return The position in the container.
+     */
+    unsigned int get_index () const { return index; }
+
+    /**
+     * \return The object of the current slot.
+     */
+    reference operator* () const {
+      return *(container->slots[index].value);
+    }
+
+    /**
+     * \return The object of the current slot.
+     */
+    pointer operator-> () const { return container->slots[index].value; }
+
+    /**
+     * \return The iterator moved to the next slot.
+     */
+    slot_iterator& operator++ () {
+      ++index;
+      skip_empty ();
+      return *this;
+    }
+
+    /**
+     * \return The iterator before it was moved to the next slot.
+     */
+    slot_iterator operator++ (int) {
+      slot_iterator previous (*this);
+      ++(*this);
+      return previous;
+    }
+
+    /**
+     * \param [in] other The iterator to compare with.
+     * \return true if both are at the same slot.
+     */
+    bool operator== (const slot_iterator& other) const {
+      return (index == other.index);
+    }
+
+    /**
+     * \param [in] other The iterator to compare with.
+     * \return true if the iterators are at different slots.
+     */
+    bool operator!= (const slot_iterator& other) const {
+      return (index != other.index);
+    }
+  };
+
+  typedef slot_iterator<enumerable_thread_specific, T>
+    iterator; /**< Iterator over the objects */
+  typedef slot_iterator<const enumerable_thread_specific, const T>
+    const_iterator; /**< Const iterator over the objects */
+
+  /**
+   * Constructor. The slots start out as T().
+   *
+   * \param [in,out] taskmgr The task manager whose threads use the slots.
+   */
+  explicit enumerable_thread_specific (detail::taskmgr_virtual_base& taskmgr) :
+    taskmgr (taskmgr),
+    num_slots (taskmgr.get_num_threads ()+1/*main thread*/),
+    slots (new aligned_slot [num_slots]),
+    exemplar () {}
+
+  /**
+   * Constructor
+   *
+   * \param [in,out] taskmgr The task manager whose threads use the slots.
+   * \param [in] exemplar The slots start out as copies of exemplar.
+   */
+  enumerable_thread_specific (detail::taskmgr_virtual_base& taskmgr,
+                              const T& exemplar) :
+    taskmgr (taskmgr),
+    num_slots (taskmgr.get_num_threads ()+1/*main thread*/),
+    slots (new aligned_slot [num_slots]),
+    exemplar (exemplar) {}
+
+  /**
+   * Destructor
+   */
+  ~enumerable_thread_specific () {
+    clear ();
+    delete [] slots;
+  }
+
+  /**
+   * \return The object of the calling thread; it is constructed if this is
+   * the first call from the calling thread.
+   */
+  reference local () {
+    bool exists;
+    return local (exists);
+  }
+
+  /**
+   * \param [out] exists Whether the object of the thread existed already.
+   * \return The object of the calling thread; it is constructed if this is
+   * the first call from the calling thread.
+   */
+  reference local (bool& exists) {
+    aligned_slot& my_slot = slots[taskmgr.current_thread_id ()];
+    exists = (NULL != my_slot.value);
+    if (!exists) my_slot.create (exemplar);
+    return *(my_slot.value);
+  }
+
+  /**
+   * \return The number of objects that have been constructed.
+   */
+  size_type size () const {
+    size_type num_constructed = 0;
+    for (unsigned int i=0; i<num_slots; ++i)
+      if (NULL != slots[i].value) ++num_constructed;
+    return num_constructed;
+  }
+
+  /**
+   * \return true if no thread has constructed its object.
+   */
+  bool empty () const { return (begin () == end ()); }
+
+  /**
+   * Destroys all the objects; the next local() constructs them afresh.
+   */
+  void clear () {
+    for (unsigned int i=0; i<num_slots; ++i)
+      if (NULL != slots[i].value) slots[i].destroy ();
+  }
+
+  /**
+   * \return Iterator to the first object.
+   */
+  iterator begin () { return iterator (this, 0); }
+
+  /**
+   * \return Iterator past the last object.
+   */
+  iterator end () { return iterator (this, num_slots); }
+
+  /**
+   * \return Const iterator to the first object.
+   */
+  const_iterator begin () const { return const_iterator (this, 0); }
+
+  /**
+   * \return Const iterator past the last object.
+   */
+  const_iterator end () const { return const_iterator (this, num_slots); }
+
+  /**
+   * Folds the objects together in the order of the thread IDs.
+   *
+   * \param [in] op A binary function object: T op (const T&, const T&).
+   * \return The combined value; the exemplar if there are no objects.
+   */
+  template <typename BinaryOp>
+  T combine (BinaryOp op) const {
+    const_iterator current = begin ();
+    if (end () == current) return exemplar;
+
+    T result (*current);
+    for (++current; end () != current; ++current)
+      result = op (result, *current);
+    return result;
+  }
+
+  /**
+   * Applies op to each object in the order of the thread IDs.
+   *
+   * \param [in] op A unary function object: void op (const T&).
+   */
+  template <typename UnaryOp>
+  void combine_each (UnaryOp op) const {
+    for (const_iterator current = begin (); end () != current; ++current)
+      op (*current);
+  }
+};
+
+} /* namespace pfunc */
+
+#endif // PFUNC_ENUMERABLE_THREAD_SPECIFIC_HPP
@@ -173,6 +173,140 @@ namespace pfunc { namespace detail {
       event_state = PFUNC_ACTIVE_COMPLETE;
     }
   }; /* testable event */
+
+  /**
+   * \brief Used by wait_any to find out which of a set of tasks completes 
+   * first.
+   *
+   * Each of the tasks in the set is given a pointer to the notifier, which 
+   * the task signals when it completes. The waiter sleeps (or, if nested, 
+   * executes other tasks) on the event of the notifier rather than polling 
+   * each of the tasks; the first task to complete wakes it up.
+   */
+  struct completion_notifier : public no_copy {
+    private:
+    ALIGN64 volatile int first_index; /**< Index of the first task or -1 */
+    ALIGN64 volatile int num_signals; /**< # of tasks that have signalled */
+    bool nested; /**< Decides which of the two events is used */
+    event<testable_event> testing_compl; /**< Used if nested */
+    event<waitable_event> waiting_compl; /**< Used if not nested */
+
+    public:
+    /**
+     * Constructor
+     *
+     * \param [in] nested Whether the waiter is a task (ie., can progress
+     *                    other tasks while waiting).
+     */
+    completion_notifier (const bool& nested) : first_index (-1),
+                                               num_signals (0),
+                                               nested (nested) {
+      testing_compl.reset (1);
+      waiting_compl.reset (1);
+    }
+
+    /**
+     * Called by a task of the set on its completion. Only the first call 
+     * wakes up the waiter. Note that the notifier should not be touched 
+     * after num_signals has been incremented as it might go out of scope.
+     *
+     * \param [in] index Index of the task in the set.
+     */
+    void signal (const unsigned int& index) {
+      if (-1 == pfunc_compare_and_swap_32 (&first_index, index, -1)) {
+        if (nested) testing_compl.notify ();
+        else waiting_compl.notify ();
+      }
+      pfunc_fetch_and_add_32 (&num_signals, 1);
+    }
+
+    /**
+     * Waits for the first of the tasks in the set to signal.
+     *
+     * \param [in,out] taskmgr The task manager that is running the tasks.
+     * \return Index of the task that signalled first.
+     */
+    template <typename TaskManager>
+    unsigned int wait (TaskManager& taskmgr) {
+      if (nested) taskmgr.progress_wait (testing_compl);
+      else while (-1 == first_index) waiting_compl.wait ();
+      return static_cast<unsigned int>(first_index);
+    }
+
+    /**
+     * Waits until the given number of tasks have signalled. After this, 
+     * nobody refers to the notifier.
+     *
+     * \param [in] count The number of tasks that are known to signal.
+     */
+    void drain (const unsigned int& count) {
+      while (static_cast<int>(count) != num_signals); /* spin till signalled */
+    }
+  };
+
+  /**
+   * \brief Called by a task as the very last thing it does on completion,
+   * after its events have been notified.
+   *
+   * The task is not touched after the hook is called; so, the hook is free
+   * to destroy the task. The futures use this to let go of their state
+   * once the task that runs it is done with it.
+   */
+  struct completion_hook {
+    /**
+     * Destructor
+     */
+    virtual ~completion_hook () {}
+
+    /**
+     * Called once the task has completed.
+     */
+    virtual void task_completed () = 0;
+  };
+
+  /**
+   * \brief Used by parallel_invoke to wait on a set of tasks with a single
+   * counter rather than one wait per task.
+   *
+   * Each of the tasks in the set signals the counter as the very last thing
+   * it does on completion, after its own events have been notified; so, the
+   * tasks (and the counter) can be destroyed as soon as the wait returns.
+   */
+  struct join_counter : public no_copy {
+    private:
+    ALIGN64 volatile int count; /**< # of tasks that are yet to signal */
+    event<testable_event> testing_compl; /**< Notified when count hits 0 */
+
+    public:
+    /**
+     * Constructor
+     *
+     * \param [in] count The number of tasks that will signal.
+     */
+    join_counter (const unsigned int& count) :
+                      count (static_cast<int>(count)) {
+      testing_compl.reset (1);
+      if (0 == count) testing_compl.notify ();
+    }
+
+    /**
+     * Called by a task of the set on its completion. The counter should not
+     * be touched after this as it might go out of scope.
+     */
+    void signal () {
+      if (1 == pfunc_fetch_and_add_32 (&count, -1)) testing_compl.notify ();
+    }
+
+    /**
+     * Waits (executing other tasks) until all the tasks have signalled.
+     *
+     * \param [in,out] taskmgr The task manager that is running the tasks.
+     */
+    template <typename TaskManager>
+    void wait (TaskManager& taskmgr) {
+      taskmgr.progress_wait (testing_compl);
+    }
+  };
 } /* namespace detail */ } /* namespace pfunc */
 
 #endif // PFUNC_EVENT_HPP
@@ -15,12 +15,13 @@ namespace pfunc { namespace detail {
   /**
    * Specialization of task_queue_set for FIFO queues.
    */
-  template <typename ValueType>
-  struct task_queue_set <fifoS, ValueType> {
+  template <typename ValueType, typename LockType>
+  struct task_queue_set <fifoS, ValueType, LockType> {
     typedef std::queue<ValueType*> queue_type; /**< queue type */
     typedef typename queue_type::value_type value_type; /**< value type */
     typedef unsigned int queue_index_type; /**< type to index into the list */
-    typedef task_queue_set_data<queue_type> data_type; /**< task_queue_set data */
+    typedef task_queue_set_data<queue_type, LockType> data_type; /**< task_queue_set data */
+    typedef typename data_type::lock_type lock_type; /**< lock type */
 
     ALIGN128 data_type* data; /**< Holds all the data required */
     ALIGN128 unsigned int num_queues; /**< Number of queues */
@@ -74,7 +75,7 @@ namespace pfunc { namespace detail {
 
       PFUNC_START_TRY_BLOCK()
       queue_type& queue = data[queue_num].queue;
-      mutex& lock = data[queue_num].lock;
+      lock_type& lock = data[queue_num].lock;
 
       lock.lock ();
       if (!queue.empty () && 
@@ -132,7 +133,7 @@ namespace pfunc { namespace detail {
     void put (queue_index_type queue_num, const value_type& value) {
       PFUNC_START_TRY_BLOCK()
       queue_type& queue = data[queue_num].queue;
-      mutex& lock = data[queue_num].lock;
+      lock_type& lock = data[queue_num].lock;
 
       lock.lock ();
       queue.push (value);
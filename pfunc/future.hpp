@@ -0,0 +1,686 @@
+#ifndef PFUNC_FUTURE_HPP
+#define PFUNC_FUTURE_HPP
+
+/**
+ * \file future.hpp
+ * \brief Implementation of value-returning futures for PFUNC
+ * \author Prabhanjan Kambadur
+ *
+ * A future is the handle to the value that a spawned function object
+ * computes. Continuations can be chained on to a future using then(); a
+ * continuation is not spawned until its predecessors have completed, so no
+ * thread is tied up waiting for them. when_all() combines several futures
+ * into one.
+ *
+ * The function objects used with futures must define result_type (just like
+ * std::unary_function), which must be default constructible and assignable:
+ *
+ *   struct compute {
+ *     typedef double result_type;
+ *     double operator() () const;
+ *   };
+ *   struct scale {
+ *     typedef double result_type;
+ *     double operator() (const double&) const;
+ *   };
+ *
+ *   pfunc::future<double> value = pfunc::spawn (taskmgr, compute ());
+ *   pfunc::future<double> scaled = value.then (scale ());
+ *   double result = scaled.get ();
+ *
+ * NOTE: As with parallel_for, the Functor used in the PFunc instance must be
+ * pfunc::use_default.
+ *
+ * NOTE: Dropping a future does not wait for its task; the task holds on to
+ * the shared state till it has completed, and the state goes away once
+ * both the task and the last copy of the future are done with it. As such,
+ * futures and their continuations can be dropped without calling get(),
+ * but the task manager has to outlive the tasks.
+ */
+#include <cassert>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <pfunc/pfunc.hpp>
+
+namespace pfunc {
+
+namespace detail {
+
+/**
+ * \brief Hides the type of the task manager (and hence, the type of the
+ * task) from the futures.
+ */
+struct future_launcher : public no_copy {
+  private:
+  volatile int ref_count; /**< Number of futures that use this launcher */
+
+  public:
+  /**
+   * Constructor
+   */
+  future_launcher () : ref_count (1) {}
+
+  /**
+   * Destructor
+   */
+  virtual ~future_launcher () {}
+
+  /**
+   * \return A new task handle.
+   */
+  virtual void* create_task () = 0;
+
+  /**
+   * \param [in] task The task handle to be destroyed.
+   */
+  virtual void destroy_task (void* task) = 0;
+
+  /**
+   * \param [in,out] task The task handle to use.
+   * \param [in] work The work to be spawned.
+   * \param [in,out] hook Called once the task has completed.
+   */
+  virtual void spawn (void* task,
+                      virtual_functor& work,
+                      completion_hook* hook) = 0;
+
+  /**
+   * \param [in,out] task The task to be waited on.
+   */
+  virtual void wait (void* task) = 0;
+
+  /**
+   * Adds a reference to the launcher.
+   */
+  void acquire () { pfunc_fetch_and_add_32 (&ref_count, 1); }
+
+  /**
+   * Drops a reference to the launcher; destroys it when there are no more.
+   */
+  void release () {
+    if (1 == pfunc_fetch_and_add_32 (&ref_count, -1)) delete this;
+  }
+};
+
+/**
+ * \brief Spawns the tasks of the futures on a particular task manager.
+ *
+ * \param TaskManager Type of the task manager.
+ */
+template <typename TaskManager>
+struct future_launcher_impl : public future_launcher {
+  typedef typename TaskManager::task task_type; /**< Type of the task */
+  typedef typename TaskManager::attribute attribute; /**< Type of attribute */
+
+  private:
+  TaskManager& taskmgr; /**< The task manager to spawn the tasks on */
+  attribute attr; /**< The attribute with which all tasks are spawned */
+
+  public:
+  /**
+   * Constructor
+   *
+   * \param [in] taskmgr The task manager to spawn the tasks on.
+   * \param [in] attr The attribute with which the tasks are spawned.
+   */
+  future_launcher_impl (TaskManager& taskmgr,
+                        const attribute& attr) : taskmgr (taskmgr),
+                                                 attr (attr) {}
+
+  void* create_task () { return new task_type; }
+
+  void destroy_task (void* task) { delete static_cast<task_type*>(task); }
+
+  void spawn (void* task, virtual_functor& work, completion_hook* hook) {
+    static_cast<task_type*>(task)->set_completion_hook (hook);
+    pfunc::spawn (taskmgr, *static_cast<task_type*>(task), attr, work);
+  }
+
+  void wait (void* task) {
+    pfunc::wait (taskmgr, *static_cast<task_type*>(task));
+  }
+};
+
+/**
+ * \brief The state that is shared between all the copies of a future.
+ *
+ * The state is also the work that is spawned; it is spawned once all its
+ * predecessors have completed. On completion, it launches its successors.
+ * The task that runs the state holds a reference to it, which is dropped
+ * only once the task is done with the state (see completion_hook); so, the
+ * state is never destroyed while its task is running and dropping the last
+ * reference never has to wait.
+ */
+struct future_state_base : public virtual_functor,
+                           public completion_hook,
+                           public no_copy {
+  private:
+  future_launcher* launcher; /**< Used to spawn and wait on the task */
+  void* task; /**< The task that runs this state */
+  volatile int ref_count; /**< Number of references to this state */
+  volatile int num_pending; /**< # of predecessors that are yet to complete */
+  volatile int wait_state; /**< Not waited, being waited or waited upon */
+  bool completed; /**< Whether the successors have been launched */
+  mutex state_lock; /**< Protects completed and successors */
+  std::vector<future_state_base*> predecessors; /**< What we depend on */
+  std::vector<future_state_base*> successors; /**< What depends on us */
+  PFUNC_DEFINE_EXCEPT_PTR() /**< The exception thrown by the work, if any */
+
+  /**
+   * Values of wait_state.
+   */
+  enum { not_waited, being_waited, waited };
+
+  /**
+   * Spawns the task; the task holds a reference till it has completed.
+   */
+  void launch () {
+    acquire ();
+    launcher->spawn (task, *this, this);
+  }
+
+  /**
+   * Called by each of the predecessors on completion.
+   */
+  void predecessor_done () {
+    if (1 == pfunc_fetch_and_add_32 (&num_pending, -1)) launch ();
+  }
+
+  /**
+   * \param [in,out] succ The state to be launched when we complete.
+   */
+  void add_successor (future_state_base* succ) {
+    succ->acquire ();
+    state_lock.lock ();
+    if (!completed) {
+      successors.push_back (succ);
+      state_lock.unlock ();
+    } else {
+      state_lock.unlock ();
+      succ->predecessor_done ();
+      succ->release ();
+    }
+  }
+
+  /**
+   * Launches the successors; no new successors are added after this.
+   */
+  void complete () {
+    state_lock.lock ();
+    completed = true;
+    state_lock.unlock ();
+
+    for (unsigned int i=0; i<successors.size (); ++i) {
+      successors[i]->predecessor_done ();
+      successors[i]->release ();
+    }
+    successors.clear ();
+  }
+
+  protected:
+  /**
+   * Computes the value of the future. Called only if none of the
+   * predecessors failed.
+   */
+  virtual void compute () = 0;
+
+  /**
+   * \param [in] index Index of the predecessor.
+   * \return The predecessor.
+   */
+  future_state_base* get_predecessor (const unsigned int& index) const {
+    return predecessors[index];
+  }
+
+  public:
+  /**
+   * Constructor
+   *
+   * \param [in,out] launcher Used to spawn and wait on the task.
+   */
+  future_state_base (future_launcher* launcher) : launcher (launcher),
+                                                  task (NULL),
+                                                  ref_count (1),
+                                                  num_pending (0),
+                                                  wait_state (not_waited),
+                                                  completed (false)
+                                                  PFUNC_EXCEPT_PTR_INIT() {
+    launcher->acquire ();
+    task = launcher->create_task ();
+  }
+
+  /**
+   * Destructor
+   */
+  virtual ~future_state_base () {
+    launcher->destroy_task (task);
+    launcher->release ();
+    for (unsigned int i=0; i<predecessors.size (); ++i)
+      predecessors[i]->release ();
+    PFUNC_EXCEPT_PTR_CLEAR()
+  }
+
+  /**
+   * \return The launcher, so that continuations spawn on the same instance.
+   */
+  future_launcher* get_launcher () const { return launcher; }
+
+  /**
+   * Adds a predecessor; must be called before start ().
+   *
+   * \param [in,out] pred The state that has to complete before us.
+   */
+  void add_predecessor (future_state_base* pred) {
+    pred->acquire ();
+    predecessors.push_back (pred);
+    ++num_pending;
+  }
+
+  /**
+   * Spawns the task if there are no predecessors. Otherwise, the last
+   * predecessor to complete spawns the task.
+   */
+  void start () {
+    if (predecessors.empty ()) launch ();
+    else {
+      for (unsigned int i=0; i<predecessors.size (); ++i)
+        predecessors[i]->add_successor (this);
+    }
+  }
+
+  /**
+   * Waits for the task to complete. As the predecessors launch the task,
+   * they are waited upon first. A task can only be waited upon once; so,
+   * the first caller claims the wait and any others (for example, threads
+   * calling get() on copies of the same future at the same time) spin
+   * until it is done.
+   */
+  void wait () {
+    if (not_waited == pfunc_compare_and_swap_32 (&wait_state,
+                                                 being_waited,
+                                                 not_waited)) {
+      for (unsigned int i=0; i<predecessors.size (); ++i)
+        predecessors[i]->wait ();
+      launcher->wait (task);
+      pfunc_fetch_and_store_32 (&wait_state, waited);
+    } else {
+      while (waited != wait_state); /* spin till the first caller is done */
+    }
+  }
+
+  /**
+   * Rethrows the exception that was thrown while computing the value.
+   */
+  void rethrow_failure () { PFUNC_CHECK_AND_RETHROW() }
+
+  /**
+   * Adds a reference to the state.
+   */
+  void acquire () { pfunc_fetch_and_add_32 (&ref_count, 1); }
+
+  /**
+   * Drops a reference to the state; destroys it when there are no more. As
+   * the task holds a reference till it has completed, this never waits.
+   */
+  void release () {
+    if (1 == pfunc_fetch_and_add_32 (&ref_count, -1)) delete this;
+  }
+
+  /**
+   * Called by the task once it has completed; drops its reference.
+   */
+  void task_completed () { release (); }
+
+  /**
+   * Computes the value (unless a predecessor failed) and launches the
+   * successors.
+   */
+  void operator() (void) {
+    PFUNC_START_TRY_BLOCK()
+    for (unsigned int i=0; i<predecessors.size (); ++i)
+      predecessors[i]->rethrow_failure ();
+    compute ();
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CATCH_AND_STORE(future_state,operator())
+
+    complete ();
+  }
+};
+
+/**
+ * \brief Shared state of a future that holds a value of type T.
+ */
+template <typename T>
+struct future_state : public future_state_base {
+  protected:
+  T value; /**< The value that is computed */
+
+  public:
+  /**
+   * Constructor
+   *
+   * \param [in,out] launcher Used to spawn and wait on the task.
+   */
+  future_state (future_launcher* launcher) : future_state_base (launcher),
+                                             value () {}
+
+  /**
+   * \return The value; valid only after the state has been waited upon.
+   */
+  const T& get_value () const { return value; }
+};
+
+/**
+ * \brief Computes the value of a future by invoking a function object.
+ */
+template <typename Function>
+struct future_call :
+  public future_state<typename Function::result_type> {
+  private:
+  Function func; /**< The function object to invoke */
+
+  protected:
+  void compute () { this->value = func (); }
+
+  public:
+  /**
+   * Constructor
+   *
+   * \param [in,out] launcher Used to spawn and wait on the task.
+   * \param [in] func The function object to invoke.
+   */
+  future_call (future_launcher* launcher, const Function& func) :
+    future_state<typename Function::result_type> (launcher), func (func) {}
+};
+
+/**
+ * \brief Computes the value of a future by invoking a function object on
+ * the value of another future.
+ */
+template <typename T, typename Function>
+struct future_continuation :
+  public future_state<typename Function::result_type> {
+  private:
+  Function func; /**< The function object to invoke */
+
+  protected:
+  void compute () {
+    this->value = func (static_cast<future_state<T>*>
+                           (this->get_predecessor (0))->get_value ());
+  }
+
+  public:
+  /**
+   * Constructor
+   *
+   * \param [in,out] pred The future whose value is passed to func.
+   * \param [in] func The function object to invoke.
+   */
+  future_continuation (future_state<T>* pred, const Function& func) :
+    future_state<typename Function::result_type> (pred->get_launcher ()),
+    func (func) {
+    this->add_predecessor (pred);
+  }
+};
+
+/**
+ * \brief Collects the values of a set of futures into a vector.
+ */
+template <typename T>
+struct future_all : public future_state<std::vector<T> > {
+  private:
+  unsigned int num_futures; /**< Number of futures being collected */
+
+  protected:
+  void compute () {
+    this->value.resize (num_futures);
+    for (unsigned int i=0; i<num_futures; ++i)
+      this->value[i] = static_cast<future_state<T>*>
+                         (this->get_predecessor (i))->get_value ();
+  }
+
+  public:
+  /**
+   * Constructor; add the futures as predecessors.
+   *
+   * \param [in,out] launcher Used to spawn and wait on the task.
+   * \param [in] num_futures Number of futures being collected.
+   */
+  future_all (future_launcher* launcher, const unsigned int& num_futures) :
+    future_state<std::vector<T> > (launcher), num_futures (num_futures) {}
+};
+
+/**
+ * \brief Collects the values of two futures into a pair.
+ */
+template <typename T1, typename T2>
+struct future_pair : public future_state<std::pair<T1, T2> > {
+  protected:
+  void compute () {
+    this->value.first = static_cast<future_state<T1>*>
+                          (this->get_predecessor (0))->get_value ();
+    this->value.second = static_cast<future_state<T2>*>
+                          (this->get_predecessor (1))->get_value ();
+  }
+
+  public:
+  /**
+   * Constructor
+   *
+   * \param [in,out] first The future that gives the first value.
+   * \param [in,out] second The future that gives the second value.
+   */
+  future_pair (future_state<T1>* first, future_state<T2>* second) :
+    future_state<std::pair<T1, T2> > (first->get_launcher ()) {
+    this->add_predecessor (first);
+    this->add_predecessor (second);
+  }
+};
+
+} /* namespace detail */
+
+/**
+ * \brief Handle to a value that is being computed by a task.
+ *
+ * Futures are cheap to copy; all the copies refer to the same value.
+ *
+ * \param T Type of the value.
+ */
+template <typename T>
+struct future {
+  typedef T value_type; /**< Type of the value */
+
+  private:
+  detail::future_state<T>* state; /**< The shared state */
+
+  public:
+  /**
+   * Default constructor; the future is not valid.
+   */
+  future () : state (NULL) {}
+
+  /**
+   * Constructor; takes over the reference to the state.
+   *
+   * \param [in] state The shared state.
+   */
+  explicit future (detail::future_state<T>* state) : state (state) {}
+
+  /**
+   * Copy constructor
+   *
+   * \param [in] other The future to copy from.
+   */
+  future (const future& other) : state (other.state) {
+    if (NULL != state) state->acquire ();
+  }
+
+  /**
+   * Assignment operator
+   *
+   * \param [in] other The future to copy from.
+   * \return This future.
+   */
+  future& operator= (const future& other) {
+    if (NULL != other.state) other.state->acquire ();
+    if (NULL != state) state->release ();
+    state = other.state;
+    return *this;
+  }
+
+  /**
+   * Destructor
+   */
+  ~future () { if (NULL != state) state->release (); }
+
+  /**
+   * \return true if the future refers to a value.
+   */
+  bool valid () const { return (NULL != state); }
+
+  /**
+   * Waits for the value to be computed.
+   */
+  void wait () const {
+    assert (NULL != state);
+    PFUNC_START_TRY_BLOCK()
+    state->wait ();
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CXX_CATCH_AND_RETHROW()
+  }
+
+  /**
+   * Waits for the value to be computed. If computing the value (or that of
+   * any of the futures that it depends on) threw, the exception is rethrown.
+   *
+   * \return The value.
+   */
+  const T& get () const {
+    assert (NULL != state);
+    PFUNC_START_TRY_BLOCK()
+    state->wait ();
+    state->rethrow_failure ();
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CXX_CATCH_AND_RETHROW()
+    return state->get_value ();
+  }
+
+  /**
+   * Chains a continuation. The continuation is spawned on the same task
+   * manager (and with the same attribute) once this future's value has been
+   * computed; nobody waits in the meanwhile.
+   *
+   * \param [in] func The function object to invoke on the value. Its
+   *                  result_type is the type of the value of the returned
+   *                  future.
+   * \return The future for the value of the continuation; not valid if this
+   *         future is not valid.
+   */
+  template <typename Function>
+  future<typename Function::result_type> then (const Function& func) const {
+    if (NULL == state) return future<typename Function::result_type> ();
+    detail::future_continuation<T, Function>* continuation =
+      new detail::future_continuation<T, Function> (state, func);
+    continuation->start ();
+    return future<typename Function::result_type> (continuation);
+  }
+
+  /**
+   * \return The shared state; used to compose futures.
+   */
+  detail::future_state<T>* get_state () const { return state; }
+};
+
+/**
+ * Spawns a function object and returns the future for its value.
+ *
+ * \param [in] tmanager The task manager that is running the tasks.
+ * \param [in] attr Attribute with which to spawn this (and all continuations
+ *                  of this) task.
+ * \param [in] func The function object to invoke. Its result_type is the type
+ *                  of the value of the future.
+ * \return The future for the value.
+ */
+template <typename TaskManager, typename Function>
+static inline future<typename Function::result_type>
+spawn (TaskManager& tmanager,
+       const typename TaskManager::attribute& attr,
+       const Function& func) {
+  detail::future_launcher* launcher =
+    new detail::future_launcher_impl<TaskManager> (tmanager, attr);
+  detail::future_call<Function>* call =
+    new detail::future_call<Function> (launcher, func);
+  launcher->release (); /* call holds on to the launcher now */
+  call->start ();
+  return future<typename Function::result_type> (call);
+}
+
+/**
+ * Spawns a function object with the default attribute and returns the
+ * future for its value.
+ *
+ * \param [in] tmanager The task manager that is running the tasks.
+ * \param [in] func The function object to invoke. Its result_type is the type
+ *                  of the value of the future.
+ * \return The future for the value.
+ */
+template <typename TaskManager, typename Function>
+static inline future<typename Function::result_type>
+spawn (TaskManager& tmanager,
+       const Function& func) {
+  return pfunc::spawn (tmanager, typename TaskManager::attribute (), func);
+}
+
+/**
+ * Combines a non-empty set of futures into a future for all their values.
+ * Nobody waits for the futures; the values are collected once the last of
+ * the futures completes.
+ *
+ * \param [in] first First of the futures.
+ * \param [in] last End marker for the futures (true last+1).
+ * \return The future for the vector of values, in the order of the futures;
+ *         not valid if there are no futures or if any of them is not valid.
+ */
+template <typename ForwardIterator>
+static inline future<std::vector<typename std::iterator_traits
+                                   <ForwardIterator>::value_type::value_type> >
+when_all (ForwardIterator first, ForwardIterator last) {
+  typedef typename
+    std::iterator_traits<ForwardIterator>::value_type::value_type value_type;
+
+  if (first == last) return future<std::vector<value_type> > ();
+  for (ForwardIterator current=first; current != last; ++current)
+    if (!(*current).valid ()) return future<std::vector<value_type> > ();
+
+  detail::future_all<value_type>* all =
+    new detail::future_all<value_type>
+        ((*first).get_state ()->get_launcher (),
+         static_cast<unsigned int>(std::distance (first, last)));
+  for (; first != last; ++first) all->add_predecessor ((*first).get_state ());
+  all->start ();
+  return future<std::vector<value_type> > (all);
+}
+
+/**
+ * Combines two futures into a future for both their values.
+ *
+ * \param [in] first The future that gives the first value.
+ * \param [in] second The future that gives the second value.
+ * \return The future for the pair of values; not valid if either of the
+ *         futures is not valid.
+ */
+template <typename T1, typename T2>
+static inline future<std::pair<T1, T2> >
+when_all (const future<T1>& first, const future<T2>& second) {
+  if (!first.valid () || !second.valid ()) 
+    return future<std::pair<T1, T2> > ();
+  detail::future_pair<T1, T2>* both =
+    new detail::future_pair<T1, T2> (first.get_state (), second.get_state ());
+  both->start ();
+  return future<std::pair<T1, T2> > (both);
+}
+
+} /* namespace pfunc */
+
+#endif // PFUNC_FUTURE_HPP
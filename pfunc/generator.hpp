@@ -28,6 +28,9 @@ namespace pfunc {
 
   /** Using default value for the functor template parameter */
   struct func_tag : public default_tag {};
+
+  /** Using default value for the queue lock template parameter */
+  struct lock_tag : public default_tag {};
   
   /**
    * Template version of the default type for each of the template
@@ -50,6 +53,31 @@ namespace pfunc {
     typedef virtual_functor type; /** Default functor type */
   };
 
+  /** Specialization for queue lock default */
+  template <> struct default_type <lock_tag> { 
+    typedef mutex type; /** Default queue lock type */
+  };
+
+  /**
+   * This structure can be used by developers if they wish the default types
+   * to be used for instantiating the library. Depending on the position of 
+   * this type, we will use the appropriate default value for that param.
+   */
+  struct use_default {};
+
+  /**
+   * Picks the lock that guards the task queues; use_default gives the
+   * default one.
+   */
+  template <typename QueueLock> struct queue_lock_type {
+    typedef QueueLock type; /** User picked queue lock type */
+  };
+
+  /** Specialization for using the default queue lock */
+  template <> struct queue_lock_type <use_default> {
+    typedef default_type<lock_tag>::type type; /** Default queue lock type */
+  };
+
 /**
  * \def Generate the typedefs for the related types of the given 
  * library instance description. 
@@ -57,25 +85,31 @@ namespace pfunc {
 #define GENERATE_PFUNC_TYPES() \
     typedef detail::attribute<priority_type, compare_type>  attribute; \
     typedef detail::task <attribute, functor> task; \
-    typedef detail::taskmgr <task_queue_set, task> taskmgr; \
+    typedef typename queue_lock_type<QueueLock>::type queue_lock; \
+    typedef detail::taskmgr <task_queue_set, task, queue_lock> taskmgr; \
     typedef detail::group group;
 
   /**
    * Generator structure that is specialized to produce the required 
-   * library instance description. There are three explicit template 
+   * library instance description. There are four explicit template 
    * parameters:
    * 1. SchedPolicyName: The scheduling policy to be used.
    * 2. Compare: The comparison function to use in case the scheduling policy
    *              requires ordering of tasks.
    * 3. Functor: The function object that will be executed.
+   * 4. QueueLock: The lock that guards each of the task queues. Defaults to
+   *               pfunc::mutex; pfunc::ticket_lock and pfunc::mcs_lock (see
+   *               queue_lock.hpp) hold up better when there are many
+   *               thieves.
    *
-   * There is a fourth, implicit template parameter, "Priority" that denotes
+   * There is a fifth, implicit template parameter, "Priority" that denotes
    * the type of the priority associated with each task. This is extracted 
    * as a nested type from the "Compare" type.
    */
   template <typename SchedPolicyName,
             typename Compare,
-            typename Functor>
+            typename Functor,
+            typename QueueLock = use_default>
   struct generator {
     typedef SchedPolicyName task_queue_set; /** typedef for the task_queue_set */
     typedef Compare compare_type; /** typedef for the compare_type */
@@ -85,16 +119,9 @@ namespace pfunc {
     GENERATE_PFUNC_TYPES()
   };
 
-  /**
-   * This structure can be used by developers if they wish the default types
-   * to be used for instantiating the library. Depending on the position of 
-   * this type, we will use the appropriate default value for that param.
-   */
-  struct use_default {};
-
   /** Specialization for using all default values */
-  template <> 
-  struct generator <use_default, use_default, use_default> {
+  template <typename QueueLock> 
+  struct generator <use_default, use_default, use_default, QueueLock> {
     typedef default_type<sched_tag>::type task_queue_set;/** typedef for the task_queue_set */
     typedef default_type<comp_tag>::type compare_type;/** typedef for the compare_type */
     typedef compare_type::first_argument_type priority_type;/* typedef for the priority_type */
@@ -104,8 +131,8 @@ namespace pfunc {
   };
 
   /** Specialization for using user picked scheduling policy */
-  template <typename SchedPolicyName>
-  struct generator <SchedPolicyName, use_default, use_default> {
+  template <typename SchedPolicyName, typename QueueLock>
+  struct generator <SchedPolicyName, use_default, use_default, QueueLock> {
     typedef SchedPolicyName task_queue_set;/** typedef for the task_queue_set */
     typedef typename default_type<comp_tag>::type compare_type;/** typedef for the compare_type */
     typedef typename compare_type::first_argument_type priority_type;/* typedef for the priority_type */
@@ -116,8 +143,8 @@ namespace pfunc {
 
 
   /** Specialization for using user picked comparison operator */
-  template <typename Compare>
-  struct generator <use_default, Compare, use_default> {
+  template <typename Compare, typename QueueLock>
+  struct generator <use_default, Compare, use_default, QueueLock> {
     typedef default_type<sched_tag>::type task_queue_set;/** typedef for the task_queue_set */
     typedef Compare compare_type;/** typedef for the compare_type */
     typedef typename compare_type::first_argument_type priority_type;/* typedef for the priority_type */
@@ -128,8 +155,8 @@ namespace pfunc {
 
 
   /** Specialization for using user picked functor */
-  template <typename Functor>
-  struct generator <use_default, use_default, Functor> {
+  template <typename Functor, typename QueueLock>
+  struct generator <use_default, use_default, Functor, QueueLock> {
     typedef default_type<sched_tag>::type task_queue_set;/** typedef for the task_queue_set */
     typedef default_type<comp_tag>::type compare_type;/** typedef for the compare_type */
     typedef compare_type::first_argument_type priority_type;/* typedef for the priority_type */
@@ -140,8 +167,8 @@ namespace pfunc {
 
 
   /** Specialization for using user picked scheduling policy and compare */
-  template <typename SchedPolicyName, typename Compare>
-  struct generator <SchedPolicyName, Compare, use_default> {
+  template <typename SchedPolicyName, typename Compare, typename QueueLock>
+  struct generator <SchedPolicyName, Compare, use_default, QueueLock> {
     typedef SchedPolicyName task_queue_set;/** typedef for the task_queue_set */
     typedef Compare compare_type;/** typedef for the compare_type */
     typedef typename compare_type::first_argument_type priority_type;/* typedef for the priority_type */
@@ -152,8 +179,8 @@ namespace pfunc {
 
 
   /** Specialization for using user picked scheduling policy and functor */
-  template <typename SchedPolicyName, typename Functor>
-  struct generator <SchedPolicyName, use_default, Functor> {
+  template <typename SchedPolicyName, typename Functor, typename QueueLock>
+  struct generator <SchedPolicyName, use_default, Functor, QueueLock> {
     typedef SchedPolicyName task_queue_set;/** typedef for the task_queue_set */
     typedef default_type<comp_tag>::type compare_type;/** typedef for the compare_type */
     typedef compare_type::first_argument_type priority_type;/* typedef for the priority_type */
@@ -164,8 +191,8 @@ namespace pfunc {
 
 
   /** Specialization for using user picked compare op and functor */
-  template <typename Compare, typename Functor>
-  struct generator <use_default, Compare, Functor> {
+  template <typename Compare, typename Functor, typename QueueLock>
+  struct generator <use_default, Compare, Functor, QueueLock> {
     typedef default_type<sched_tag>::type task_queue_set;/** typedef for the task_queue_set */
     typedef Compare compare_type;/** typedef for the compare_type */
     typedef typename compare_type::first_argument_type priority_type;/* typedef for the priority_type */
@@ -11,9 +11,55 @@
 #include <pfunc/exception.hpp>
 #include <pfunc/mutex.hpp>
 #include <pfunc/pfunc_atomics.h>
+#include <pfunc/environ.hpp>
+#include <pfunc/queue_lock.hpp>
+
+#if PFUNC_HAVE_LIMITS_H == 1
+#include <limits.h>
+#else
+#define INT_MAX 0x0FFFFFFF
+#endif
+
+#if PFUNC_HAVE_FUTEX == 1
+#include <pfunc/futex.h>
+#endif
 
 namespace pfunc { namespace detail {
 
+/** # of times the waiting barrier polls the phase before going to sleep */
+static const unsigned int PFUNC_BARRIER_SPIN_COUNT = 1 << 16;
+
+/** # of polls between two attempts to steal in the waiting barrier */
+static const unsigned int PFUNC_BARRIER_STEAL_INTERVAL = 64;
+
+/** Fan-in of each node of the combining tree barrier */
+static const unsigned int PFUNC_BARRIER_FAN_IN = 4;
+
+/** Maximum number of rounds of the dissemination barrier (log2 of size) */
+static const unsigned int PFUNC_BARRIER_MAX_ROUNDS = 32;
+
+/**
+ * \brief Per-member state of the tree and the dissemination barriers.
+ *
+ * Each member spins only on its own flags; padding each member to its own 
+ * cache line ensures that spinning members do not disturb each other.
+ */
+struct barrier_member {
+  ALIGN128 volatile bool flags[2][PFUNC_BARRIER_MAX_ROUNDS]; /**< Signals */
+  unsigned int parity; /**< Set of flags used in this episode */
+  bool sense; /**< Value that signals the completion of this episode */
+};
+
+/**
+ * \brief Node of the combining tree barrier.
+ */
+struct barrier_node {
+  ALIGN128 volatile int32_t count; /**< # of children yet to arrive */
+  int32_t fan_in; /**< # of children of this node */
+  barrier_node* parent; /**< NULL for the root */
+  volatile bool sense; /**< Flipped when everyone below has arrived */
+};
+
 /**
  * \brief Implements a group structure across which barriers can be executed.
  */
@@ -21,13 +67,115 @@ struct group {
   private:
   ALIGN128 volatile bool barrier_phase; /**< Toggle of phases */
   ALIGN128 volatile unsigned int barrier_count; /**< # tasks active in barrier*/
+  ALIGN128 volatile int wait_phase; /**< Phase of the waiting barrier */
+  volatile int num_sleepers; /**< # tasks asleep in the waiting barrier */
   volatile unsigned int rank_token; /**< Gives out ranks to tasks */
   unsigned int group_id; /**< For debugging purposes */
   unsigned int group_size; /**< Number of tasks in this group */
   mutex group_lock; /**< Lock for implementing the barrier */
   unsigned int type_of_barrier; /**< Type of the barrier to be used */
+  volatile bool cancelled; /**< Whether the remaining tasks should be skipped */
+  barrier_member* members; /**< Per-rank state for tree/dissemination */
+  barrier_node* tree_nodes; /**< Nodes of the combining tree */
+  unsigned int num_tree_nodes; /**< # of nodes of the combining tree */
+  unsigned int num_rounds; /**< # of rounds of the dissemination barrier */
   PFUNC_DEFINE_EXCEPT_PTR() /**< The exception holder */
 
+  /**
+   * Releases the state held by the tree and the dissemination barriers.
+   */
+  void clear_barrier_state () {
+    if (NULL != members) delete [] members;
+    if (NULL != tree_nodes) delete [] tree_nodes;
+    members = NULL;
+    tree_nodes = NULL;
+    num_tree_nodes = 0;
+    num_rounds = 0;
+  }
+
+  /**
+   * Sets up the state needed by the tree and the dissemination barriers. 
+   * Has to be called whenever the size or the type of barrier changes; 
+   * obviously, this should not happen while a barrier is in progress.
+   */
+  void build_barrier_state () {
+    clear_barrier_state ();
+    if (group_size <= 1 || (BARRIER_TREE != type_of_barrier && 
+                            BARRIER_DISSEMINATION != type_of_barrier)) return;
+
+    members = new barrier_member [group_size];
+
+    if (BARRIER_DISSEMINATION == type_of_barrier) {
+      while ((1u << num_rounds) < group_size) ++num_rounds;
+    } else {
+      /* Count the nodes; the leaves are at the beginning of the array */
+      unsigned int num_nodes = 0;
+      for (unsigned int width=group_size; width>1; num_nodes += width) 
+        width = (width + PFUNC_BARRIER_FAN_IN - 1) / PFUNC_BARRIER_FAN_IN;
+
+      tree_nodes = new barrier_node [num_nodes];
+      unsigned int level_start = 0;
+      for (unsigned int below=group_size; below>1; ) {
+        const unsigned int width = 
+          (below + PFUNC_BARRIER_FAN_IN - 1) / PFUNC_BARRIER_FAN_IN;
+        for (unsigned int i=0; i<width; ++i) {
+          barrier_node& node = tree_nodes[level_start+i];
+          const unsigned int remaining = below - i*PFUNC_BARRIER_FAN_IN;
+          node.fan_in = (remaining < PFUNC_BARRIER_FAN_IN) ? 
+                           remaining : PFUNC_BARRIER_FAN_IN;
+          node.parent = (1 < width) ? 
+            (tree_nodes + level_start + width + (i/PFUNC_BARRIER_FAN_IN)) :
+            NULL;
+        }
+        level_start += width;
+        below = width;
+      }
+      num_tree_nodes = num_nodes;
+    }
+
+    reset_barrier_state ();
+  }
+
+  /**
+   * Puts all the barriers back in the state they start out in; a barrier
+   * that was cut short by a cancellation leaves partial counts behind.
+   * Obviously, this should not happen while a barrier is in progress.
+   */
+  void reset_barrier_state () {
+    barrier_count = 0;
+    if (NULL != members) {
+      for (unsigned int i=0; i<group_size; ++i) {
+        for (unsigned int j=0; j<PFUNC_BARRIER_MAX_ROUNDS; ++j) 
+          members[i].flags[0][j] = members[i].flags[1][j] = false;
+        members[i].parity = 0;
+        members[i].sense = true;
+      }
+    }
+    for (unsigned int i=0; i<num_tree_nodes; ++i) {
+      tree_nodes[i].count = tree_nodes[i].fan_in;
+      tree_nodes[i].sense = false;
+    }
+  }
+
+  /**
+   * Arrive at a node of the combining tree. The last one to arrive at a 
+   * node moves up to the parent and, once the parent is released, releases
+   * everyone that is waiting on this node.
+   *
+   * \param [in,out] node The node that we are arriving at.
+   * \param [in] sense The value that signals the release of the node.
+   */
+  void tree_arrive (barrier_node* node, const bool sense) {
+    if (1 == pfunc_fetch_and_add_32 (&(node->count), -1)) {
+      if (NULL != node->parent) tree_arrive (node->parent, sense);
+      node->count = node->fan_in;
+      pfunc_mem_fence ();
+      node->sense = sense;
+    } else {
+      while (sense != node->sense && !cancelled); /* spin until released */
+    }
+  }
+
   public:
   /** 
    * Implements the spinning barrier.
@@ -43,7 +191,8 @@ struct group {
       group_lock.unlock();
     } else {
       group_lock.unlock();
-      while (my_phase == barrier_phase); /* spin until  different phase */
+      /* spin until different phase */
+      while (my_phase == barrier_phase && !cancelled);
     }
     PFUNC_END_TRY_BLOCK()
     PFUNC_CATCH_AND_RETHROW(group,barrier_spin)
@@ -67,12 +216,109 @@ struct group {
       group_lock.unlock();
     } else {
       group_lock.unlock();
-      while (my_phase == barrier_phase) taskmgr.progress_barrier ();
+      while (my_phase == barrier_phase && !cancelled) 
+        taskmgr.progress_barrier ();
     }
     PFUNC_END_TRY_BLOCK()
     PFUNC_CATCH_AND_RETHROW(group,barrier_steal)
   }
 
+  /**
+   * \brief Implements the waiting barrier.
+   *
+   * The tasks poll the phase for PFUNC_BARRIER_SPIN_COUNT iterations, which 
+   * is enough when the tasks arrive at roughly the same time. Thereafter, 
+   * they go to sleep until the last one to arrive flips the phase and wakes
+   * them up. The last one to arrive does not make a system call unless 
+   * someone is actually asleep.
+   *
+   * \param [in,out] taskmgr The instance of the library that we steal from.
+   * \param [in] steal Whether to run other tasks while polling the phase.
+   */
+  template <typename TaskManager>
+  void barrier_wait (TaskManager& taskmgr, const bool steal) {
+    PFUNC_START_TRY_BLOCK()
+    const int my_phase = wait_phase;
+    if ((group_size-1) == static_cast<unsigned int>(pfunc_fetch_and_add_32 
+          (reinterpret_cast<volatile int32_t*>(&barrier_count), 1))) {
+      barrier_count = 0;
+      pfunc_fetch_and_store_32 (&wait_phase, my_phase+1);
+#if PFUNC_HAVE_FUTEX == 1
+      if (0 != num_sleepers) 
+        futex_wake (const_cast<int*>(&wait_phase), INT_MAX);
+#endif
+    } else {
+      for (unsigned int i=0; 
+           i<PFUNC_BARRIER_SPIN_COUNT && my_phase == wait_phase && !cancelled;
+           ++i) {
+        if (steal && 0 == (i % PFUNC_BARRIER_STEAL_INTERVAL)) 
+          taskmgr.progress_barrier ();
+        else spin_relax ();
+      }
+
+#if PFUNC_HAVE_FUTEX == 1
+      if (my_phase == wait_phase && !cancelled) {
+        pfunc_fetch_and_add_32 (&num_sleepers, 1);
+        while (my_phase == wait_phase && !cancelled) 
+          futex_wait (const_cast<int*>(&wait_phase), my_phase);
+        pfunc_fetch_and_add_32 (&num_sleepers, -1);
+      }
+#else
+      /* Without futexes, there is nothing to sleep on; keep polling */
+      while (my_phase == wait_phase && !cancelled) spin_relax ();
+#endif
+    }
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CATCH_AND_RETHROW(group,barrier_wait)
+  }
+
+  /**
+   * \brief Implements the combining tree barrier.
+   *
+   * Members are divided into groups of PFUNC_BARRIER_FAN_IN, each of which 
+   * shares a leaf; thus, contention on any one counter is bounded by the 
+   * fan-in rather than the size of the group.
+   *
+   * \param [in] rank Rank of the calling task in the group.
+   */
+  void barrier_tree (const unsigned int& rank) {
+    PFUNC_START_TRY_BLOCK()
+    barrier_member& me = members[rank];
+    tree_arrive (tree_nodes + (rank/PFUNC_BARRIER_FAN_IN), me.sense);
+    me.sense = !me.sense;
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CATCH_AND_RETHROW(group,barrier_tree)
+  }
+
+  /**
+   * \brief Implements the dissemination barrier.
+   *
+   * In round k, the member with rank r signals the member with rank 
+   * (r+2^k)%size and waits to be signalled by the member with rank 
+   * (r-2^k)%size. There are no shared counters; each member spins on its 
+   * own flags. The flags alternate between two sets (parity) and their 
+   * meaning flips (sense) every other episode, so they are never reset.
+   *
+   * \param [in] rank Rank of the calling task in the group.
+   */
+  void barrier_dissemination (const unsigned int& rank) {
+    PFUNC_START_TRY_BLOCK()
+    barrier_member& me = members[rank];
+    const unsigned int parity = me.parity;
+    const bool sense = me.sense;
+    for (unsigned int k=0; k<num_rounds; ++k) {
+      barrier_member& partner = members[(rank + (1u << k)) % group_size];
+      pfunc_mem_fence ();
+      partner.flags[parity][k] = sense;
+      /* spin until signalled */
+      while (sense != me.flags[parity][k] && !cancelled);
+    }
+    if (1 == parity) me.sense = !sense;
+    me.parity = 1 - parity;
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CATCH_AND_RETHROW(group,barrier_dissemination)
+  }
+
   /**
    * \return Join this group and return a new rank.
    */
@@ -113,22 +359,74 @@ struct group {
   /**
    * \param gsize Number of tasks in the group
    */
-  void set_size (const unsigned int& gsize)  { group_size = gsize; }
+  void set_size (const unsigned int& gsize)  { 
+    group_size = gsize; 
+    build_barrier_state ();
+  }
 
   /**
    * \param barr Type of the barrier 
    */
-  void set_barrier (const unsigned int& barr) {type_of_barrier = barr;}
+  void set_barrier (const unsigned int& barr) {
+    type_of_barrier = barr;
+    build_barrier_state ();
+  }
+
+  /**
+   * \brief Cancels the group. 
+   *
+   * Tasks of this group that have not started running yet are completed 
+   * without running their functor; running tasks can poll is_cancelled()
+   * and return early. Barriers on a cancelled group return immediately as 
+   * not all the tasks might arrive; tasks that are already waiting in a
+   * barrier are released (the ones asleep in the waiting barrier are woken
+   * up).
+   */
+  void cancel () { 
+    pfunc_mem_fence ();
+    cancelled = true; 
+    pfunc_mem_fence ();
+
+    /* Move the waiting barrier on so that no one goes to sleep on it */
+    pfunc_fetch_and_add_32 (&wait_phase, 1);
+#if PFUNC_HAVE_FUTEX == 1
+    if (0 != num_sleepers) futex_wake (const_cast<int*>(&wait_phase), INT_MAX);
+#endif
+  }
+
+  /**
+   * Clears the cancellation so that the group can be reused; the barriers
+   * that were cut short are reset as well. Has to be called once all the
+   * tasks of the group have completed.
+   */
+  void clear_cancel () { 
+    reset_barrier_state ();
+    pfunc_mem_fence ();
+    cancelled = false; 
+  }
+
+  /**
+   * \return true if the group has been cancelled.
+   */
+  bool is_cancelled () const { return cancelled; }
 
   /**
    * \param [in,out] taskmgr The instance that does the steal.
+   * \param [in] rank Rank of the calling task in the group.
    */
   template <typename TaskManager>
-  void barrier (TaskManager& taskmgr)  {
+  void barrier (TaskManager& taskmgr, const unsigned int& rank)  {
     PFUNC_START_TRY_BLOCK()
-    if (group_size > 1) {
+    if (group_size > 1 && !cancelled) {
       if (BARRIER_SPIN == type_of_barrier) return barrier_spin();
       else if (BARRIER_STEAL == type_of_barrier) return barrier_steal(taskmgr);
+      else if (BARRIER_WAIT == type_of_barrier) 
+        return barrier_wait(taskmgr, false);
+      else if (BARRIER_STEAL_WAIT == type_of_barrier) 
+        return barrier_wait(taskmgr, true);
+      else if (BARRIER_TREE == type_of_barrier) return barrier_tree(rank);
+      else if (BARRIER_DISSEMINATION == type_of_barrier) 
+        return barrier_dissemination(rank);
     } else {
       /* If the group count is 0 or 1, no use with the barrier */
     }
@@ -141,10 +439,17 @@ struct group {
    */
   group ()  : barrier_phase (false),
               barrier_count (0),
+              wait_phase (0),
+              num_sleepers (0),
               rank_token (0),
               group_id (0), 
               group_size (0), 
-              type_of_barrier (BARRIER_SPIN)
+              type_of_barrier (BARRIER_SPIN),
+              cancelled (false),
+              members (NULL),
+              tree_nodes (NULL),
+              num_tree_nodes (0),
+              num_rounds (0)
               PFUNC_EXCEPT_PTR_INIT() {}
 
   /**
@@ -156,10 +461,17 @@ struct group {
   group (const unsigned int& group_id,
          const unsigned int& group_size) : barrier_phase (false),
                                            barrier_count (0),
+                                           wait_phase (0),
+                                           num_sleepers (0),
                                            rank_token (0),
                                            group_id (group_id), 
                                            group_size (group_size),
-                                           type_of_barrier (BARRIER_SPIN)
+                                           type_of_barrier (BARRIER_SPIN),
+                                           cancelled (false),
+                                           members (NULL),
+                                           tree_nodes (NULL),
+                                           num_tree_nodes (0),
+                                           num_rounds (0)
                                            PFUNC_EXCEPT_PTR_INIT() {}
 
   /**
@@ -173,16 +485,28 @@ struct group {
          const unsigned int& group_size,
          const unsigned int& barrier) : barrier_phase (false),
                                         barrier_count (0),
+                                        wait_phase (0),
+                                        num_sleepers (0),
                                         rank_token (0),
                                         group_id (group_id), 
                                         group_size (group_size),
-                                        type_of_barrier (barrier)
-                                        PFUNC_EXCEPT_PTR_INIT() {}
+                                        type_of_barrier (barrier),
+                                        cancelled (false),
+                                        members (NULL),
+                                        tree_nodes (NULL),
+                                        num_tree_nodes (0),
+                                        num_rounds (0)
+                                        PFUNC_EXCEPT_PTR_INIT() {
+    build_barrier_state ();
+  }
 
   /**
    * Destructor
    */
-  ~group ()  { PFUNC_EXCEPT_PTR_CLEAR() }
+  ~group ()  { 
+    clear_barrier_state ();
+    PFUNC_EXCEPT_PTR_CLEAR() 
+  }
 
 
   /**
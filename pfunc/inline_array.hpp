@@ -0,0 +1,178 @@
+#ifndef PFUNC_INLINE_ARRAY_HPP
+#define PFUNC_INLINE_ARRAY_HPP
+
+/**
+ * \file inline_array.hpp
+ * \brief A sequence with a fixed capacity that never touches the heap
+ */
+#include <cstddef>
+#include <cassert>
+#include <new>
+#include <pfunc/environ.hpp>
+
+namespace pfunc { namespace detail {
+  /**
+   * alignment_of
+   * The alignment of T in bytes: the offset at which T follows a char.
+   */
+  template <typename T>
+  struct alignment_of {
+    private:
+    struct probe { char c; T t; };
+
+    public:
+    static const size_t value = sizeof(probe) - sizeof(T);
+  };
+
+  /**
+   * aligned_block
+   * A type that is aligned to Alignment bytes. Alignments of up to 8 bytes
+   * (or 16, where long double has it) are met by the basic types; only the
+   * bigger ones need to be asked for.
+   */
+  template <size_t Alignment> struct aligned_block { char c; };
+  template <> struct aligned_block<16> { ALIGN16 char c; };
+  template <> struct aligned_block<32> { ALIGN32 char c; };
+  template <> struct aligned_block<64> { ALIGN64 char c; };
+  template <> struct aligned_block<128> { ALIGN128 char c; };
+
+  /**
+   * inline_array
+   * Holds up to Capacity objects of type T in storage that is part of the
+   * inline_array itself; so, an inline_array on the stack does not allocate.
+   * Unlike T[Capacity], T need not be default constructible and only the
+   * objects that are pushed back are constructed. This is used as the
+   * subspace_container of the spaces and to hold the subspace tasks of
+   * parallel_for and parallel_reduce.
+   */
+  template <typename T, size_t Capacity>
+  struct inline_array {
+    typedef T value_type; /**< Type of the objects held */
+    typedef T* iterator; /**< Iterator over the objects */
+    typedef const T* const_iterator; /**< Const iterator over the objects */
+    typedef size_t size_type; /**< Type of the size */
+
+    private:
+    /**
+     * Storage for the objects; the union makes it suitably aligned for T,
+     * even if T (or one of its members) is over-aligned.
+     */
+    union storage_type {
+      char bytes [sizeof(T)*(0==Capacity ? 1 : Capacity)];
+      aligned_block<alignment_of<T>::value> align_T;
+      long double align_long_double;
+      long long align_long_long;
+      void* align_pointer;
+      void (*align_function_pointer) ();
+    } storage; /**< Storage for the objects */
+    size_t num_elements; /**< Number of objects constructed */
+
+    /**
+     * Copies the objects of other into this (empty) array.
+     * \param [in] other The array to copy from.
+     */
+    void copy (const inline_array& other) {
+      for (size_t i=0; i<other.num_elements; ++i) push_back (other[i]);
+    }
+
+    public:
+    /**
+     * Constructor
+     */
+    inline_array () : num_elements (0) {}
+
+    /**
+     * Copy constructor
+     * \param [in] other The array to copy from.
+     */
+    inline_array (const inline_array& other) : num_elements (0) {
+      copy (other);
+    }
+
+    /**
+     * operator=
+     * \param [in] other The array to copy from.
+     * \return This array.
+     */
+    inline_array& operator= (const inline_array& other) {
+      if (this != &other) {
+        clear ();
+        copy (other);
+      }
+      return *this;
+    }
+
+    /**
+     * Destructor
+     */
+    ~inline_array () { clear (); }
+
+    /**
+     * Constructs a copy of value at the end of the array.
+     * \param [in] value The object to copy.
+     */
+    void push_back (const T& value) {
+      assert (Capacity > num_elements);
+      new (begin()+num_elements) T (value);
+      ++num_elements;
+    }
+
+    /**
+     * Destroys all the objects in the array.
+     */
+    void clear () {
+      while (0 < num_elements) begin()[--num_elements].~T();
+    }
+
+    /**
+     * \return The number of objects in the array.
+     */
+    size_t size () const { return num_elements; }
+
+    /**
+     * \return true if the array holds no objects.
+     */
+    bool empty () const { return (0 == num_elements); }
+
+    /**
+     * \return The maximum number of objects that the array can hold.
+     */
+    static size_t capacity () { return Capacity; }
+
+    /**
+     * \return Iterator to the first object.
+     */
+    iterator begin () { return reinterpret_cast<T*>(storage.bytes); }
+
+    /**
+     * \return Const iterator to the first object.
+     */
+    const_iterator begin () const {
+      return reinterpret_cast<const T*>(storage.bytes);
+    }
+
+    /**
+     * \return Iterator past the last object.
+     */
+    iterator end () { return begin () + num_elements; }
+
+    /**
+     * \return Const iterator past the last object.
+     */
+    const_iterator end () const { return begin () + num_elements; }
+
+    /**
+     * \param [in] index The position of the object.
+     * \return The object at index.
+     */
+    T& operator[] (const size_t& index) { return begin()[index]; }
+
+    /**
+     * \param [in] index The position of the object.
+     * \return The object at index.
+     */
+    const T& operator[] (const size_t& index) const { return begin()[index]; }
+  };
+} /* namespace detail */ } /* namespace pfunc */
+
+#endif // PFUNC_INLINE_ARRAY_HPP
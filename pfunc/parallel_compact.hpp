@@ -0,0 +1,414 @@
+#ifndef PFUNC_PARALLEL_COMPACT_HPP
+#define PFUNC_PARALLEL_COMPACT_HPP
+
+#include <pfunc/pfunc.hpp>
+#include <pfunc/space_1D.hpp>
+#include <pfunc/parallel_scan.hpp>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <iostream>
+
+namespace pfunc { namespace detail {
+
+/**
+ * The number of bytes of input in a block; half of a typical L1 cache.
+ */
+const size_t compaction_block_bytes = 16384;
+
+/**
+ * The ScanExecutable that drives a stream compaction. The summary of a
+ * block is the number of elements selected in it; in the final scan, every
+ * element is handed to the compactor along with the number of elements
+ * selected before it (its rank), which is where it goes in the output.
+ *
+ * Compactor must provide bool select (size_t) const, which tells if an
+ * element is to be kept, and void scatter (size_t, size_t, bool) const,
+ * which writes an element out given its index, its rank and whether it was
+ * selected.
+ */
+template <typename Compactor>
+struct compaction_scan {
+  private:
+  const Compactor* compactor; /**< Decides on and writes out elements */
+  size_t count; /**< Number of elements selected so far */
+
+  public:
+  /**
+   * Constructor
+   * \param [in] compactor The compactor to use.
+   */
+  compaction_scan (const Compactor& compactor) :
+    compactor (&compactor), count (0) {}
+
+  template <typename SpaceType, typename ScanTag>
+  void operator() (const SpaceType& space, ScanTag) {
+    size_t rank = count;
+    for (size_t i=space.begin(); i<space.end(); ++i) {
+      const bool selected = compactor->select (i);
+      if (ScanTag::is_final_scan ()) compactor->scatter (i, rank, selected);
+      if (selected) ++rank;
+    }
+    count = rank;
+  }
+
+  compaction_scan split () const { return compaction_scan (*compactor); }
+
+  void reverse_join (const compaction_scan& left) {
+    count = left.count + count;
+  }
+
+  void assign (const compaction_scan& other) { count = other.count; }
+
+  /**
+   * \return The number of elements selected.
+   */
+  size_t get_count () const { return count; }
+};
+
+/**
+ * Runs a stream compaction over [0, length) with parallel_scan. The space is
+ * split at block boundaries, so every leaf covers whole blocks.
+ * \param [in] compactor The compactor to use.
+ * \param [in] length The number of elements in the input.
+ * \param [in] block_size The number of elements in a block; if 0, as many
+ *                        as fit in compaction_block_bytes.
+ * \param [in] taskmgr The task manager to use.
+ * \return The number of elements selected.
+ */
+template <typename PFuncInstanceType,
+          typename SpaceType,
+          typename ValueType,
+          typename Compactor>
+size_t compact (const Compactor& compactor,
+                const size_t length,
+                const size_t block_size,
+                typename PFuncInstanceType::taskmgr& taskmgr) {
+  typedef compaction_scan<Compactor> ScanType;
+
+  ScanType scan_func (compactor);
+  const size_t granularity = (0 == block_size) ?
+    SpaceType::template granularity<ValueType>(compaction_block_bytes) :
+    block_size;
+
+  parallel_scan<PFuncInstanceType, ScanType, SpaceType>
+    (SpaceType (0, length, granularity), scan_func, taskmgr)();
+
+  return scan_func.get_count ();
+}
+
+/**
+ * Keeps the elements that satisfy a predicate.
+ */
+template <typename InputIterator,
+          typename OutputIterator,
+          typename Predicate>
+struct copy_if_compactor {
+  InputIterator first; /**< Beginning of the input */
+  OutputIterator result; /**< Beginning of the output */
+  Predicate pred; /**< Elements that satisfy this are kept */
+
+  copy_if_compactor (InputIterator first,
+                     OutputIterator result,
+                     const Predicate& pred) :
+    first (first), result (result), pred (pred) {}
+
+  bool select (const size_t i) const { return pred (first[i]); }
+
+  void scatter (const size_t i, const size_t rank, const bool selected) const {
+    if (selected) result[rank] = first[i];
+  }
+};
+
+/**
+ * Sends the elements that satisfy a predicate to one output and the rest
+ * to another.
+ */
+template <typename InputIterator,
+          typename OutputIterator1,
+          typename OutputIterator2,
+          typename Predicate>
+struct partition_compactor {
+  InputIterator first; /**< Beginning of the input */
+  OutputIterator1 result_true; /**< Output for elements that satisfy pred */
+  OutputIterator2 result_false; /**< Output for the rest */
+  Predicate pred; /**< The predicate to partition by */
+
+  partition_compactor (InputIterator first,
+                       OutputIterator1 result_true,
+                       OutputIterator2 result_false,
+                       const Predicate& pred) :
+    first (first), result_true (result_true), result_false (result_false),
+    pred (pred) {}
+
+  bool select (const size_t i) const { return pred (first[i]); }
+
+  void scatter (const size_t i, const size_t rank, const bool selected) const {
+    // i-rank elements before this one did not satisfy pred.
+    if (selected) result_true[rank] = first[i];
+    else result_false[i-rank] = first[i];
+  }
+};
+
+/**
+ * Keeps the first element of every run of equivalent elements.
+ */
+template <typename InputIterator,
+          typename OutputIterator,
+          typename BinaryPredicate>
+struct unique_compactor {
+  InputIterator first; /**< Beginning of the input */
+  OutputIterator result; /**< Beginning of the output */
+  BinaryPredicate pred; /**< Tells if two elements are equivalent */
+
+  unique_compactor (InputIterator first,
+                    OutputIterator result,
+                    const BinaryPredicate& pred) :
+    first (first), result (result), pred (pred) {}
+
+  bool select (const size_t i) const {
+    return (0 == i) || !pred (first[i-1], first[i]);
+  }
+
+  void scatter (const size_t i, const size_t rank, const bool selected) const {
+    if (selected) result[rank] = first[i];
+  }
+};
+
+} /* namespace detail */
+
+/**
+ * A function much akin to copy_if in STL. Copies the elements of
+ * [first, last) that satisfy pred to the range starting at result, which
+ * must not overlap the input; the elements keep their order.
+ *
+ * The copy is a count-scan-scatter over blocks of the input that fit in the
+ * cache: parallel_scan counts the elements to keep in every block and works
+ * out where the output of each block starts; then, every block writes its
+ * elements straight to their places. No atomics are needed, as every
+ * element of the output is written by exactly one block.
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance. The library instance
+ *                    must use pfunc::use_default for the Functor!
+ * RandomAccessIterator: Iterator over the input.
+ * OutputIterator: A random access iterator over the output.
+ * Predicate: Takes an element and tells if it is to be kept; it is called
+ *            concurrently, and on every element twice if there is more than
+ *            one thread.
+ * SpaceType: A one dimensional space (see space_1D.hpp) used for the split.
+ */
+template <typename PFuncInstanceType /*type of PFunc instantiated*/,
+          typename RandomAccessIterator /*input*/,
+          typename OutputIterator /*output*/,
+          typename Predicate /*elements to keep*/,
+          typename SpaceType = space_1D /*type of the space*/>
+struct parallel_copy_if : pfunc::virtual_functor {
+  public:
+  typedef typename PFuncInstanceType::taskmgr TaskMgrType;
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type
+    ValueType;
+
+  private:
+  RandomAccessIterator first;
+  RandomAccessIterator last;
+  OutputIterator result;
+  Predicate pred;
+  TaskMgrType& taskmgr;
+  size_t block_size;
+  size_t count;
+
+  public:
+  /**
+   * Constructor
+   * @param[in] first Beginning of the input.
+   * @param[in] last End of the input.
+   * @param[out] result Beginning of the output.
+   * @param[in] pred Elements that satisfy pred are copied.
+   * @param[in] taskmgr The task manager to use for this parallel_copy_if.
+   * @param[in] block_size The number of elements in a block; if 0, a block
+   *                       holds 16KB worth of elements.
+   */
+  parallel_copy_if (RandomAccessIterator first,
+                    RandomAccessIterator last,
+                    OutputIterator result,
+                    const Predicate& pred,
+                    TaskMgrType& taskmgr,
+                    const size_t block_size = 0) :
+    first (first), last (last), result (result), pred (pred),
+    taskmgr (taskmgr), block_size (block_size), count (0) {}
+
+  void operator() (void) {
+    count = detail::compact<PFuncInstanceType, SpaceType, ValueType>
+      (detail::copy_if_compactor<RandomAccessIterator,
+                                 OutputIterator,
+                                 Predicate> (first, result, pred),
+       static_cast<size_t>(last-first), block_size, taskmgr);
+  }
+
+  /**
+   * @return End of the output; valid once the copy is done.
+   */
+  OutputIterator get_result () const { return result + count; }
+};
+
+/**
+ * A function much akin to partition_copy in STL. Copies the elements of
+ * [first, last) that satisfy pred to the range starting at result_true and
+ * the rest to the range starting at result_false; neither of these may
+ * overlap the input. The partition is stable. To partition a range in place,
+ * partition a copy of it back into the range; see the example.
+ *
+ * The partition works just like parallel_copy_if; the place of an element
+ * that does not satisfy pred is its index less its rank.
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance. The library instance
+ *                    must use pfunc::use_default for the Functor!
+ * RandomAccessIterator: Iterator over the input.
+ * OutputIterator1, OutputIterator2: Random access iterators over the outputs.
+ * Predicate: Takes an element and tells which output it goes to; it is
+ *            called concurrently, and on every element twice if there is
+ *            more than one thread.
+ * SpaceType: A one dimensional space (see space_1D.hpp) used for the split.
+ */
+template <typename PFuncInstanceType /*type of PFunc instantiated*/,
+          typename RandomAccessIterator /*input*/,
+          typename OutputIterator1 /*output for true*/,
+          typename OutputIterator2 /*output for false*/,
+          typename Predicate /*predicate to partition by*/,
+          typename SpaceType = space_1D /*type of the space*/>
+struct parallel_partition : pfunc::virtual_functor {
+  public:
+  typedef typename PFuncInstanceType::taskmgr TaskMgrType;
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type
+    ValueType;
+
+  private:
+  RandomAccessIterator first;
+  RandomAccessIterator last;
+  OutputIterator1 result_true;
+  OutputIterator2 result_false;
+  Predicate pred;
+  TaskMgrType& taskmgr;
+  size_t block_size;
+  size_t count;
+
+  public:
+  /**
+   * Constructor
+   * @param[in] first Beginning of the input.
+   * @param[in] last End of the input.
+   * @param[out] result_true Beginning of the output for elements that
+   *                         satisfy pred.
+   * @param[out] result_false Beginning of the output for the rest.
+   * @param[in] pred The predicate to partition by.
+   * @param[in] taskmgr The task manager to use for this parallel_partition.
+   * @param[in] block_size The number of elements in a block; if 0, a block
+   *                       holds 16KB worth of elements.
+   */
+  parallel_partition (RandomAccessIterator first,
+                      RandomAccessIterator last,
+                      OutputIterator1 result_true,
+                      OutputIterator2 result_false,
+                      const Predicate& pred,
+                      TaskMgrType& taskmgr,
+                      const size_t block_size = 0) :
+    first (first), last (last), result_true (result_true),
+    result_false (result_false), pred (pred), taskmgr (taskmgr),
+    block_size (block_size), count (0) {}
+
+  void operator() (void) {
+    count = detail::compact<PFuncInstanceType, SpaceType, ValueType>
+      (detail::partition_compactor<RandomAccessIterator,
+                                   OutputIterator1,
+                                   OutputIterator2,
+                                   Predicate> (first, result_true,
+                                               result_false, pred),
+       static_cast<size_t>(last-first), block_size, taskmgr);
+  }
+
+  /**
+   * @return Ends of both the outputs; valid once the partition is done.
+   */
+  std::pair<OutputIterator1, OutputIterator2> get_result () const {
+    return std::make_pair (result_true + count,
+                           result_false + ((last-first) - count));
+  }
+};
+
+/**
+ * A function much akin to unique_copy in STL. Copies the first element of
+ * every run of consecutive equivalent elements in [first, last) to the range
+ * starting at result, which must not overlap the input.
+ *
+ * The copy works just like parallel_copy_if; an element is kept if it is
+ * the first one or if it is not equivalent to the one before it.
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance. The library instance
+ *                    must use pfunc::use_default for the Functor!
+ * RandomAccessIterator: Iterator over the input.
+ * OutputIterator: A random access iterator over the output.
+ * BinaryPredicate: Tells if two elements are equivalent; it is called
+ *                  concurrently.
+ * SpaceType: A one dimensional space (see space_1D.hpp) used for the split.
+ */
+template <typename PFuncInstanceType /*type of PFunc instantiated*/,
+          typename RandomAccessIterator /*input*/,
+          typename OutputIterator /*output*/,
+          typename BinaryPredicate = std::equal_to<typename
+            std::iterator_traits<RandomAccessIterator>::value_type>,
+          typename SpaceType = space_1D /*type of the space*/>
+struct parallel_unique : pfunc::virtual_functor {
+  public:
+  typedef typename PFuncInstanceType::taskmgr TaskMgrType;
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type
+    ValueType;
+
+  private:
+  RandomAccessIterator first;
+  RandomAccessIterator last;
+  OutputIterator result;
+  BinaryPredicate pred;
+  TaskMgrType& taskmgr;
+  size_t block_size;
+  size_t count;
+
+  public:
+  /**
+   * Constructor
+   * @param[in] first Beginning of the input.
+   * @param[in] last End of the input.
+   * @param[out] result Beginning of the output.
+   * @param[in] taskmgr The task manager to use for this parallel_unique.
+   * @param[in] pred Tells if two elements are equivalent.
+   * @param[in] block_size The number of elements in a block; if 0, a block
+   *                       holds 16KB worth of elements.
+   */
+  parallel_unique (RandomAccessIterator first,
+                   RandomAccessIterator last,
+                   OutputIterator result,
+                   TaskMgrType& taskmgr,
+                   const BinaryPredicate& pred = BinaryPredicate (),
+                   const size_t block_size = 0) :
+    first (first), last (last), result (result), pred (pred),
+    taskmgr (taskmgr), block_size (block_size), count (0) {}
+
+  void operator() (void) {
+    count = detail::compact<PFuncInstanceType, SpaceType, ValueType>
+      (detail::unique_compactor<RandomAccessIterator,
+                                OutputIterator,
+                                BinaryPredicate> (first, result, pred),
+       static_cast<size_t>(last-first), block_size, taskmgr);
+  }
+
+  /**
+   * @return End of the output; valid once the copy is done.
+   */
+  OutputIterator get_result () const { return result + count; }
+};
+
+} // namespace pfunc
+
+#endif // PFUNC_PARALLEL_COMPACT_HPP
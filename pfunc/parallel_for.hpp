@@ -2,6 +2,8 @@
 #define PFUNC_PARALLEL_FOR_HPP
 
 #include <pfunc/pfunc.hpp>
+#include <pfunc/partitioner.hpp>
+#include <pfunc/inline_array.hpp>
 #include <iostream>
 
 namespace pfunc {
@@ -13,7 +15,8 @@ namespace pfunc {
  * range.
  * @param[in] space The iteration space. space is a model of Space.
  * @param[in] func The function object to be applied to every element.
- *                 This function object has to take in an object of space_1D.
+ *                 This function object has to take in an object of the
+ *                 space type (space_1D, space_2D or space_3D).
  *                 i.e., void operator (const space_1D& space) { ... } must 
  *                 be defined on func. func is a model of the ForExecutable 
  *                 concept.
@@ -27,57 +30,112 @@ namespace pfunc {
  */
 template <typename PFuncInstanceType /*type of PFunc instantiated*/,
           typename ForExecutable/*type of the function*/,
-          typename SpaceType /*type of the space*/>
+          typename SpaceType /*type of the space*/,
+          typename Partitioner = simple_partitioner /*how far to split*/>
 struct parallel_for : pfunc::virtual_functor {
   public:
   typedef typename PFuncInstanceType::taskmgr TaskMgrType;
   typedef typename PFuncInstanceType::task TaskType;
+  typedef typename PFuncInstanceType::attribute AttributeType;
 
   private:
   SpaceType space; 
   const ForExecutable& func;
   TaskMgrType& taskmgr;
+  Partitioner partitioner;
 
-  public:
   /**
-   * Constructor
-   * @param[in] space The space over which to iterate
-   * @param[in] func The function to execute over elements in this space
-   * @param[in] taskmgr The task manager to use for this parallel_for
-   *
-   * TODO: Make parallel_for work with global task manager.
+   * Runs the chunks that the loop schedule hands out to one worker, after
+   * spawning the workers below it in the tree of workers.
    */
-  parallel_for (SpaceType space, 
-                const ForExecutable& func,
-                TaskMgrType& taskmgr) : space(space), 
-                                        func(func), 
-                                        taskmgr (taskmgr) {}
+  struct schedule_worker : pfunc::virtual_functor {
+    parallel_for* loop; /**< The loop that the worker belongs to */
+    unsigned int rank; /**< Rank of the worker in the loop */
+    unsigned int num_workers; /**< Number of workers in the loop */
+
+    void operator() (void) { loop->run_workers (rank, num_workers); }
+  };
+
+  /**
+   * Spawns the (at most two) children of a worker in the tree of workers,
+   * runs the worker's chunks and waits for the children. The tasks of the
+   * children are held on the stack; starting the workers does not touch 
+   * the heap.
+   * @param[in] rank Rank of the worker.
+   * @param[in] num_workers Number of workers in the loop.
+   */
+  void run_workers (const unsigned int rank, const unsigned int num_workers) {
+    TaskType child_tasks [2];
+    schedule_worker children [2];
+    unsigned int num_children = 0;
+    for (unsigned int child=2*rank+1; 
+         child<=2*rank+2 && child<num_workers; 
+         ++child, ++num_children) {
+      children[num_children].loop = this;
+      children[num_children].rank = child;
+      children[num_children].num_workers = num_workers;
+      pfunc::spawn (taskmgr, 
+                    child_tasks[num_children], 
+                    children[num_children]);
+    }
+
+    run_worker (rank);
+
+    pfunc::wait_all (taskmgr, child_tasks, child_tasks+num_children);
+  }
+
+  /**
+   * Asks the loop schedule for chunks till there are none left.
+   * @param[in] rank Rank of the worker asking for the chunks.
+   */
+  void run_worker (const unsigned int rank) {
+    size_t chunk_begin, chunk_end;
+    for (unsigned int round=0; 
+         partitioner.next (rank, round, chunk_begin, chunk_end); 
+         ++round) func (SpaceType (chunk_begin, chunk_end));
+  }
 
-  void operator() (void) {
-    if (space.can_split ()) {
+  /**
+   * Splits the space recursively as far as the partitioner allows.
+   */
+  void run (recursive_partitioner_tag) {
+    partitioner.start (taskmgr);
+    if (space.can_split () && partitioner.should_split ()) {
       // Split into subspaces.
       typename SpaceType::subspace_container subspaces = space.split ();
-      assert (1<=SpaceType::arity);
+      assert (1<=subspaces.size () && SpaceType::arity>=subspaces.size ());
 
-      // Create a vector of tasks for each subspace but the first one.
-      const int num_tasks = SpaceType::arity-1;
-      TaskType subspace_tasks [num_tasks];
-      parallel_for<PFuncInstanceType, ForExecutable, SpaceType>*
-            subspace_parallel_fors [num_tasks];
+      // Create a task for each subspace but the first one. Everything is
+      // held inline; the split does not touch the heap.
+      const size_t arity = subspaces.size ();
+      const int num_tasks = static_cast<int>(arity)-1;
+      TaskType subspace_tasks [SpaceType::arity-1];
+      detail::inline_array<parallel_for, SpaceType::arity-1> 
+            subspace_parallel_fors;
 
       // Save the first task to execute yourself, but do this last.
       typename SpaceType::subspace_container::iterator first=subspaces.begin();
       space = *first++;
+      const Partitioner my_partitioner (partitioner);
+      partitioner = my_partitioner.split (arity, 0);
 
       // Iterate and launch the tasks
       int task_index = 0;
       while (first != subspaces.end()) {
-        subspace_parallel_fors [task_index] = new
-          parallel_for<PFuncInstanceType, ForExecutable, SpaceType> 
-            (*first++, func, taskmgr);
+        subspace_parallel_fors.push_back (
+          parallel_for<PFuncInstanceType, ForExecutable, SpaceType, 
+                       Partitioner> (*first++, 
+                                     func, 
+                                     taskmgr, 
+                                     my_partitioner.split 
+                                       (arity, task_index+1)));
+        AttributeType subspace_attr (true /*nested*/, false /*grouped*/);
+        subspace_attr.set_queue_number 
+          (subspace_parallel_fors[task_index].partitioner.queue_number ());
         pfunc::spawn (taskmgr, // the task manager to use
                       subspace_tasks[task_index], // task handle
-                      *(subspace_parallel_fors[task_index])); 
+                      subspace_attr, // the queue to spawn into
+                      subspace_parallel_fors[task_index]); 
         ++task_index;
                             // the subspace for this comptn
       }
@@ -88,14 +146,44 @@ struct parallel_for : pfunc::virtual_functor {
       pfunc::wait_all (taskmgr, // the task manager to use
                        subspace_tasks, // beginning
                        subspace_tasks+num_tasks); // end
-
-      // Delete the subspace_parallel_fors
-      for (int i=0; i<num_tasks; ++i) delete subspace_parallel_fors[i];
     } else {
       // No more splitting --- simply invoke the function on the given space.
       func (space);
     }
   }
+
+  /**
+   * Starts a worker per thread; the loop schedule hands out the chunks. The
+   * workers are started as a binary tree rooted at the caller (worker 0).
+   * The space has to be 1-D, i.e., SpaceType (begin, end) has to be defined.
+   */
+  void run (loop_schedule_tag) {
+    const unsigned int num_workers = 
+      (0 == taskmgr.get_num_threads ()) ? 1 : taskmgr.get_num_threads ();
+    partitioner.start (space.begin (), space.end (), num_workers);
+
+    run_workers (0, num_workers); // we are worker 0
+  }
+
+  public:
+  /**
+   * Constructor
+   * @param[in] space The space over which to iterate
+   * @param[in] func The function to execute over elements in this space
+   * @param[in] taskmgr The task manager to use for this parallel_for
+   * @param[in] partitioner Decides how far the space is split or, if it is 
+   *                        a loop schedule, how the space is handed out 
+   *                        (see partitioner.hpp)
+   *
+   * TODO: Make parallel_for work with global task manager.
+   */
+  parallel_for (SpaceType space, 
+                const ForExecutable& func,
+                TaskMgrType& taskmgr,
+                const Partitioner& partitioner = Partitioner ()) :
+    space(space), func(func), taskmgr (taskmgr), partitioner (partitioner) {}
+
+  void operator() (void) { run (typename Partitioner::category ()); }
 };
 
 } // namespace pfunc
@@ -0,0 +1,419 @@
+#ifndef PFUNC_PARALLEL_INVOKE_HPP
+#define PFUNC_PARALLEL_INVOKE_HPP
+
+#include <pfunc/pfunc.hpp>
+#include <pfunc/no_copy.hpp>
+#include <pfunc/event.hpp>
+#include <iostream>
+
+namespace pfunc { namespace detail {
+
+/**
+ * Spawns a task on a task manager whose type is known.
+ */
+template <typename TaskManager,
+          typename TaskType,
+          typename AttributeType,
+          typename FunctorType>
+void invoke_spawn (TaskManager& taskmgr,
+                   TaskType& task,
+                   const AttributeType& attr,
+                   FunctorType& func) {
+  pfunc::spawn (taskmgr, task, attr, func);
+}
+
+/**
+ * Spawns a task on the global task manager, whose type is not known.
+ */
+template <typename TaskType,
+          typename AttributeType,
+          typename FunctorType>
+void invoke_spawn (taskmgr_virtual_base& taskmgr,
+                   TaskType& task,
+                   const AttributeType& attr,
+                   FunctorType& func) {
+  taskmgr.spawn_task (reinterpret_cast<void*>(&task),
+                      reinterpret_cast<void*>(
+                        &(const_cast<AttributeType&>(attr))),
+                      reinterpret_cast<void*>(&func));
+}
+
+/**
+ * Holds the tasks spawned by a parallel_invoke along with the counter that
+ * they signal on completion; lives on the stack of the caller, so nothing
+ * is allocated.
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance.
+ * TaskManager: The type of the task manager.
+ * NumSpawned: The number of tasks to be spawned.
+ */
+template <typename PFuncInstanceType,
+          typename TaskManager,
+          unsigned int NumSpawned>
+struct invoke_frame : public no_copy {
+  typedef typename PFuncInstanceType::task TaskType;
+  typedef typename PFuncInstanceType::attribute AttributeType;
+  typedef typename PFuncInstanceType::functor FunctorType;
+
+  private:
+  TaskManager& taskmgr; /**< Task manager running the tasks */
+  TaskType tasks [NumSpawned]; /**< The tasks spawned */
+  join_counter counter; /**< Signalled by every task on completion */
+  unsigned int num_spawned; /**< The number of tasks spawned so far */
+  bool joined; /**< Whether join() has been called */
+
+  public:
+  /**
+   * Constructor
+   * \param [in] taskmgr The task manager to spawn the tasks on.
+   */
+  invoke_frame (TaskManager& taskmgr) : taskmgr (taskmgr),
+                                        counter (NumSpawned),
+                                        num_spawned (0),
+                                        joined (false) {}
+
+  /**
+   * Destructor. If the calling thread did not get to join() (because a
+   * spawn or the function that it ran threw), the tasks that were spawned
+   * are still waited on, as they live in this frame. The tasks that were
+   * never spawned will not signal; so, they are signalled for here.
+   */
+  ~invoke_frame () {
+    if (!joined) {
+      for (unsigned int i=num_spawned; i<NumSpawned; ++i) counter.signal ();
+      counter.wait (taskmgr);
+    }
+  }
+
+  /**
+   * Spawns a function as a nested task.
+   * \param [in] func The function to spawn; it has to live till join().
+   */
+  void spawn (FunctorType& func) {
+    AttributeType attr (true /*nested*/, false /*grouped*/);
+    tasks[num_spawned].set_join_counter (&counter);
+    invoke_spawn (taskmgr, tasks[num_spawned], attr, func);
+    ++num_spawned; /* Counted only once the spawn has succeeded */
+  }
+
+  /**
+   * Waits for all the tasks to complete. Each task is then tested, which
+   * does not block, so that the exceptions that the tasks threw (if any)
+   * are thrown here.
+   */
+  void join () {
+    joined = true;
+    counter.wait (taskmgr);
+    for (unsigned int i=0; i<num_spawned; ++i) pfunc::test (taskmgr, tasks[i]);
+  }
+};
+
+} /* namespace detail */
+
+
+/**
+ * Runs the given functions in parallel and returns once all of them have
+ * completed. All but the last of the functions are spawned as nested tasks;
+ * the last one is run by the calling thread. The tasks live on the stack of
+ * the caller and are joined with a single counter, which each of them
+ * signals on completion, rather than with one wait per task. So, nothing is
+ * allocated and the calling thread executes other tasks while it waits.
+ * This is meant for fork-join in divide and conquer code; for example, the
+ * quadrants in matmult.cpp.
+ *
+ * As with pfunc::spawn, the functions must be of the functor type of the
+ * PFunc library instance; with pfunc::use_default, they can be of any type
+ * that derives from pfunc::virtual_functor. There are versions for 2 to
+ * 10 functions.
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance.
+ * TaskManager: The type of the task manager.
+ *
+ * @param[in] taskmgr The task manager to use for this parallel_invoke.
+ * @param[in] f0, f1, ... The functions to run.
+ */
+template <typename PFuncInstanceType, typename TaskManager>
+void parallel_invoke (TaskManager& taskmgr,
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1) {
+  detail::invoke_frame<PFuncInstanceType, TaskManager, 1> frame (taskmgr);
+  frame.spawn (f0);
+  f1 ();
+  frame.join ();
+}
+
+template <typename PFuncInstanceType, typename TaskManager>
+void parallel_invoke (TaskManager& taskmgr,
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2) {
+  detail::invoke_frame<PFuncInstanceType, TaskManager, 2> frame (taskmgr);
+  frame.spawn (f0);
+  frame.spawn (f1);
+  f2 ();
+  frame.join ();
+}
+
+template <typename PFuncInstanceType, typename TaskManager>
+void parallel_invoke (TaskManager& taskmgr,
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3) {
+  detail::invoke_frame<PFuncInstanceType, TaskManager, 3> frame (taskmgr);
+  frame.spawn (f0);
+  frame.spawn (f1);
+  frame.spawn (f2);
+  f3 ();
+  frame.join ();
+}
+
+template <typename PFuncInstanceType, typename TaskManager>
+void parallel_invoke (TaskManager& taskmgr,
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4) {
+  detail::invoke_frame<PFuncInstanceType, TaskManager, 4> frame (taskmgr);
+  frame.spawn (f0);
+  frame.spawn (f1);
+  frame.spawn (f2);
+  frame.spawn (f3);
+  f4 ();
+  frame.join ();
+}
+
+template <typename PFuncInstanceType, typename TaskManager>
+void parallel_invoke (TaskManager& taskmgr,
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4,
+    typename PFuncInstanceType::functor& f5) {
+  detail::invoke_frame<PFuncInstanceType, TaskManager, 5> frame (taskmgr);
+  frame.spawn (f0);
+  frame.spawn (f1);
+  frame.spawn (f2);
+  frame.spawn (f3);
+  frame.spawn (f4);
+  f5 ();
+  frame.join ();
+}
+
+template <typename PFuncInstanceType, typename TaskManager>
+void parallel_invoke (TaskManager& taskmgr,
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4,
+    typename PFuncInstanceType::functor& f5,
+    typename PFuncInstanceType::functor& f6) {
+  detail::invoke_frame<PFuncInstanceType, TaskManager, 6> frame (taskmgr);
+  frame.spawn (f0);
+  frame.spawn (f1);
+  frame.spawn (f2);
+  frame.spawn (f3);
+  frame.spawn (f4);
+  frame.spawn (f5);
+  f6 ();
+  frame.join ();
+}
+
+template <typename PFuncInstanceType, typename TaskManager>
+void parallel_invoke (TaskManager& taskmgr,
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4,
+    typename PFuncInstanceType::functor& f5,
+    typename PFuncInstanceType::functor& f6,
+    typename PFuncInstanceType::functor& f7) {
+  detail::invoke_frame<PFuncInstanceType, TaskManager, 7> frame (taskmgr);
+  frame.spawn (f0);
+  frame.spawn (f1);
+  frame.spawn (f2);
+  frame.spawn (f3);
+  frame.spawn (f4);
+  frame.spawn (f5);
+  frame.spawn (f6);
+  f7 ();
+  frame.join ();
+}
+
+template <typename PFuncInstanceType, typename TaskManager>
+void parallel_invoke (TaskManager& taskmgr,
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4,
+    typename PFuncInstanceType::functor& f5,
+    typename PFuncInstanceType::functor& f6,
+    typename PFuncInstanceType::functor& f7,
+    typename PFuncInstanceType::functor& f8) {
+  detail::invoke_frame<PFuncInstanceType, TaskManager, 8> frame (taskmgr);
+  frame.spawn (f0);
+  frame.spawn (f1);
+  frame.spawn (f2);
+  frame.spawn (f3);
+  frame.spawn (f4);
+  frame.spawn (f5);
+  frame.spawn (f6);
+  frame.spawn (f7);
+  f8 ();
+  frame.join ();
+}
+
+template <typename PFuncInstanceType, typename TaskManager>
+void parallel_invoke (TaskManager& taskmgr,
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4,
+    typename PFuncInstanceType::functor& f5,
+    typename PFuncInstanceType::functor& f6,
+    typename PFuncInstanceType::functor& f7,
+    typename PFuncInstanceType::functor& f8,
+    typename PFuncInstanceType::functor& f9) {
+  detail::invoke_frame<PFuncInstanceType, TaskManager, 9> frame (taskmgr);
+  frame.spawn (f0);
+  frame.spawn (f1);
+  frame.spawn (f2);
+  frame.spawn (f3);
+  frame.spawn (f4);
+  frame.spawn (f5);
+  frame.spawn (f6);
+  frame.spawn (f7);
+  frame.spawn (f8);
+  f9 ();
+  frame.join ();
+}
+
+
+ /**************************************************************************
+  * Here are the global versions that use the global task manager
+  *************************************************************************/
+namespace global {
+
+/**
+ * \see pfunc::parallel_invoke
+ *
+ * @param[in] f0, f1, ... The functions to run.
+ */
+template <typename PFuncInstanceType>
+void parallel_invoke (
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1) {
+  pfunc::parallel_invoke<PFuncInstanceType> (*global_tmanager, f0, f1);
+}
+
+template <typename PFuncInstanceType>
+void parallel_invoke (
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2) {
+  pfunc::parallel_invoke<PFuncInstanceType> (*global_tmanager, f0, f1, f2);
+}
+
+template <typename PFuncInstanceType>
+void parallel_invoke (
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3) {
+  pfunc::parallel_invoke<PFuncInstanceType> (*global_tmanager, f0, f1, f2, f3);
+}
+
+template <typename PFuncInstanceType>
+void parallel_invoke (
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4) {
+  pfunc::parallel_invoke<PFuncInstanceType> (*global_tmanager, f0, f1, f2, f3,
+                                             f4);
+}
+
+template <typename PFuncInstanceType>
+void parallel_invoke (
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4,
+    typename PFuncInstanceType::functor& f5) {
+  pfunc::parallel_invoke<PFuncInstanceType> (*global_tmanager, f0, f1, f2, f3,
+                                             f4, f5);
+}
+
+template <typename PFuncInstanceType>
+void parallel_invoke (
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4,
+    typename PFuncInstanceType::functor& f5,
+    typename PFuncInstanceType::functor& f6) {
+  pfunc::parallel_invoke<PFuncInstanceType> (*global_tmanager, f0, f1, f2, f3,
+                                             f4, f5, f6);
+}
+
+template <typename PFuncInstanceType>
+void parallel_invoke (
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4,
+    typename PFuncInstanceType::functor& f5,
+    typename PFuncInstanceType::functor& f6,
+    typename PFuncInstanceType::functor& f7) {
+  pfunc::parallel_invoke<PFuncInstanceType> (*global_tmanager, f0, f1, f2, f3,
+                                             f4, f5, f6, f7);
+}
+
+template <typename PFuncInstanceType>
+void parallel_invoke (
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4,
+    typename PFuncInstanceType::functor& f5,
+    typename PFuncInstanceType::functor& f6,
+    typename PFuncInstanceType::functor& f7,
+    typename PFuncInstanceType::functor& f8) {
+  pfunc::parallel_invoke<PFuncInstanceType> (*global_tmanager, f0, f1, f2, f3,
+                                             f4, f5, f6, f7, f8);
+}
+
+template <typename PFuncInstanceType>
+void parallel_invoke (
+    typename PFuncInstanceType::functor& f0,
+    typename PFuncInstanceType::functor& f1,
+    typename PFuncInstanceType::functor& f2,
+    typename PFuncInstanceType::functor& f3,
+    typename PFuncInstanceType::functor& f4,
+    typename PFuncInstanceType::functor& f5,
+    typename PFuncInstanceType::functor& f6,
+    typename PFuncInstanceType::functor& f7,
+    typename PFuncInstanceType::functor& f8,
+    typename PFuncInstanceType::functor& f9) {
+  pfunc::parallel_invoke<PFuncInstanceType> (*global_tmanager, f0, f1, f2, f3,
+                                             f4, f5, f6, f7, f8, f9);
+}
+
+} /* namespace global */
+
+} /* namespace pfunc */
+
+#endif // PFUNC_PARALLEL_INVOKE_HPP
@@ -0,0 +1,380 @@
+#ifndef PFUNC_PARALLEL_PIPELINE_HPP
+#define PFUNC_PARALLEL_PIPELINE_HPP
+
+#include <pfunc/pfunc.hpp>
+#include <pfunc/mutex.hpp>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+namespace pfunc {
+
+/**
+ * A stage of a parallel_pipeline. A filter takes an item from the stage
+ * before it and returns the item for the stage after it; the items are
+ * passed around as void*, so they can be anything. The first filter is the
+ * input of the pipeline: it is called with NULL and returns the next item,
+ * or NULL once the input is exhausted. What the last filter returns is
+ * ignored.
+ *
+ * A parallel filter is called on many items at once. A serial filter is
+ * called on one item at a time; a serial_in_order filter also sees the
+ * items in the order in which the first filter produced them. The first
+ * filter is always run serially and in order.
+ */
+class pipeline_filter {
+  public:
+  /**
+   * How a filter may be run.
+   */
+  enum mode {
+    parallel, /**< On many items at once */
+    serial_in_order, /**< On one item at a time, in order of the input */
+    serial_out_of_order /**< On one item at a time, in any order */
+  };
+
+  private:
+  mode filter_mode; /**< How the filter may be run */
+
+  public:
+  /**
+   * Constructor
+   * @param[in] filter_mode How the filter may be run.
+   */
+  explicit pipeline_filter (const mode filter_mode) :
+    filter_mode (filter_mode) {}
+
+  /**
+   * Virtual destructor
+   */
+  virtual ~pipeline_filter () {}
+
+  /**
+   * @return How the filter may be run.
+   */
+  mode get_mode () const { return filter_mode; }
+
+  /**
+   * @return true if the filter is run on one item at a time.
+   */
+  bool is_serial () const { return parallel != filter_mode; }
+
+  /**
+   * Processes an item.
+   * @param[in] item The item from the stage before; NULL for the first
+   *                 filter.
+   * @return The item for the stage after.
+   */
+  virtual void* operator() (void* item) = 0;
+};
+
+/**
+ * A structure that implements a pipeline over a stream of items. The
+ * filters are added in order with add_filter(); the pipeline is run by
+ * spawning it (or calling it) and completes when the first filter runs out
+ * of items and every item has gone through every filter.
+ *
+ * No more than max_tokens items are in the pipeline at any time, which caps
+ * the memory held by the items in flight. One worker per thread takes an
+ * item from the first filter and carries it through the rest of the filters
+ * itself, so that an item tends to stay in the cache of one thread; once the
+ * item is through, the worker takes the next one. When a worker cannot run
+ * a serial filter on its item (because the filter is busy, or because an
+ * item before it has yet to get there), the item is parked at the filter and
+ * the worker goes back to the input. The thread that is done with the
+ * filter then hands the next item parked there to a task that carries it
+ * on; these tasks are recycled once they complete.
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance. The library instance
+ *                    must use pfunc::use_default for the Functor! That is, it
+ *                    should use virtual operator().
+ */
+template <typename PFuncInstanceType /*type of PFunc instance*/>
+struct parallel_pipeline : pfunc::virtual_functor {
+  public:
+  typedef typename PFuncInstanceType::taskmgr TaskMgrType;
+  typedef typename PFuncInstanceType::task TaskType;
+
+  private:
+  /**
+   * An item in flight along with its position in the input.
+   */
+  struct token {
+    void* item; /**< The item */
+    size_t sequence; /**< Position of the item in the input */
+  };
+
+  /**
+   * A filter along with what is needed to run it serially.
+   */
+  struct stage : public detail::no_copy {
+    pipeline_filter* filter; /**< The filter */
+    mutex lock; /**< Guards the rest */
+    bool busy; /**< Whether an item is in the filter */
+    size_t next_sequence; /**< Next item to let in, if in order */
+    std::vector<token*> waiting_in_order; /**< Parked, by sequence */
+    std::deque<token*> waiting; /**< Parked, if out of order */
+
+    stage (pipeline_filter& filter, const size_t max_tokens) :
+      filter (&filter), busy (false), next_sequence (0),
+      waiting_in_order ((pipeline_filter::serial_in_order ==
+                         filter.get_mode ()) ?
+                          max_tokens : 0, static_cast<token*>(NULL)) {}
+
+    /**
+     * Lets an item into a serial filter or parks it there.
+     * \param [in] current The item.
+     * \return true if the item was let in; false if it was parked.
+     */
+    bool enter (token* current) {
+      const bool in_order = !waiting_in_order.empty ();
+      bool let_in = false;
+      lock.lock ();
+      if (!busy && (!in_order || current->sequence == next_sequence)) {
+        busy = true;
+        let_in = true;
+      } else if (in_order) {
+        // No more than max_tokens items past next_sequence are in flight.
+        waiting_in_order[current->sequence%waiting_in_order.size ()] =
+          current;
+      } else {
+        waiting.push_back (current);
+      }
+      lock.unlock ();
+      return let_in;
+    }
+
+    /**
+     * Takes an item out of a serial filter and lets in the next one that
+     * is parked, if any.
+     * \return The item let in, or NULL if there is none.
+     */
+    token* leave () {
+      token* next = NULL;
+      lock.lock ();
+      if (!waiting_in_order.empty ()) {
+        ++next_sequence;
+        const size_t slot = next_sequence%waiting_in_order.size ();
+        next = waiting_in_order[slot];
+        waiting_in_order[slot] = NULL;
+      } else if (!waiting.empty ()) {
+        next = waiting.front ();
+        waiting.pop_front ();
+      }
+      busy = (NULL != next);
+      lock.unlock ();
+      return next;
+    }
+  };
+
+  /**
+   * Carries an item on from a stage that it has been let into.
+   */
+  struct carrier : public pfunc::virtual_functor {
+    /**
+     * Whether the task is free to spawn, may be running, or is being
+     * waited on by join().
+     */
+    enum state { idle, spawned, joining };
+
+    parallel_pipeline* pipeline; /**< The pipeline */
+    TaskType task; /**< Task that carries the item */
+    token* current; /**< The item; NULL to start from the input */
+    size_t first_stage; /**< The stage that the item has been let into */
+    state carrier_state; /**< Guarded by carrier_lock */
+
+    carrier () : pipeline (NULL), current (NULL), first_stage (0),
+                 carrier_state (idle) {}
+
+    void operator() (void) { pipeline->carry (current, first_stage); }
+  };
+
+  TaskMgrType& taskmgr;
+  size_t max_tokens;
+  std::vector<pipeline_filter*> filters;
+  std::vector<stage*> stages; /**< One for each filter but the first */
+  mutex input_lock; /**< Guards the rest */
+  bool input_done; /**< Whether the first filter has run out of items */
+  size_t next_sequence; /**< Position of the next item in the input */
+  std::vector<token*> free_tokens; /**< Tokens not in flight */
+  mutex carrier_lock; /**< Guards carriers and their states */
+  std::vector<carrier*> carriers; /**< Carriers for the items handed off */
+
+  /**
+   * Gets the next item from the first filter.
+   * @param[in] current A token that is free to use, or NULL.
+   * @return The token holding the item, or NULL if the input is exhausted
+   *         or there are already max_tokens items in flight.
+   */
+  token* read (token* current) {
+    input_lock.lock ();
+    if (NULL == current && !free_tokens.empty ()) {
+      current = free_tokens.back ();
+      free_tokens.pop_back ();
+    }
+    if (NULL != current && !input_done) {
+      current->item = (*filters[0]) (NULL);
+      current->sequence = next_sequence++;
+      input_done = (NULL == current->item);
+    }
+    if (NULL != current && input_done) {
+      free_tokens.push_back (current);
+      current = NULL;
+    }
+    input_lock.unlock ();
+    return current;
+  }
+
+  /**
+   * Hands an item that has been let into a stage to a carrier task. The
+   * carriers are shared by all the workers and are never waited on by the
+   * one that spawned them, only by join(); so, the waits do not nest.
+   * @param[in] next The item.
+   * @param[in] index The stage.
+   */
+  void hand_off (token* next, const size_t index) {
+    carrier_lock.lock ();
+
+    // Reuse a carrier whose task has completed, if there is one.
+    carrier* spare = NULL;
+    for (size_t i=0; i<carriers.size () && NULL==spare; ++i) {
+      carrier* candidate = carriers[i];
+      if (carrier::idle == candidate->carrier_state ||
+          (carrier::spawned == candidate->carrier_state &&
+           pfunc::test (taskmgr, candidate->task))) spare = candidate;
+    }
+    if (NULL == spare) {
+      spare = new carrier ();
+      spare->pipeline = this;
+      carriers.push_back (spare);
+    }
+
+    spare->current = next;
+    spare->first_stage = index;
+    spare->carrier_state = carrier::spawned;
+    pfunc::spawn (taskmgr, spare->task, *spare);
+
+    carrier_lock.unlock ();
+  }
+
+  /**
+   * Waits on the carriers till none of them is running.
+   */
+  void join () {
+    for (;;) {
+      carrier* running = NULL;
+      carrier_lock.lock ();
+      for (size_t i=0; i<carriers.size () && NULL==running; ++i) {
+        if (carrier::spawned == carriers[i]->carrier_state) {
+          running = carriers[i];
+          running->carrier_state = carrier::joining;
+        }
+      }
+      carrier_lock.unlock ();
+      if (NULL == running) break;
+
+      pfunc::wait (taskmgr, running->task);
+
+      carrier_lock.lock ();
+      running->carrier_state = carrier::idle;
+      carrier_lock.unlock ();
+    }
+  }
+
+  /**
+   * Carries items through the stages till the input is exhausted or there
+   * are no tokens left.
+   * @param[in] current The item to start with; NULL to start from the input.
+   * @param[in] first_stage The stage that current has been let into.
+   */
+  void carry (token* current, size_t first_stage) {
+    bool let_in = (NULL != current);
+
+    if (NULL == current) current = read (NULL);
+    while (NULL != current) {
+      bool parked = false;
+      for (size_t i=first_stage; i<stages.size () && !parked; ++i) {
+        stage& current_stage = *stages[i];
+        if (!current_stage.filter->is_serial ()) {
+          current->item = (*current_stage.filter) (current->item);
+        } else if (let_in || current_stage.enter (current)) {
+          current->item = (*current_stage.filter) (current->item);
+          token* next = current_stage.leave ();
+          if (NULL != next) hand_off (next, i);
+        } else {
+          parked = true;
+        }
+        let_in = false;
+      }
+
+      // The item is through (its token can be reused) or parked.
+      current = read (parked ? NULL : current);
+      first_stage = 0;
+    }
+  }
+
+  public:
+  /**
+   * Constructor
+   * @param[in] taskmgr The task manager to use for this parallel_pipeline.
+   * @param[in] max_tokens The maximum number of items in flight.
+   */
+  parallel_pipeline (TaskMgrType& taskmgr, const size_t max_tokens) :
+    taskmgr (taskmgr), max_tokens ((0 == max_tokens) ? 1 : max_tokens),
+    input_done (false), next_sequence (0) {}
+
+  /**
+   * Destructor
+   */
+  ~parallel_pipeline () {
+    for (size_t i=0; i<stages.size (); ++i) delete stages[i];
+    for (size_t i=0; i<carriers.size (); ++i) delete carriers[i];
+  }
+
+  /**
+   * Adds a filter at the end of the pipeline.
+   * @param[in] filter The filter; it must live as long as the pipeline.
+   */
+  void add_filter (pipeline_filter& filter) {
+    if (!filters.empty ()) stages.push_back (new stage (filter, max_tokens));
+    filters.push_back (&filter);
+  }
+
+  /**
+   * Operator that does the parallelization.
+   */
+  void operator() (void) {
+    if (filters.empty ()) return;
+
+    input_done = false;
+    next_sequence = 0;
+    for (size_t i=0; i<stages.size (); ++i) stages[i]->next_sequence = 0;
+    token* tokens = new token [max_tokens];
+    free_tokens.clear ();
+    for (size_t i=0; i<max_tokens; ++i) free_tokens.push_back (tokens+i);
+
+    // Every worker reads from the input; we are worker 0.
+    const unsigned int num_workers =
+      (0 == taskmgr.get_num_threads ()) ? 1 : taskmgr.get_num_threads ();
+    carrier* workers = new carrier [num_workers];
+    for (unsigned int i=1; i<num_workers; ++i) {
+      workers[i].pipeline = this;
+      pfunc::spawn (taskmgr, workers[i].task, workers[i]);
+    }
+
+    carry (NULL, 0);
+
+    for (unsigned int i=1; i<num_workers; ++i)
+      pfunc::wait (taskmgr, workers[i].task);
+
+    // Once no carrier is running, no item is parked anywhere either.
+    join ();
+    delete [] workers;
+    delete [] tokens;
+  }
+};
+
+} // namespace pfunc
+
+#endif // PFUNC_PARALLEL_PIPELINE_HPP
@@ -2,6 +2,8 @@
 #define PFUNC_PARALLEL_REDUCE_HPP
 
 #include <pfunc/pfunc.hpp>
+#include <pfunc/partitioner.hpp>
+#include <pfunc/inline_array.hpp>
 #include <iostream>
 
 namespace pfunc {
@@ -13,7 +15,8 @@ namespace pfunc {
  * range.
  * @param[in] space The iteration space. space is a model of Space concept.
  * @param[in] func The function object to be applied to every element.
- *                 This function object has to take in an object of space_1D.
+ *                 This function object has to take in an object of the
+ *                 space type (space_1D, space_2D or space_3D).
  *                 i.e., void operator (const space_1D& space) { ... } must 
  *                 be defined on func. func is a model of ReduceExecutable
  *                 concept.
@@ -27,83 +30,170 @@ namespace pfunc {
  */
 template <typename PFuncInstanceType /*type of PFunc instantiated*/,
           typename ReduceExecutable/*type of the function*/,
-          typename SpaceType /*type of the space*/>
+          typename SpaceType /*type of the space*/,
+          typename Partitioner = simple_partitioner /*how far to split*/>
 struct parallel_reduce : pfunc::virtual_functor {
   public:
   typedef typename PFuncInstanceType::taskmgr TaskMgrType;
   typedef typename PFuncInstanceType::task TaskType;
+  typedef typename PFuncInstanceType::attribute AttributeType;
 
   private:
+  typedef detail::inline_array<ReduceExecutable, 1> view_container;
+
+  /**
+   * Bookkeeping for one split of the space; lives on the stack of the
+   * thread that split the space.
+   */
+  struct split_level {
+    unsigned int thread; /**< Thread that split the space */
+    int num_folded; /**< Number of subspaces that are in func, in order */
+  };
+
   SpaceType space; 
-  ReduceExecutable& func;
+  ReduceExecutable* func;
   TaskMgrType& taskmgr;
+  Partitioner partitioner;
+  split_level* parent_level; /**< Split that gave us our space; or NULL */
+  int subspace_index; /**< Position of our space in that split */
+  ReduceExecutable* parent_func; /**< Function of the thread that split */
+  view_container view; /**< Our own function, if we needed one */
 
-  public:
   /**
-   * Constructor
+   * Constructor for the subspaces.
    * @param[in] space The space over which to iterate
-   * @param[in] func The function to execute over elements in this space
+   * @param[in] parent_func The function of the thread that split the space
    * @param[in] taskmgr The task manager to use for this parallel_reduce
-   *
-   * TODO: Make parallel_reduce work with global task manager.
+   * @param[in] partitioner Decides how far the space is split
+   * @param[in] parent_level The split that gave us our space
+   * @param[in] subspace_index The position of space in that split
    */
   parallel_reduce (SpaceType space, 
-                   ReduceExecutable& func,
-                   TaskMgrType& taskmgr) : space(space), 
-                                           func(func), 
-                                           taskmgr (taskmgr) {}
+                   ReduceExecutable* parent_func,
+                   TaskMgrType& taskmgr,
+                   const Partitioner& partitioner,
+                   split_level* parent_level,
+                   const int subspace_index) :
+    space(space), func(NULL), taskmgr (taskmgr), partitioner (partitioner),
+    parent_level (parent_level), subspace_index (subspace_index), 
+    parent_func (parent_func) {}
 
-  void operator() (void) {
-    if (space.can_split ()) {
+  /**
+   * Splits the space as far as the partitioner allows and runs func over 
+   * the pieces.
+   */
+  void run () {
+    partitioner.start (taskmgr);
+    if (space.can_split () && partitioner.should_split ()) {
       // Split into subspaces.
       typename SpaceType::subspace_container subspaces = space.split ();
-      assert (SpaceType::arity>=1);
-
-      // Create a vector of tasks for each subspace but the first one.
-      const int num_tasks = SpaceType::arity-1;
-      TaskType subspace_tasks [num_tasks];
-      parallel_reduce<PFuncInstanceType, ReduceExecutable, SpaceType>*
-        subspace_parallel_reducers [num_tasks];
+      assert (1<=subspaces.size () && SpaceType::arity>=subspaces.size ());
 
-      // Split func and create a vector of functors one for each task.
-      std::vector<ReduceExecutable> split_funcs;
-      for (int i=0; i<num_tasks; ++i) 
-        split_funcs.push_back (ReduceExecutable(func.split ()));
+      // Create a task for each subspace but the first one. Everything is
+      // held inline; the split does not touch the heap.
+      const size_t arity = subspaces.size ();
+      const int num_tasks = static_cast<int>(arity)-1;
+      TaskType subspace_tasks [SpaceType::arity-1];
+      detail::inline_array<parallel_reduce, SpaceType::arity-1> 
+            subspace_parallel_reducers;
+      split_level level;
+      level.thread = taskmgr.current_thread_id ();
+      level.num_folded = 0;
 
       // Save the first task to execute yourself, but do this last.
       typename SpaceType::subspace_container::iterator first=subspaces.begin();
       space = *first++;
+      const Partitioner my_partitioner (partitioner);
+      partitioner = my_partitioner.split (arity, 0);
 
-      // Iterate and launch the tasks
+      // Create the rest of the subspaces
       int task_index = 0;
       while (first != subspaces.end()) {
-        subspace_parallel_reducers [task_index] = new 
-          parallel_reduce<PFuncInstanceType, ReduceExecutable, SpaceType> 
-            (*first++, split_funcs[task_index], taskmgr);
+        subspace_parallel_reducers.push_back (
+          parallel_reduce<PFuncInstanceType, ReduceExecutable, SpaceType, 
+                          Partitioner> (*first++, 
+                                        func, 
+                                        taskmgr, 
+                                        my_partitioner.split 
+                                          (arity, task_index+1),
+                                        &level,
+                                        task_index+1));
+        ++task_index;
+      }
+
+      // Launch them from the right; we pick up our own tasks from the left
+      // (the end spawned last) and so run them in order.
+      for (task_index=num_tasks-1; task_index>=0; --task_index) {
+        AttributeType subspace_attr (true /*nested*/, false /*grouped*/);
+        subspace_attr.set_queue_number 
+          (subspace_parallel_reducers[task_index].partitioner.queue_number ());
         pfunc::spawn (taskmgr, // the task manager to use
                       subspace_tasks[task_index], // task handle
-                      *(subspace_parallel_reducers[task_index])); 
+                      subspace_attr, // the queue to spawn into
+                      subspace_parallel_reducers[task_index]); 
                         // the subspace for this comptn
-        ++task_index;
       }
 
-      (*this)(); // executing this loop ourselves.
-
-      // Wait for completion of other tasks
-      pfunc::wait_all (taskmgr, // the task manager to use
-                       subspace_tasks, // beginning
-                       subspace_tasks+num_tasks); // end
+      run (); // executing this loop ourselves.
+      level.num_folded = 1;
 
-      // Join everything
-      for (int i=0; i<num_tasks; ++i) { 
-        func.join (split_funcs[i]);
-        delete subspace_parallel_reducers[i];
+      // Wait for the other tasks in order, joining the ones that had to 
+      // split the function.
+      for (int i=0; i<num_tasks; ++i) {
+        pfunc::wait (taskmgr, subspace_tasks[i]);
+        if (!subspace_parallel_reducers[i].view.empty ()) 
+          func->join (subspace_parallel_reducers[i].view[0]);
+        level.num_folded = i+2;
       }
     } else {
       // No more splitting --- simply invoke the function on the given space.
-      func (space);
+      (*func) (space);
     }
   }
+
+  public:
+  /**
+   * Constructor
+   * @param[in] space The space over which to iterate
+   * @param[in] func The function to execute over elements in this space
+   * @param[in] taskmgr The task manager to use for this parallel_reduce
+   * @param[in] partitioner Decides how far the space is split (see
+   *                        partitioner.hpp)
+   *
+   * TODO: Make parallel_reduce work with global task manager.
+   */
+  parallel_reduce (SpaceType space, 
+                   ReduceExecutable& func,
+                   TaskMgrType& taskmgr,
+                   const Partitioner& partitioner = Partitioner ()) :
+    space(space), func(&func), taskmgr (taskmgr), partitioner (partitioner),
+    parent_level (NULL), subspace_index (0), parent_func (NULL) {}
+
+  /**
+   * Runs the reduction. A subspace that is run by the thread that split it,
+   * after all the subspaces before it have been folded in, goes on with the
+   * function of that thread. Any other subspace --- typically, one that was
+   * stolen --- splits the function and gets joined back in order. So, func
+   * is split and joined once per steal rather than once per split.
+   */
+  void operator() (void) {
+    const bool use_parent_func = (NULL != parent_level) &&
+      (taskmgr.current_thread_id () == parent_level->thread) &&
+      (subspace_index == parent_level->num_folded);
+
+    if (NULL != parent_level) {
+      if (use_parent_func) {
+        func = parent_func;
+      } else {
+        view.push_back (parent_func->split ());
+        func = &view[0];
+      }
+    }
+
+    run ();
+
+    if (use_parent_func) parent_level->num_folded = subspace_index+1;
+  }
 };
 
 } // namespace pfunc
@@ -0,0 +1,213 @@
+#ifndef PFUNC_PARALLEL_SCAN_HPP
+#define PFUNC_PARALLEL_SCAN_HPP
+
+#include <pfunc/pfunc.hpp>
+#include <pfunc/inline_array.hpp>
+#include <cassert>
+#include <iostream>
+
+namespace pfunc {
+
+/**
+ * Passed to a ScanExecutable during the first pass of parallel_scan; the
+ * body only accumulates the summary of the space.
+ */
+struct pre_scan_tag {
+  static bool is_final_scan () { return false; }
+};
+
+/**
+ * Passed to a ScanExecutable during the last pass of parallel_scan; the
+ * body accumulates and writes out the prefixes of the space.
+ */
+struct final_scan_tag {
+  static bool is_final_scan () { return true; }
+};
+
+/**
+ * A function much akin to partial_sum in STL. Takes in a range and a
+ * functor. The assumption is that the functor has access to the entire
+ * input and output and hence all the harness needs to do is provide access
+ * to the correct range.
+ *
+ * The scan is done in two passes over a tree of subspaces. The up-sweep
+ * splits the space as far as it goes and runs a fresh copy of the functor
+ * (see split()) over every leaf with pre_scan_tag to get the summary of the
+ * leaf; the summaries are combined up the tree with reverse_join(). The
+ * down-sweep hands every subtree the summary of everything to its left
+ * (the prefix) and runs it over the leaves with final_scan_tag. So, the
+ * functor is run twice over every element; if the task manager has only
+ * one thread or the space cannot be split, the scan is done in a single
+ * serial pass over the whole space instead. At the end, func holds the
+ * summary of the whole space.
+ *
+ * @param[in] space The iteration space. space is a model of Space concept.
+ * @param[in,out] func The function object to be applied to every element.
+ *                 This function object has to take in an object of the
+ *                 space type and a pre_scan_tag or a final_scan_tag. func
+ *                 is a model of ScanExecutable concept.
+ *
+ * NOTE: This function currently uses a local task manager.
+ *
+ * NOTE: To use parallel_scan, the Functor used in PFuncInstanceType must be
+ * pfunc::use_default! If a definite type is given, parallel_scan fails to
+ * execute.
+ *
+ */
+template <typename PFuncInstanceType /*type of PFunc instantiated*/,
+          typename ScanExecutable/*type of the function*/,
+          typename SpaceType /*type of the space*/>
+struct parallel_scan : pfunc::virtual_functor {
+  public:
+  typedef typename PFuncInstanceType::taskmgr TaskMgrType;
+  typedef typename PFuncInstanceType::task TaskType;
+  typedef typename PFuncInstanceType::attribute AttributeType;
+
+  private:
+  /**
+   * A subspace in the tree of the scan along with its summary.
+   */
+  struct scan_node {
+    SpaceType space; /**< The subspace */
+    ScanExecutable summary; /**< Summary of the subspace after the up-sweep */
+    detail::inline_array<scan_node*, SpaceType::arity>
+      children; /**< Subtrees; empty for a leaf */
+
+    scan_node (const SpaceType& space, const ScanExecutable& summary) :
+      space (space), summary (summary) {}
+
+    ~scan_node () {
+      for (size_t i=0; i<children.size (); ++i) delete children[i];
+    }
+  };
+
+  /**
+   * Runs one of the sweeps over a subtree.
+   */
+  struct sweep : pfunc::virtual_functor {
+    parallel_scan* scan; /**< The scan that the subtree belongs to */
+    scan_node* node; /**< Root of the subtree */
+    ScanExecutable* prefix; /**< Prefix of the subtree; NULL to sweep up */
+
+    sweep (parallel_scan* scan, scan_node* node, ScanExecutable* prefix) :
+      scan (scan), node (node), prefix (prefix) {}
+
+    void operator() (void) {
+      if (NULL == prefix) scan->up_sweep (*node);
+      else scan->down_sweep (*node, *prefix);
+    }
+  };
+
+  SpaceType space;
+  ScanExecutable& func;
+  TaskMgrType& taskmgr;
+
+  /**
+   * Runs a sweep over each child of a node; the first child is run by the
+   * calling thread and the rest are spawned.
+   * @param[in] node The node whose children are to be swept.
+   * @param[in] prefixes The prefix of each child; NULL to sweep up.
+   */
+  void sweep_children (scan_node& node, ScanExecutable** prefixes) {
+    const size_t arity = node.children.size ();
+    const int num_tasks = static_cast<int>(arity)-1;
+    TaskType child_tasks [SpaceType::arity-1];
+    detail::inline_array<sweep, SpaceType::arity-1> child_sweeps;
+
+    for (size_t i=1; i<arity; ++i) {
+      child_sweeps.push_back (sweep (this, node.children[i],
+                                     (NULL==prefixes) ? NULL : prefixes[i]));
+      AttributeType child_attr (true /*nested*/, false /*grouped*/);
+      pfunc::spawn (taskmgr, child_tasks[i-1], child_attr, child_sweeps[i-1]);
+    }
+
+    sweep (this, node.children[0], (NULL==prefixes) ? NULL : prefixes[0])();
+
+    pfunc::wait_all (taskmgr, child_tasks, child_tasks+num_tasks);
+  }
+
+  /**
+   * Splits the space of a node as far as it goes and works out the summary
+   * of every node from the leaves up.
+   * @param[in,out] node The root of the subtree.
+   */
+  void up_sweep (scan_node& node) {
+    if (node.space.can_split ()) {
+      typename SpaceType::subspace_container subspaces = node.space.split ();
+      assert (1<=subspaces.size () && SpaceType::arity>=subspaces.size ());
+      for (size_t i=0; i<subspaces.size (); ++i)
+        node.children.push_back (new scan_node (subspaces[i], func.split ()));
+
+      sweep_children (node, NULL);
+
+      // summary = children[0] + children[1] + ... + children[arity-1]
+      const size_t last = node.children.size ()-1;
+      node.summary.assign (node.children[last]->summary);
+      for (size_t i=last; i>0; --i)
+        node.summary.reverse_join (node.children[i-1]->summary);
+    } else {
+      node.summary (node.space, pre_scan_tag ());
+    }
+  }
+
+  /**
+   * Runs the final scan over the leaves of a subtree.
+   * @param[in,out] node The root of the subtree.
+   * @param[in,out] prefix Holds the prefix of the subtree; it is run over
+   *                the first leaf.
+   */
+  void down_sweep (scan_node& node, ScanExecutable& prefix) {
+    if (node.children.empty ()) {
+      prefix (node.space, final_scan_tag ());
+    } else {
+      // The prefix of a child is the prefix of the one on its left plus the
+      // summary of that one; the summaries are not needed anymore, so they
+      // hold the prefixes. This has to be done before any child runs.
+      ScanExecutable* prefixes [SpaceType::arity];
+      prefixes[0] = &prefix;
+      for (size_t i=1; i<node.children.size (); ++i) {
+        prefixes[i] = &(node.children[i-1]->summary);
+        prefixes[i]->reverse_join (*prefixes[i-1]);
+      }
+
+      sweep_children (node, prefixes);
+    }
+  }
+
+  public:
+  /**
+   * Constructor
+   * @param[in] space The space over which to iterate
+   * @param[in,out] func The function to execute over elements in this space;
+   *                     holds the summary of the space once the scan is done.
+   * @param[in] taskmgr The task manager to use for this parallel_scan
+   *
+   * TODO: Make parallel_scan work with global task manager.
+   */
+  parallel_scan (SpaceType space,
+                 ScanExecutable& func,
+                 TaskMgrType& taskmgr) :
+    space(space), func(func), taskmgr (taskmgr) {}
+
+  void operator() (void) {
+    if (!space.can_split () || 1 >= taskmgr.get_num_threads ()) {
+      // No one to share the work with; a single pass will do.
+      func (space, final_scan_tag ());
+    } else {
+      scan_node root (space, func.split ());
+      up_sweep (root);
+
+      // func ends up with its own summary plus that of the whole space.
+      ScanExecutable total (func.split ());
+      total.assign (root.summary);
+      total.reverse_join (func);
+
+      down_sweep (root, func);
+      func.assign (total);
+    }
+  }
+};
+
+} // namespace pfunc
+
+#endif // PFUNC_PARALLEL_SCAN_HPP
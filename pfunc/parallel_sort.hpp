@@ -0,0 +1,247 @@
+#ifndef PFUNC_PARALLEL_SORT_HPP
+#define PFUNC_PARALLEL_SORT_HPP
+
+#include <pfunc/pfunc.hpp>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include <iostream>
+
+namespace pfunc {
+
+/**
+ * A function much akin to merge in STL. Merges the sorted ranges
+ * [first1, last1) and [first2, last2) into the range starting at result,
+ * which must not overlap either of them. Of equal elements, those from the
+ * first range come first (the merge is stable).
+ *
+ * The larger of the two ranges is halved and the other one is split at the
+ * position of the middle element (found by binary search); the two halves
+ * are then merged in parallel, till there are no more than cutoff elements
+ * left to merge, which are merged with std::merge.
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance. The library instance
+ *                    must use pfunc::use_default for the Functor!
+ * RandomAccessIterator1, RandomAccessIterator2: Iterators over the inputs.
+ * OutputIterator: A random access iterator over the output.
+ * Compare: A strict weak ordering of the elements.
+ */
+template <typename PFuncInstanceType /*type of PFunc instantiated*/,
+          typename RandomAccessIterator1 /*first input*/,
+          typename RandomAccessIterator2 /*second input*/,
+          typename OutputIterator /*output*/,
+          typename Compare = std::less<typename
+            std::iterator_traits<RandomAccessIterator1>::value_type> >
+struct parallel_merge : pfunc::virtual_functor {
+  public:
+  typedef typename PFuncInstanceType::taskmgr TaskMgrType;
+  typedef typename PFuncInstanceType::task TaskType;
+  typedef typename PFuncInstanceType::attribute AttributeType;
+
+  private:
+  RandomAccessIterator1 first1;
+  RandomAccessIterator1 last1;
+  RandomAccessIterator2 first2;
+  RandomAccessIterator2 last2;
+  OutputIterator result;
+  TaskMgrType& taskmgr;
+  Compare comp;
+  size_t cutoff;
+
+  public:
+  /**
+   * Constructor
+   * @param[in] first1 Beginning of the first sorted range.
+   * @param[in] last1 End of the first sorted range.
+   * @param[in] first2 Beginning of the second sorted range.
+   * @param[in] last2 End of the second sorted range.
+   * @param[out] result Beginning of the output.
+   * @param[in] taskmgr The task manager to use for this parallel_merge.
+   * @param[in] comp The ordering of the elements.
+   * @param[in] cutoff The number of elements at or below which the merge is
+   *                   done serially.
+   */
+  parallel_merge (RandomAccessIterator1 first1,
+                  RandomAccessIterator1 last1,
+                  RandomAccessIterator2 first2,
+                  RandomAccessIterator2 last2,
+                  OutputIterator result,
+                  TaskMgrType& taskmgr,
+                  const Compare& comp = Compare (),
+                  const size_t cutoff = 4096) :
+    first1 (first1), last1 (last1), first2 (first2), last2 (last2),
+    result (result), taskmgr (taskmgr), comp (comp),
+    cutoff ((2 > cutoff) ? 2 : cutoff) {}
+
+  void operator() (void) {
+    const size_t length1 = static_cast<size_t>(last1-first1);
+    const size_t length2 = static_cast<size_t>(last2-first2);
+    if (length1+length2 <= cutoff) {
+      std::merge (first1, last1, first2, last2, result, comp);
+      return;
+    }
+
+    // Split so that everything in the first halves goes before everything
+    // in the second halves and equal elements keep their order.
+    RandomAccessIterator1 middle1;
+    RandomAccessIterator2 middle2;
+    if (length1 >= length2) {
+      middle1 = first1 + length1/2;
+      middle2 = std::lower_bound (first2, last2, *middle1, comp);
+    } else {
+      middle2 = first2 + length2/2;
+      middle1 = std::upper_bound (first1, last1, *middle2, comp);
+    }
+    OutputIterator middle_result = result + (middle1-first1) +
+                                            (middle2-first2);
+
+    // Spawn the second halves and do the first halves ourselves.
+    TaskType second_task;
+    AttributeType second_attr (true /*nested*/, false /*grouped*/);
+    parallel_merge second_merge (middle1, last1, middle2, last2,
+                                 middle_result, taskmgr, comp, cutoff);
+    pfunc::spawn (taskmgr, second_task, second_attr, second_merge);
+
+    last1 = middle1;
+    last2 = middle2;
+    (*this)();
+
+    pfunc::wait (taskmgr, second_task);
+  }
+};
+
+/**
+ * A function much akin to sort in STL. Sorts [first, last) with a parallel
+ * merge sort: the range is halved recursively till there are no more than
+ * cutoff elements, which are sorted with std::sort; the halves are then
+ * merged with parallel_merge. The merges go back and forth between the
+ * range and a scratch buffer that is allocated once, up front. Like
+ * std::sort, the sort is not stable. If the task manager has only one
+ * thread, std::sort is used straight away.
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance. The library instance
+ *                    must use pfunc::use_default for the Functor!
+ * RandomAccessIterator: Iterator over the elements; the elements must be
+ *                       CopyConstructible and Assignable.
+ * Compare: A strict weak ordering of the elements.
+ */
+template <typename PFuncInstanceType /*type of PFunc instantiated*/,
+          typename RandomAccessIterator /*type of the iterator*/,
+          typename Compare = std::less<typename
+            std::iterator_traits<RandomAccessIterator>::value_type> >
+struct parallel_sort : pfunc::virtual_functor {
+  public:
+  typedef typename PFuncInstanceType::taskmgr TaskMgrType;
+  typedef typename PFuncInstanceType::task TaskType;
+  typedef typename PFuncInstanceType::attribute AttributeType;
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type
+    ValueType;
+  typedef typename std::vector<ValueType>::iterator BufferIterator;
+
+  private:
+  /**
+   * Sorts a part of the range.
+   */
+  struct sort_task : pfunc::virtual_functor {
+    parallel_sort* sorter; /**< The sort that the part belongs to */
+    RandomAccessIterator first; /**< Beginning of the part */
+    RandomAccessIterator last; /**< End of the part */
+    BufferIterator buffer; /**< The part of the buffer that goes with it */
+    bool into_buffer; /**< Whether the result goes into the buffer */
+
+    sort_task (parallel_sort* sorter,
+               RandomAccessIterator first,
+               RandomAccessIterator last,
+               BufferIterator buffer,
+               const bool into_buffer) : sorter (sorter), first (first),
+                                         last (last), buffer (buffer),
+                                         into_buffer (into_buffer) {}
+
+    void operator() (void) {
+      sorter->sort_range (first, last, buffer, into_buffer);
+    }
+  };
+
+  RandomAccessIterator first;
+  RandomAccessIterator last;
+  TaskMgrType& taskmgr;
+  Compare comp;
+  size_t cutoff;
+
+  /**
+   * Sorts [part_first, part_last) into itself or into the buffer.
+   * @param[in,out] part_first Beginning of the part.
+   * @param[in,out] part_last End of the part.
+   * @param[in,out] buffer The part of the buffer that goes with it.
+   * @param[in] into_buffer Whether the result goes into the buffer.
+   */
+  void sort_range (RandomAccessIterator part_first,
+                   RandomAccessIterator part_last,
+                   BufferIterator buffer,
+                   const bool into_buffer) {
+    const size_t length = static_cast<size_t>(part_last-part_first);
+    if (length <= cutoff) {
+      std::sort (part_first, part_last, comp);
+      if (into_buffer) std::copy (part_first, part_last, buffer);
+      return;
+    }
+
+    // Sort the halves into wherever this part is not going to end up.
+    const size_t half = length/2;
+    TaskType second_task;
+    AttributeType second_attr (true /*nested*/, false /*grouped*/);
+    sort_task second_sort (this, part_first+half, part_last, buffer+half,
+                           !into_buffer);
+    pfunc::spawn (taskmgr, second_task, second_attr, second_sort);
+    sort_range (part_first, part_first+half, buffer, !into_buffer);
+    pfunc::wait (taskmgr, second_task);
+
+    // Merge the halves into where this part should end up.
+    if (into_buffer) {
+      parallel_merge<PFuncInstanceType, RandomAccessIterator,
+                     RandomAccessIterator, BufferIterator, Compare>
+        (part_first, part_first+half, part_first+half, part_last,
+         buffer, taskmgr, comp, cutoff)();
+    } else {
+      parallel_merge<PFuncInstanceType, BufferIterator,
+                     BufferIterator, RandomAccessIterator, Compare>
+        (buffer, buffer+half, buffer+half, buffer+length,
+         part_first, taskmgr, comp, cutoff)();
+    }
+  }
+
+  public:
+  /**
+   * Constructor
+   * @param[in] first Beginning of the range to sort.
+   * @param[in] last End of the range to sort.
+   * @param[in] taskmgr The task manager to use for this parallel_sort.
+   * @param[in] comp The ordering of the elements.
+   * @param[in] cutoff The number of elements at or below which a part is
+   *                   sorted (or merged) serially.
+   */
+  parallel_sort (RandomAccessIterator first,
+                 RandomAccessIterator last,
+                 TaskMgrType& taskmgr,
+                 const Compare& comp = Compare (),
+                 const size_t cutoff = 4096) :
+    first (first), last (last), taskmgr (taskmgr), comp (comp),
+    cutoff ((2 > cutoff) ? 2 : cutoff) {}
+
+  void operator() (void) {
+    if (static_cast<size_t>(last-first) <= cutoff ||
+        1 >= taskmgr.get_num_threads ()) {
+      std::sort (first, last, comp);
+    } else {
+      std::vector<ValueType> buffer (first, last);
+      sort_range (first, last, buffer.begin (), false);
+    }
+  }
+};
+
+} // namespace pfunc
+
+#endif // PFUNC_PARALLEL_SORT_HPP
@@ -0,0 +1,356 @@
+#ifndef PFUNC_PARALLEL_TRANSFORM_REDUCE_HPP
+#define PFUNC_PARALLEL_TRANSFORM_REDUCE_HPP
+
+#include <pfunc/pfunc.hpp>
+#include <pfunc/simd.hpp>
+#include <pfunc/space_1D.hpp>
+#include <pfunc/parallel_for.hpp>
+#include <pfunc/parallel_reduce.hpp>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <iostream>
+
+namespace pfunc {
+
+/**
+ * How a parallel_transform_reduce adds up floating point numbers.
+ */
+enum summation_mode {
+  fast_summation, /**< In whatever order is fastest */
+  reproducible_summation /**< In an order that is fixed by the input alone */
+};
+
+/**
+ * Adds up the elements of an array.
+ */
+struct sum_kernel {
+  static const bool binary = false;
+
+  template <typename V>
+  static void transform (const V& x, const V&, V& value) { value = x; }
+
+  template <typename V>
+  static void reduce (V& accumulator, const V& value) {
+    accumulator += value;
+  }
+
+  template <typename T>
+  static T combine (const T& a, const T& b) { return a + b; }
+
+  template <typename T>
+  static T identity () { return T (0); }
+
+  template <typename T>
+  static T finish (const T& result) { return result; }
+};
+
+/**
+ * Adds up the products of the elements of two arrays.
+ */
+struct dot_kernel : public sum_kernel {
+  static const bool binary = true;
+
+  template <typename V>
+  static void transform (const V& x, const V& y, V& value) { value = x*y; }
+};
+
+/**
+ * Works out the Euclidean norm of an array. The squares are added up as
+ * they are, so the elements should be small enough for those not to
+ * overflow.
+ */
+struct norm_kernel : public sum_kernel {
+  template <typename V>
+  static void transform (const V& x, const V&, V& value) { value = x*x; }
+
+  template <typename T>
+  static T finish (const T& result) {
+    return static_cast<T>(std::sqrt (result));
+  }
+};
+
+/**
+ * Finds the smallest element of an array.
+ */
+struct min_kernel : public sum_kernel {
+  template <typename V>
+  static void reduce (V& accumulator, const V& value) {
+    accumulator = (value < accumulator) ? value : accumulator;
+  }
+
+  template <typename T>
+  static T combine (const T& a, const T& b) { return (b < a) ? b : a; }
+
+  template <typename T>
+  static T identity () {
+    return (std::numeric_limits<T>::has_infinity) ?
+      std::numeric_limits<T>::infinity () : std::numeric_limits<T>::max ();
+  }
+};
+
+/**
+ * Finds the largest element of an array.
+ */
+struct max_kernel : public sum_kernel {
+  template <typename V>
+  static void reduce (V& accumulator, const V& value) {
+    accumulator = (accumulator < value) ? value : accumulator;
+  }
+
+  template <typename T>
+  static T combine (const T& a, const T& b) { return (a < b) ? b : a; }
+
+  template <typename T>
+  static T identity () {
+    if (std::numeric_limits<T>::has_infinity)
+      return -std::numeric_limits<T>::infinity ();
+    return (std::numeric_limits<T>::is_integer) ?
+      std::numeric_limits<T>::min () : -std::numeric_limits<T>::max ();
+  }
+};
+
+namespace detail {
+
+/**
+ * The number of bytes of input in a block; half of a typical L1 cache.
+ */
+const size_t transform_reduce_block_bytes = 16384;
+
+/**
+ * The ReduceExecutable for the fast mode; every leaf is reduced with one
+ * call to the kernel.
+ */
+template <typename Kernel, typename ValueType>
+struct transform_reduce_leaf {
+  private:
+  const ValueType* x; /**< The first array */
+  const ValueType* y; /**< The second array */
+  simd_isa isa; /**< The instruction set to use */
+  ValueType result; /**< The reduction of the leaves seen so far */
+
+  public:
+  transform_reduce_leaf (const ValueType* x,
+                         const ValueType* y,
+                         const simd_isa isa) :
+    x (x), y (y), isa (isa), result (Kernel::template identity<ValueType>()) {}
+
+  template <typename SpaceType>
+  void operator() (const SpaceType& space) {
+    result = Kernel::combine (result, simd_reduce<Kernel, ValueType, false>
+      (isa, x+space.begin(), y+space.begin(), space.end()-space.begin()));
+  }
+
+  transform_reduce_leaf split () const {
+    return transform_reduce_leaf (x, y, isa);
+  }
+
+  void join (const transform_reduce_leaf& other) {
+    result = Kernel::combine (result, other.result);
+  }
+
+  /**
+   * \return The reduction of the leaves seen so far.
+   */
+  ValueType get_result () const { return result; }
+};
+
+/**
+ * The ForExecutable for the reproducible mode; every block is reduced on
+ * its own into its own slot. The leaves are made up of whole blocks, so
+ * the blocks (and what goes into each) do not depend on how the space was
+ * split.
+ */
+template <typename Kernel, typename ValueType>
+struct transform_reduce_blocks {
+  const ValueType* x; /**< The first array */
+  const ValueType* y; /**< The second array */
+  simd_isa isa; /**< The instruction set to use */
+  size_t block_size; /**< The number of elements in a block */
+  ValueType* partials; /**< The reduction of each block */
+
+  template <typename SpaceType>
+  void operator() (const SpaceType& space) const {
+    for (size_t begin=space.begin(); begin<space.end(); begin+=block_size) {
+      const size_t end = (space.end()-begin > block_size) ?
+                           (begin+block_size) : space.end();
+      partials[begin/block_size] = simd_reduce<Kernel, ValueType, true>
+                                     (isa, x+begin, y+begin, end-begin);
+    }
+  }
+};
+
+/**
+ * Combines the reductions of the blocks pairwise, always in the same order.
+ * \param [in] first The reductions of the blocks.
+ * \param [in] count The number of blocks; at least 1.
+ * \return The reduction of all the blocks.
+ */
+template <typename Kernel, typename ValueType>
+ValueType combine_pairwise (const ValueType* first, const size_t count) {
+  if (1 == count) return *first;
+  const size_t half = count/2;
+  return Kernel::combine (combine_pairwise<Kernel> (first, half),
+                          combine_pairwise<Kernel> (first+half, count-half));
+}
+
+} // namespace detail
+
+/**
+ * A structure that reduces a contiguous array of an arithmetic type (or, for
+ * dot_kernel, two of them) with one of sum_kernel, dot_kernel, norm_kernel,
+ * min_kernel and max_kernel.
+ *
+ * The array is split into leaves of whole blocks, as with parallel_reduce;
+ * each leaf is reduced by a kernel that is vectorized for the widest
+ * instruction set that the processor supports (SSE2, AVX2 or AVX-512, as
+ * found out at runtime) and that keeps several partial results at a time to
+ * hide the latency of the additions. Types that do not fit in vectors, or
+ * builds that cannot pick the instruction set at runtime, use the same
+ * kernels one element at a time.
+ *
+ * With fast_summation, how the floating point numbers are grouped depends on
+ * the splits and steals, and so can change from run to run in the last few
+ * bits. With reproducible_summation, every block is reduced on its own with
+ * a fixed number of partial results and the blocks are combined pairwise in
+ * a fixed order; the answer then depends on the input and the block size
+ * alone --- not on the number of threads, the schedule or the instruction
+ * set. This costs an extra pass over one slot per block. (Compiling with
+ * -ffast-math lets the compiler regroup the additions and voids this.)
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance. The library instance
+ *                    must use pfunc::use_default for the Functor! That is, it
+ *                    should use virtual operator().
+ * Kernel: One of the kernels above.
+ * ValueType: The type of the elements.
+ * SpaceType: The space to split the array with.
+ */
+template <typename PFuncInstanceType /*type of PFunc instance*/,
+          typename Kernel /*what to reduce with*/,
+          typename ValueType /*type of the elements*/,
+          typename SpaceType = space_1D /*type of the space*/>
+struct parallel_transform_reduce : pfunc::virtual_functor {
+  public:
+  typedef typename PFuncInstanceType::taskmgr TaskMgrType;
+
+  private:
+  typedef detail::transform_reduce_leaf<Kernel, ValueType> LeafType;
+  typedef detail::transform_reduce_blocks<Kernel, ValueType> BlocksType;
+
+  const ValueType* first1;
+  const ValueType* first2;
+  size_t length;
+  TaskMgrType& taskmgr;
+  summation_mode mode;
+  size_t block_size;
+  detail::simd_isa isa;
+  ValueType result;
+
+  /**
+   * @param[in] block_size The number of elements in a block; if 0, as many
+   *                       as fit in transform_reduce_block_bytes.
+   * @return The block size to use.
+   */
+  static size_t get_block_size (const size_t block_size) {
+    return (0 == block_size) ?
+      SpaceType::template granularity<ValueType>
+        (detail::transform_reduce_block_bytes) : block_size;
+  }
+
+  public:
+  /**
+   * Constructor
+   * @param[in] first Beginning of the array.
+   * @param[in] last End of the array.
+   * @param[in] taskmgr The task manager to use.
+   * @param[in] mode How to add up floating point numbers.
+   * @param[in] block_size The number of elements in a block; if 0, a block
+   *                       holds 16KB worth of elements.
+   */
+  parallel_transform_reduce (const ValueType* first,
+                             const ValueType* last,
+                             TaskMgrType& taskmgr,
+                             const summation_mode mode = fast_summation,
+                             const size_t block_size = 0) :
+    first1 (first), first2 (first), length (last-first), taskmgr (taskmgr),
+    mode (mode), block_size (get_block_size (block_size)),
+    isa (detail::get_simd_isa ()),
+    result (Kernel::template identity<ValueType> ()) {}
+
+  /**
+   * Constructor for kernels on two arrays.
+   * @param[in] first1 Beginning of the first array.
+   * @param[in] last1 End of the first array.
+   * @param[in] first2 Beginning of the second array.
+   * @param[in] taskmgr The task manager to use.
+   * @param[in] mode How to add up floating point numbers.
+   * @param[in] block_size The number of elements in a block; if 0, a block
+   *                       holds 16KB worth of elements.
+   */
+  parallel_transform_reduce (const ValueType* first1,
+                             const ValueType* last1,
+                             const ValueType* first2,
+                             TaskMgrType& taskmgr,
+                             const summation_mode mode = fast_summation,
+                             const size_t block_size = 0) :
+    first1 (first1), first2 (first2), length (last1-first1),
+    taskmgr (taskmgr), mode (mode),
+    block_size (get_block_size (block_size)),
+    isa (detail::get_simd_isa ()),
+    result (Kernel::template identity<ValueType> ()) {}
+
+  /**
+   * Operator that does the parallelization.
+   */
+  void operator() (void) {
+    ValueType reduction = Kernel::template identity<ValueType> ();
+    const bool run_serially = (1 >= taskmgr.get_num_threads () ||
+                               length <= block_size);
+
+    if (0 == length) {
+      // Nothing to reduce
+    } else if (fast_summation == mode && run_serially) {
+      reduction = detail::simd_reduce<Kernel, ValueType, false>
+                    (isa, first1, first2, length);
+    } else if (fast_summation == mode) {
+      LeafType leaf (first1, first2, isa);
+      parallel_reduce<PFuncInstanceType, LeafType, SpaceType>
+        (SpaceType (0, length, block_size), leaf, taskmgr)();
+      reduction = leaf.get_result ();
+    } else {
+      std::vector<ValueType> partials ((length+block_size-1)/block_size);
+      BlocksType blocks;
+      blocks.x = first1;
+      blocks.y = first2;
+      blocks.isa = isa;
+      blocks.block_size = block_size;
+      blocks.partials = &partials[0];
+
+      if (run_serially) blocks (SpaceType (0, length, block_size));
+      else parallel_for<PFuncInstanceType, BlocksType, SpaceType>
+             (SpaceType (0, length, block_size), blocks, taskmgr)();
+
+      reduction = detail::combine_pairwise<Kernel> (&partials[0],
+                                                    partials.size ());
+    }
+
+    result = Kernel::finish (reduction);
+  }
+
+  /**
+   * @return The result of the reduction.
+   */
+  ValueType get_result () const { return result; }
+
+  /**
+   * @return The name of the instruction set that the kernels use.
+   */
+  const char* get_instruction_set () const {
+    return detail::simd_isa_name (isa);
+  }
+};
+
+} // namespace pfunc
+
+#endif // PFUNC_PARALLEL_TRANSFORM_REDUCE_HPP
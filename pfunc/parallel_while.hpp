@@ -2,21 +2,104 @@
 #define PFUNC_PARALLEL_WHILE_HPP
 
 #include <pfunc/pfunc.hpp>
+#include <pfunc/mutex.hpp>
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 namespace pfunc {
+
+/**
+ * Handle through which a WhileExecutable adds more elements to the
+ * parallel_while that is running it. The elements added are processed
+ * before the parallel_while completes.
+ *
+ * Types:
+ * ValueType: The type of the elements.
+ */
+template <typename ValueType>
+struct parallel_while_feeder {
+  /**
+   * Virtual destructor
+   */
+  virtual ~parallel_while_feeder () {}
+
+  /**
+   * Adds an element to be processed.
+   * @param[in] value The element; it is copied.
+   */
+  virtual void add (const ValueType& value) = 0;
+};
+
+namespace detail {
+  /**
+   * Tag for a WhileExecutable that takes a parallel_while_feeder.
+   */
+  struct while_with_feeder_tag {};
+
+  /**
+   * Tag for a WhileExecutable that takes only the element.
+   */
+  struct while_without_feeder_tag {};
+
+  /**
+   * Maps the result of the check in while_feeder_category to a tag.
+   */
+  template <bool WithFeeder>
+  struct while_feeder_select { typedef while_without_feeder_tag type; };
+
+  template <>
+  struct while_feeder_select<true> { typedef while_with_feeder_tag type; };
+
+  /**
+   * Works out whether WhileExecutable has a const operator() that takes an
+   * element (by value or by const reference) and a feeder.
+   */
+  template <typename WhileExecutable, typename ValueType>
+  struct while_feeder_category {
+    typedef parallel_while_feeder<ValueType> feeder_type;
+
+    template <typename U, void (U::*)(const ValueType&, feeder_type&) const>
+    struct by_reference {};
+
+    template <typename U, void (U::*)(ValueType, feeder_type&) const>
+    struct by_value {};
+
+    template <typename U> static char check (by_reference<U,&U::operator()>*);
+    template <typename U> static char check (by_value<U,&U::operator()>*);
+    template <typename U> static long check (...);
+
+    typedef typename while_feeder_select<
+      sizeof (check<WhileExecutable>(0)) == sizeof (char)>::type type;
+  };
+} /* namespace detail */
+
 /**
- * A structure that implements the parallel_while loop. To initialize, a 
- * range of InputIterators is given. Each element in the given range is 
- * executed in parallel by spawning tasks. 
+ * A structure that implements the parallel_while loop. To initialize, a
+ * range of InputIterators is given. Each element in the given range is
+ * executed in parallel by spawning tasks.
+ *
+ * One worker per thread pulls the elements out of the range, chunk_size at
+ * a time; the range is only touched under a lock, so the InputIterator need
+ * not be thread-safe. If WhileExecutable takes a parallel_while_feeder as
+ * its second argument, it can add more elements (for example, the
+ * neighbours of a vertex in a graph traversal). The elements added go onto
+ * a stack of the worker that added them; when the stack gets deeper than
+ * 2*chunk_size, chunk_size elements from its bottom are handed off as a
+ * task that other threads can steal. These tasks are recycled once they
+ * complete, so nothing is allocated per element and the memory held is
+ * bounded by the number of elements waiting to be processed.
+ *
+ * The elements are copied; the order in which they are processed is not
+ * defined.
  *
  * Types:
  * PFuncInstanceType: The type of PFunc library instance. The library instance
- *                    must use pfunc::use_default for the Functor! That is, it 
+ *                    must use pfunc::use_default for the Functor! That is, it
  *                    should use virtual operator().
  * InputIterator: An input iterator that has value_type.
  * WhileExecutable: A functor that is a model of WhileExecutable concept.
- * 
+ *
  */
 template <typename PFuncInstanceType, /*type of PFunc instance*/
           typename InputIterator, /*type of the iterator*/
@@ -26,38 +109,117 @@ struct parallel_while : pfunc::virtual_functor {
   typedef typename PFuncInstanceType::taskmgr TaskMgrType;
   typedef typename PFuncInstanceType::task TaskType;
   typedef typename InputIterator::value_type ValueType;
+  typedef parallel_while_feeder<ValueType> FeederType;
 
   private:
+  /**
+   * A stack of elements that is processed by one task. Elements fed while
+   * processing the block are pushed onto the same stack.
+   */
+  struct block : public FeederType, public pfunc::virtual_functor {
+    parallel_while* loop; /**< The loop that the block belongs to */
+    TaskType task; /**< Task that processes the block */
+    std::vector<ValueType> items; /**< Elements yet to be processed */
+    bool reads_input; /**< Whether to refill the block from the range */
+
+    block () : loop (NULL), reads_input (false) {}
+
+    void add (const ValueType& value) { items.push_back (value); }
+
+    void operator() (void) { loop->run_block (*this); }
+  };
+
   InputIterator first;
   InputIterator last;
   const WhileExecutable& func;
   TaskMgrType& taskmgr;
+  size_t chunk_size;
+  mutex input_lock; /**< Guards first and input_done */
+  bool input_done; /**< Whether first has reached last */
 
   /**
-   * A structure to execute the base case of WhileExecutable. We need this 
-   * structure because PFunc only accepts void operator()(void), but we 
-   * need void operator()(const ValueType&). This is the wrapper that 
-   * allows execution by PFunc.
+   * Moves up to chunk_size elements from the range onto a stack so that
+   * they come off it in the order of the range.
+   * @param[in,out] items The stack to fill.
+   * @return true if any element was moved.
    */
-  struct while_wrapper : pfunc::virtual_functor {
-    private:
-    const WhileExecutable& func;
-    const ValueType& value;
-
-    public:
-    /**
-     * Constructor
-     * @param[in] func The func that is executed on value.
-     * @param[in] value The value on which func is to be executed.
-     */
-    while_wrapper (const WhileExecutable& func, const ValueType& value) :
-      func (func), value (value) {}
-
-    /**
-     * The wrapper operator() function that invokes func() with value.
-     */
-    void operator()(void) { func (value); }
-  };
+  bool fill (std::vector<ValueType>& items) {
+    const size_t old_size = items.size ();
+    input_lock.lock ();
+    while (!input_done && items.size ()-old_size < chunk_size) {
+      if (first != last) {
+        items.push_back (*first);
+        ++first;
+      } else {
+        input_done = true;
+      }
+    }
+    input_lock.unlock ();
+    std::reverse (items.begin ()+old_size, items.end ());
+    return (old_size != items.size ());
+  }
+
+  /**
+   * Invokes a WhileExecutable that takes a feeder.
+   */
+  void invoke (const ValueType& value,
+               FeederType& feeder,
+               detail::while_with_feeder_tag) {
+    func (value, feeder);
+  }
+
+  /**
+   * Invokes a WhileExecutable that takes only the element.
+   */
+  void invoke (const ValueType& value,
+               FeederType&,
+               detail::while_without_feeder_tag) {
+    func (value);
+  }
+
+  /**
+   * Processes the elements of a block till there are none left, handing
+   * off the bottom of the stack to other tasks whenever it gets too deep.
+   * @param[in,out] current The block to process.
+   */
+  void run_block (block& current) {
+    typedef typename detail::while_feeder_category<WhileExecutable,
+                                                   ValueType>::type category;
+    std::vector<block*> handed_off;
+
+    while (!current.items.empty () ||
+           (current.reads_input && fill (current.items))) {
+      const ValueType value (current.items.back ());
+      current.items.pop_back ();
+      invoke (value, current, category ());
+
+      if (current.items.size () >= 2*chunk_size) {
+        // Reuse a block whose task has completed, if there is one.
+        block* spare = NULL;
+        for (size_t i=0; i<handed_off.size () && NULL==spare; ++i)
+          if (pfunc::test (taskmgr, handed_off[i]->task))
+            spare = handed_off[i];
+        if (NULL == spare) {
+          spare = new block ();
+          spare->loop = this;
+          handed_off.push_back (spare);
+        }
+
+        spare->items.assign (current.items.begin (),
+                             current.items.begin ()+chunk_size);
+        current.items.erase (current.items.begin (),
+                             current.items.begin ()+chunk_size);
+        pfunc::spawn (taskmgr, spare->task, *spare);
+      }
+    }
+
+    // Every block has been spawned again since test() last found it done;
+    // so, each one is waited on exactly once here.
+    for (size_t i=0; i<handed_off.size (); ++i) {
+      pfunc::wait (taskmgr, handed_off[i]->task);
+      delete handed_off[i];
+    }
+  }
 
   public:
   /**
@@ -66,44 +228,41 @@ struct parallel_while : pfunc::virtual_functor {
    * @param[in] last The iterator pointing to the last element.
    * @param[in] func The function to execute on each object.
    * @param[in] taskmgr The task manager to use for this parallel_while.
+   * @param[in] chunk_size The number of elements that a worker takes from
+   *                       the range (or hands off) at a time.
    *
    * TODO: Make parallel_while work with global task manager.
    */
   parallel_while (InputIterator first,
                   InputIterator last,
                   const WhileExecutable& func,
-                  TaskMgrType& taskmgr) : 
-     first (first), last(last), func(func), taskmgr (taskmgr) {}
+                  TaskMgrType& taskmgr,
+                  const size_t chunk_size = 4) :
+     first (first), last(last), func(func), taskmgr (taskmgr),
+     chunk_size ((0 == chunk_size) ? 1 : chunk_size), input_done (false) {}
 
   /**
    * Operator that does the parallelization.
    */
   void operator() (void) {
-    std::vector<TaskType*> tasks;
-    std::vector<while_wrapper*> functors;
-    // Go through each element in the list and spawn a new task for each 
-    // element in [first, last). One optimization that we might want to 
-    // perform is that we pick elements from this list in parallel instead 
-    // of sequentially --- but that is for later.
-    int task_index = 0;
-    while (first != last) {
-      tasks.push_back (new TaskType());
-      functors.push_back (new while_wrapper (func, *first));
-      pfunc::spawn (taskmgr, 
-                    *(tasks [task_index]),
-                    *(functors [task_index]));
-      ++first;
-      ++task_index;
+    const unsigned int num_workers =
+      (0 == taskmgr.get_num_threads ()) ? 1 : taskmgr.get_num_threads ();
+
+    // Every worker reads from the range; we are worker 0.
+    block* workers = new block [num_workers];
+    for (unsigned int i=0; i<num_workers; ++i) {
+      workers[i].loop = this;
+      workers[i].reads_input = true;
+      workers[i].items.reserve (2*chunk_size);
     }
+    for (unsigned int i=1; i<num_workers; ++i)
+      pfunc::spawn (taskmgr, workers[i].task, workers[i]);
 
-    // Now that all of them have been spawned, wait on them.
-    pfunc::wait_all (taskmgr, tasks.begin(), tasks.end());
+    run_block (workers[0]);
 
-    // Deallocate everything.
-    for (int i=0; i<task_index; ++i) {
-      delete tasks[i];
-      delete functors[i];
-    }
+    for (unsigned int i=1; i<num_workers; ++i)
+      pfunc::wait (taskmgr, workers[i].task);
+    delete [] workers;
   }
 };
 }
@@ -0,0 +1,485 @@
+#ifndef PFUNC_PARTITIONER_HPP
+#define PFUNC_PARTITIONER_HPP
+
+/**
+ * \file partitioner.hpp
+ * \brief Implementation of the partitioners used by parallel_for/reduce
+ * \author Prabhanjan Kambadur
+ *
+ * A partitioner decides how far parallel_for and parallel_reduce split their
+ * iteration spaces. Whatever the partitioner says, a space that cannot be
+ * split (see Space::can_split) is never split; so, base_case_size remains the
+ * smallest grain. A partitioner is a copyable object that travels with each
+ * subspace and models the following interface:
+ *
+ *   template <typename TaskManager> void start (TaskManager&);
+ *     Called by the thread that is about to work on the subspace.
+ *   bool should_split () const;
+ *     Whether the subspace should be split further.
+ *   Partitioner split (const size_t& arity, const size_t& index) const;
+ *     Called when the subspace is split 'arity' ways. Returns the partitioner
+ *     of the 'index'th subspace. Subspace 0 is kept by the splitting thread
+ *     and the rest are spawned off.
+ *   unsigned int queue_number () const;
+ *     The task queue to spawn the subspace into (QUEUE_CURRENT_THREAD if the
+ *     partitioner does not care).
+ *
+ * simple_partitioner: Splits till the space cannot be split. This is what
+ *                     parallel_for and parallel_reduce have always done.
+ * auto_partitioner: Splits into a few pieces per thread to begin with, and
+ *                   splits a piece further only when it has been stolen,
+ *                   that is, when some thread has run out of work. Uniform
+ *                   loops are no longer split into a task per grain, and
+ *                   irregular loops still get split where it is needed.
+ * affinity_partitioner: Splits into a fixed number of pieces per thread and
+ *                   remembers the task queue of the thread that ran each
+ *                   piece. When the same affinity_partitioner is passed to
+ *                   the next loop, each piece is spawned into the queue that
+ *                   it ran from the last time; so, loops that run over the
+ *                   same data again and again find the data in the caches.
+ *                   The pieces can still be stolen. Please create one task
+ *                   queue per thread for this to be of any use.
+ *
+ * parallel_for also accepts OpenMP-style loop schedules in place of a
+ * partitioner. With a loop schedule, there is no recursive splitting at all:
+ * one task is spawned per thread and each of these tasks asks the schedule
+ * for [begin, end) chunks of the (1-D) space till there are none left. A
+ * loop schedule models the following interface:
+ *
+ *   void start (const size_t& begin, const size_t& end,
+ *               const unsigned int& num_workers);
+ *     Called once before the workers start.
+ *   bool next (const unsigned int& rank, const unsigned int& round,
+ *              size_t& begin, size_t& end);
+ *     Gives the 'round'th chunk of worker 'rank'. Returns false when the
+ *     worker has nothing left to do.
+ *
+ * static_schedule: One contiguous block per worker.
+ * dynamic_schedule: Workers grab fixed-size chunks off a shared counter.
+ * guided_schedule: Like dynamic_schedule, but the chunks start out large and
+ *                  shrink in proportion to the iterations left.
+ *
+ * Partitioners and loop schedules are told apart by their category.
+ */
+#include <cstddef>
+#include <cassert>
+#include <vector>
+#include <pfunc/config.h>
+#include <pfunc/environ.hpp>
+#include <pfunc/pfunc_atomics.h>
+#include <pfunc/attribute.hpp>
+#include <pfunc/no_copy.hpp>
+
+namespace pfunc {
+
+/**
+ * Category of the partitioners that split the space recursively.
+ */
+struct recursive_partitioner_tag {};
+
+/**
+ * Category of the OpenMP-style loop schedules.
+ */
+struct loop_schedule_tag {};
+
+/**
+ * Splits the space till it cannot be split any further.
+ */
+struct simple_partitioner {
+  typedef recursive_partitioner_tag category; /**< Splits recursively */
+
+  /**
+   * Nothing to do.
+   */
+  template <typename TaskManager>
+  void start (TaskManager&) {}
+
+  /**
+   * \return Always true.
+   */
+  bool should_split () const { return true; }
+
+  /**
+   * \return A copy of this partitioner.
+   */
+  simple_partitioner split (const size_t&, const size_t&) const { 
+    return *this; 
+  }
+
+  /**
+   * \return QUEUE_CURRENT_THREAD.
+   */
+  unsigned int queue_number () const { return detail::QUEUE_CURRENT_THREAD; }
+};
+
+/**
+ * Splits the space into PFUNC_PIECES_PER_THREAD pieces per thread, and
+ * splits a piece that is stolen into PFUNC_PIECES_ON_STEAL more pieces.
+ */
+struct auto_partitioner {
+  typedef recursive_partitioner_tag category; /**< Splits recursively */
+
+  private:
+  static const unsigned int PFUNC_PIECES_PER_THREAD = 4; /**< To begin with */
+  static const unsigned int PFUNC_PIECES_ON_STEAL = 4; /**< After a steal */
+
+  unsigned int pieces; /**< Number of pieces to split into; 0 to begin */
+  unsigned int owner; /**< Thread that spawned (or ran) this piece */
+
+  public:
+  /**
+   * Constructor
+   */
+  auto_partitioner () : pieces (0), owner (0) {}
+
+  /**
+   * Works out the number of pieces the first time around. After that, a
+   * change of thread means that the piece was stolen.
+   *
+   * \param [in] taskmgr The task manager that is running the loop.
+   */
+  template <typename TaskManager>
+  void start (TaskManager& taskmgr) {
+    const unsigned int my_thread_id = taskmgr.current_thread_id ();
+    if (0 == pieces) {
+      pieces = PFUNC_PIECES_PER_THREAD*(taskmgr.get_num_threads ());
+    } else if (owner != my_thread_id && PFUNC_PIECES_ON_STEAL > pieces) {
+      pieces = PFUNC_PIECES_ON_STEAL;
+    }
+    owner = my_thread_id;
+  }
+
+  /**
+   * \return true if the piece is to be split into more pieces.
+   */
+  bool should_split () const { return (1 < pieces); }
+
+  /**
+   * Shares the pieces out among the subspaces.
+   *
+   * \param [in] arity The number of subspaces.
+   * \return The partitioner of the subspaces.
+   */
+  auto_partitioner split (const size_t& arity, const size_t&) const {
+    auto_partitioner subspace_partitioner (*this);
+    subspace_partitioner.pieces = 
+      static_cast<unsigned int>((pieces+arity-1)/arity);
+    return subspace_partitioner;
+  }
+
+  /**
+   * \return QUEUE_CURRENT_THREAD.
+   */
+  unsigned int queue_number () const { return detail::QUEUE_CURRENT_THREAD; }
+};
+
+/**
+ * Splits the space into PFUNC_PIECES_PER_THREAD pieces per thread and 
+ * replays the task queues that the pieces ran from in the previous loop.
+ * Copies of an affinity_partitioner share the record of the task queues.
+ */
+struct affinity_partitioner {
+  typedef recursive_partitioner_tag category; /**< Splits recursively */
+
+  private:
+  static const unsigned int PFUNC_PIECES_PER_THREAD = 4; /**< # of pieces */
+
+  /**
+   * The task queue that each piece ran from the last time.
+   */
+  struct affinity_map : public detail::no_copy {
+    volatile int ref_count; /**< Number of partitioners sharing the map */
+    std::vector<unsigned int> queue_numbers; /**< One per piece */
+
+    affinity_map () : ref_count (1) {}
+  };
+
+  affinity_map* map; /**< Shared by the copies of this partitioner */
+  unsigned int pieces; /**< Number of pieces to split into; 0 to begin */
+  unsigned int first_piece; /**< Number of the first of the pieces */
+
+  /**
+   * Lets go of the map, deleting it if nobody else uses it.
+   */
+  void release () {
+    if (1 == pfunc_fetch_and_add_32 (&(map->ref_count), -1)) delete map;
+  }
+
+  public:
+  /**
+   * Constructor
+   */
+  affinity_partitioner () : map (new affinity_map), 
+                            pieces (0), 
+                            first_piece (0) {}
+
+  /**
+   * Copy constructor. The copy shares the record of the task queues.
+   *
+   * \param [in] other The partitioner to copy.
+   */
+  affinity_partitioner (const affinity_partitioner& other) : 
+    map (other.map), pieces (other.pieces), first_piece (other.first_piece) {
+    pfunc_fetch_and_add_32 (&(map->ref_count), 1);
+  }
+
+  /**
+   * Assignment. This partitioner shares the record of the task queues with
+   * other from now on.
+   *
+   * \param [in] other The partitioner to copy.
+   */
+  affinity_partitioner& operator= (const affinity_partitioner& other) {
+    pfunc_fetch_and_add_32 (&(other.map->ref_count), 1);
+    release ();
+    map = other.map;
+    pieces = other.pieces;
+    first_piece = other.first_piece;
+    return *this;
+  }
+
+  /**
+   * Destructor
+   */
+  ~affinity_partitioner () { release (); }
+
+  /**
+   * Works out the number of pieces at the root of the loop; after that, 
+   * notes down the task queue of the calling thread for the piece.
+   *
+   * \param [in] taskmgr The task manager that is running the loop.
+   */
+  template <typename TaskManager>
+  void start (TaskManager& taskmgr) {
+    if (0 == pieces) {
+      pieces = PFUNC_PIECES_PER_THREAD*(taskmgr.get_num_threads ());
+      if (pieces != map->queue_numbers.size ())
+        map->queue_numbers.assign (pieces, detail::QUEUE_CURRENT_THREAD);
+    }
+    map->queue_numbers[first_piece] = taskmgr.current_queue_number ();
+  }
+
+  /**
+   * \return true if the piece is to be split into more pieces.
+   */
+  bool should_split () const { return (1 < pieces); }
+
+  /**
+   * Shares the pieces out among the subspaces.
+   *
+   * \param [in] arity The number of subspaces.
+   * \param [in] index The subspace whose partitioner is required.
+   * \return The partitioner of the subspace.
+   */
+  affinity_partitioner split (const size_t& arity, const size_t& index) const {
+    affinity_partitioner subspace_partitioner (*this);
+    const unsigned int subspace_pieces = 
+      static_cast<unsigned int>((pieces+arity-1)/arity);
+    const unsigned int last_piece = 
+      static_cast<unsigned int>(map->queue_numbers.size ()-1);
+    subspace_partitioner.pieces = subspace_pieces;
+    subspace_partitioner.first_piece = 
+      first_piece + static_cast<unsigned int>(index)*subspace_pieces;
+    if (subspace_partitioner.first_piece > last_piece) 
+      subspace_partitioner.first_piece = last_piece;
+    return subspace_partitioner;
+  }
+
+  /**
+   * \return The task queue that the piece ran from the last time.
+   */
+  unsigned int queue_number () const {
+    return map->queue_numbers[first_piece];
+  }
+};
+
+/**
+ * Gives each worker one contiguous block of (nearly) the same size.
+ */
+struct static_schedule {
+  typedef loop_schedule_tag category; /**< Hands out chunks */
+
+  private:
+  size_t space_begin; /**< Beginning of the iteration space */
+  size_t space_end; /**< End of the iteration space */
+  unsigned int num_workers; /**< Number of workers sharing the space */
+
+  public:
+  /**
+   * Constructor
+   */
+  static_schedule () : space_begin (0), space_end (0), num_workers (1) {}
+
+  /**
+   * \param [in] begin Beginning of the iteration space.
+   * \param [in] end End of the iteration space.
+   * \param [in] num_workers Number of workers sharing the space.
+   */
+  void start (const size_t& begin, 
+              const size_t& end, 
+              const unsigned int& num_workers) {
+    space_begin = begin;
+    space_end = end;
+    this->num_workers = num_workers;
+  }
+
+  /**
+   * \param [in] rank The worker asking for a chunk.
+   * \param [in] round The number of chunks already given to the worker.
+   * \param [out] begin Beginning of the chunk.
+   * \param [out] end End of the chunk.
+   * \return true if the worker got a chunk.
+   */
+  bool next (const unsigned int& rank, 
+             const unsigned int& round,
+             size_t& begin, 
+             size_t& end) const {
+    const size_t length = space_end - space_begin;
+    begin = space_begin + (length*rank)/num_workers;
+    end = space_begin + (length*(rank+1))/num_workers;
+    return (0 == round && begin < end);
+  }
+};
+
+/**
+ * Hands out chunks of a fixed size in the order in which they are asked for.
+ */
+struct dynamic_schedule {
+  typedef loop_schedule_tag category; /**< Hands out chunks */
+
+  private:
+  ALIGN64 volatile int next_chunk; /**< Number of the next chunk to hand out */
+  size_t chunk_size; /**< Number of iterations in a chunk */
+  size_t space_begin; /**< Beginning of the iteration space */
+  size_t space_end; /**< End of the iteration space */
+
+  public:
+  /**
+   * Constructor
+   *
+   * \param [in] chunk_size Number of iterations in a chunk.
+   */
+  dynamic_schedule (const size_t& chunk_size = 1) : next_chunk (0),
+                                                    chunk_size (chunk_size),
+                                                    space_begin (0),
+                                                    space_end (0) {
+    assert (0 < chunk_size);
+  }
+
+  /**
+   * Copy constructor. The chunks handed out are not copied.
+   */
+  dynamic_schedule (const dynamic_schedule& other) : 
+    next_chunk (0), chunk_size (other.chunk_size), 
+    space_begin (other.space_begin), space_end (other.space_end) {}
+
+  /**
+   * \param [in] begin Beginning of the iteration space.
+   * \param [in] end End of the iteration space.
+   */
+  void start (const size_t& begin, const size_t& end, const unsigned int&) {
+    space_begin = begin;
+    space_end = end;
+    next_chunk = 0;
+    assert ((end-begin)/chunk_size < 0x7FFFFFFF);
+  }
+
+  /**
+   * \param [out] begin Beginning of the chunk.
+   * \param [out] end End of the chunk.
+   * \return true if the worker got a chunk.
+   */
+  bool next (const unsigned int&, 
+             const unsigned int&, 
+             size_t& begin, 
+             size_t& end) {
+    const size_t chunk = 
+      static_cast<size_t>(pfunc_fetch_and_add_32 (&next_chunk, 1));
+    if (chunk_size*chunk >= space_end-space_begin) return false;
+    begin = space_begin + chunk_size*chunk;
+    end = (space_end-begin > chunk_size) ? begin+chunk_size : space_end;
+    return true;
+  }
+};
+
+/**
+ * Hands out chunks that are 1/num_workers of the iterations that are left,
+ * but never smaller than the minimum chunk size.
+ */
+struct guided_schedule {
+  typedef loop_schedule_tag category; /**< Hands out chunks */
+
+  private:
+  ALIGN64 volatile int next_unit; /**< First unit that is not handed out */
+  size_t unit_size; /**< Minimum number of iterations in a chunk */
+  size_t space_begin; /**< Beginning of the iteration space */
+  size_t space_end; /**< End of the iteration space */
+  int num_units; /**< Number of units in the space */
+  int num_workers; /**< Number of workers sharing the space */
+
+  public:
+  /**
+   * Constructor
+   *
+   * \param [in] min_chunk_size Minimum number of iterations in a chunk.
+   */
+  guided_schedule (const size_t& min_chunk_size = 1) : 
+    next_unit (0), unit_size (min_chunk_size), space_begin (0), 
+    space_end (0), num_units (0), num_workers (1) {
+    assert (0 < min_chunk_size);
+  }
+
+  /**
+   * Copy constructor. The chunks handed out are not copied.
+   */
+  guided_schedule (const guided_schedule& other) : 
+    next_unit (0), unit_size (other.unit_size), 
+    space_begin (other.space_begin), space_end (other.space_end), 
+    num_units (other.num_units), num_workers (other.num_workers) {}
+
+  /**
+   * \param [in] begin Beginning of the iteration space.
+   * \param [in] end End of the iteration space.
+   * \param [in] num_workers Number of workers sharing the space.
+   */
+  void start (const size_t& begin, 
+              const size_t& end, 
+              const unsigned int& num_workers) {
+    space_begin = begin;
+    space_end = end;
+    assert ((end-begin)/unit_size < 0x7FFFFFFF);
+    num_units = static_cast<int>((end-begin+unit_size-1)/unit_size);
+    this->num_workers = static_cast<int>(num_workers);
+    next_unit = 0;
+  }
+
+  /**
+   * \param [out] begin Beginning of the chunk.
+   * \param [out] end End of the chunk.
+   * \return true if the worker got a chunk.
+   */
+  bool next (const unsigned int&, 
+             const unsigned int&, 
+             size_t& begin, 
+             size_t& end) {
+    int first_unit = next_unit;
+    int units;
+    while (true) {
+      if (first_unit >= num_units) return false;
+      units = (num_units-first_unit)/num_workers;
+      if (0 == units) units = 1;
+      const int seen = 
+        pfunc_compare_and_swap_32 (&next_unit, first_unit+units, first_unit);
+      if (seen == first_unit) break;
+      first_unit = seen;
+    }
+    begin = space_begin + unit_size*first_unit;
+    end = space_begin + unit_size*(first_unit+units);
+    if (end > space_end) end = space_end;
+    return true;
+  }
+};
+
+} /* namespace pfunc */
+
+#endif // PFUNC_PARTITIONER_HPP
@@ -202,6 +202,34 @@ namespace pfunc {
     barr = grp.get_barrier ();
   }
 
+  /**
+   * Cancels all the tasks of the group that have not started running. They 
+   * complete without executing their functor and can be waited on as usual.
+   *
+   * \param [in,out] grp Group that is to be cancelled.
+   */
+  static inline void group_cancel (group& grp) {
+    grp.cancel ();
+  }
+
+  /**
+   * Clears the cancellation of the group so that it can be reused.
+   *
+   * \param [in,out] grp Group whose cancellation is to be cleared.
+   */
+  static inline void group_cancel_clear (group& grp) {
+    grp.clear_cancel ();
+  }
+
+  /**
+   * \param [in] grp Group whose cancellation status is to be retrieved.
+   * \param [out] cancelled true if the group has been cancelled.
+   */
+  static inline void group_cancelled (const group& grp,
+                                      bool& cancelled) {
+    cancelled = grp.is_cancelled ();
+  }
+
 /****************************************************************************
  * All the above functions make use of the taskmanager as a parameter. As 
  * a result, we have two versions of these functions. A global version that
@@ -258,6 +286,23 @@ namespace pfunc {
     PFUNC_CXX_CATCH_AND_RETHROW()
   }
 
+  /** 
+   * Long running tasks can poll this to return early once their group has 
+   * been cancelled (see group_cancel).
+   *
+   * \param [in] tmanager The task manager which is running the current task.
+   * \return true if the group of the calling task has been cancelled.
+   */
+  template <typename TaskManager>
+  static inline bool is_cancelled (const TaskManager& tmanager) {
+    bool cancelled = false;
+    PFUNC_START_TRY_BLOCK()
+    cancelled = const_cast<TaskManager&>(tmanager).current_task_cancelled ();
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CXX_CATCH_AND_RETHROW()
+    return cancelled;
+  }
+
   /**
    * \param [in] taskmgr The taskmanager that is running the task.
    * \param [in,out] task The task to be waited on.
@@ -283,14 +328,40 @@ namespace pfunc {
   }
 
   /**
-   * Waits for one of the tasks specified in the set. The algorithm implemented
-   * is one of test_all () followed by exponential backoff.
+   * Waits for the first of the tasks specified in the set to complete. Each
+   * of the tasks signals a common notifier when it completes, so that the 
+   * caller sleeps (or, if the tasks are nested, executes other tasks) rather 
+   * than polling the tasks. The task that completed first is waited on, the
+   * others are left untouched and have to be waited on as usual.
    *
    * \param [in] tmanager The task manager that is running the tasks.
    * \param [in] first First of the tasks to be waited on.
    * \param [in] last End marker for the tasks to be waited on (true last+1).
-   * \param [out] completion_arr Array that contains the completion status.
-   * 
+   * \return Index of the task that completed first (0 if the set is empty).
+   */     
+  template <typename TaskManager, typename ForwardIterator>
+  static inline unsigned int wait_any (TaskManager& tmanager,
+                                       ForwardIterator first, 
+                                       ForwardIterator last)  {
+    unsigned int index = 0;
+
+    PFUNC_START_TRY_BLOCK()                                                  
+    index = detail::wait_any (tmanager, first, last);
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CXX_CATCH_AND_RETHROW()
+
+    return index;
+  }
+
+  /**
+   * Waits for the first of the tasks specified in the set to complete.
+   * \see wait_any
+   *
+   * \param [in] tmanager The task manager that is running the tasks.
+   * \param [in] first First of the tasks to be waited on.
+   * \param [in] last End marker for the tasks to be waited on (true last+1).
+   * \param [out] completion_arr Array that contains the completion status;
+   *             only the entry of the task that completed first is set.
    */     
   template <typename TaskManager, typename ForwardIterator>
   static inline void wait_any (TaskManager& tmanager,
@@ -298,19 +369,9 @@ namespace pfunc {
                         ForwardIterator last,
                         int* completion_arr)  {
     PFUNC_START_TRY_BLOCK()                                                  
-    unsigned int loop_count = 1;
-    while (!pfunc_test_all (tmanager, first, last, completion_arr)) {
-    /** 
-     * Exponential backoff can be implemented using "pause" command that both
-     * Intel and AMD architectures provide. That being said, we want to not
-     * including any architecture specific code. Quite the quandry :-/. Note
-     * that on WINDOWS, we are not doing an exponential backoff since the
-     * minimum resolution of the Sleep() function is 1 MilliSecond. So, we
-     * always sleep for that amount of time since its quite large.
-     */
-      pfunc::detail::thread::yield ();
-      loop_count = 1;
-    }
+    const unsigned int index = pfunc::wait_any (tmanager, first, last);
+    for (unsigned int i=0; first != last; ++first, ++i) 
+      completion_arr[i] = (index == i);
     PFUNC_END_TRY_BLOCK()
     PFUNC_CXX_CATCH_AND_RETHROW()
  }
@@ -358,18 +419,21 @@ namespace pfunc {
   * \param [in] first First of the tasks to be tested on.
   * \param [in] last End marker for the tasks to be tested on (true last+1).
   * \param [out] completion_arr Contains the results of the tests.
+  * \result True if all the tasks completed, false otherwise.
   */     
   template <typename TaskManager, typename ForwardIterator>
   static inline bool test_all (TaskManager& tmanager, 
                         ForwardIterator first, 
                         ForwardIterator last,
                         int* completion_arr)  {
-    bool return_value = false;
+    bool return_value = true;
 
    PFUNC_START_TRY_BLOCK()                                                  
     int i = 0;
-    while (first != last) 
-      completion_arr[i] = return_value = test (tmanager, *first++);
+    while (first != last) {
+      completion_arr[i] = test (tmanager, *first++);
+      return_value = return_value && completion_arr[i++];
+    }
    PFUNC_END_TRY_BLOCK()
    PFUNC_CXX_CATCH_AND_RETHROW()
 
@@ -586,6 +650,18 @@ namespace global {
     PFUNC_CXX_CATCH_AND_RETHROW()
   }
 
+  /** 
+   * \return true if the group of the calling task has been cancelled.
+   */
+  static inline bool is_cancelled () {
+    bool cancelled = false;
+    PFUNC_START_TRY_BLOCK()
+    cancelled = pfunc::is_cancelled (*global_tmanager); 
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CXX_CATCH_AND_RETHROW()
+    return cancelled;
+  }
+
   /**
    * \param [in,out] task The task to be waited on.
    */     
@@ -598,8 +674,27 @@ namespace global {
   }
 
   /**
-   * Waits for one of the tasks specified in the set. The algorithm implemented
-   * is one of test_all () followed by exponential backoff.
+   * Waits for the first of the tasks specified in the set to complete.
+   *
+   * \param [in] first First of the tasks to be waited on.
+   * \param [in] last End marker for the tasks to be waited on (true last+1).
+   * \return Index of the task that completed first.
+   */     
+  template <typename ForwardIterator>
+  static inline unsigned int wait_any (ForwardIterator first, 
+                                       ForwardIterator last)  {
+    unsigned int index = 0;
+
+    PFUNC_START_TRY_BLOCK()
+    index = pfunc::wait_any (*global_tmanager, first, last);
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CXX_CATCH_AND_RETHROW()
+
+    return index;
+  }
+
+  /**
+   * Waits for the first of the tasks specified in the set to complete.
    *
    * \param [in] first First of the tasks to be waited on.
    * \param [in] last End marker for the tasks to be waited on (true last+1).
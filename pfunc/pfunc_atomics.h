@@ -33,7 +33,7 @@ typedef _int8 int8_t;
  * \code 
  * if (*dest == comprnd) {
  *   *dest = exchg;
- *   return exchg;
+ *   return comprnd;
  * } else {
  *   return *dest;
  * }  
@@ -52,7 +52,7 @@ static PFUNC_INLINE int8_t pfunc_compare_and_swap_8
  * \code 
  * if (*dest == comprnd) {
  *   *dest = exchg;
- *   return exchg;
+ *   return comprnd;
  * } else {
  *   return *dest;
  * }  
@@ -71,7 +71,7 @@ static PFUNC_INLINE int16_t pfunc_compare_and_swap_16
  * \code 
  * if (*dest == comprnd) {
  *   *dest = exchg;
- *   return exchg;
+ *   return comprnd;
  * } else {
  *   return *dest;
  * }  
@@ -221,6 +221,37 @@ static PFUNC_INLINE void pfunc_write_with_fence_16
 static PFUNC_INLINE void pfunc_write_with_fence_32 
                   (volatile void* location, int32_t value);
 
+/**
+ * \brief Compare and Swap a pointer-sized memory location
+ *
+ * \param dest Pointer to the memory location of the operand
+ * \param exchg The new value to which dest has to be set if successful
+ * \param comprnd The value that is compared to the memory location
+ *
+ * \code 
+ * result = *dest;
+ * if (*dest == comprnd) *dest = exchg;
+ * return result;
+ * \endcode
+ */ 
+static PFUNC_INLINE void* pfunc_compare_and_swap_ptr 
+              (volatile void* dest, void* exchg, void* comprnd); 
+
+/**
+ * \brief Atomically fetches a pointer from memory and stores a new value
+ *
+ * \param location Pointer to memory location
+ * \param new_val The new value to be atomically written in
+ *
+ * \code
+ * result = *location;
+ * *location = new_val;
+ * return result;
+ * \endcode
+ */ 
+static PFUNC_INLINE void* pfunc_fetch_and_store_ptr 
+                      (volatile void* location, void* new_val); 
+
 #if defined (c_plusplus) || defined (__cplusplus)
 }
 #endif
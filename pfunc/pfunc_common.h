@@ -12,7 +12,10 @@
 enum {
   BARRIER_SPIN = 0, /**< Spin until barrier is satisfied */
   BARRIER_WAIT, /**< Sleep until barrier is satisfied */
-  BARRIER_STEAL /**< Keep working on another job until barrier is staisfied */
+  BARRIER_STEAL, /**< Keep working on another job until barrier is staisfied */
+  BARRIER_TREE, /**< Spin on the nodes of a combining tree */
+  BARRIER_DISSEMINATION, /**< Spin on per-task flags in log(n) rounds */
+  BARRIER_STEAL_WAIT /**< Steal for a while, then sleep until satisfied */
 };
 
 /* Declaring some enumarations */
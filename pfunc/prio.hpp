@@ -57,8 +57,8 @@ namespace pfunc { namespace detail {
   /**
    * Specialization of task_queue_set for priority queues.
    */
-  template <typename ValueType>
-  struct task_queue_set <prioS, ValueType> {
+  template <typename ValueType, typename LockType>
+  struct task_queue_set <prioS, ValueType, LockType> {
     typedef typename task_traits<ValueType>::attribute attribute; /**< Type of the task attribute */
     typedef typename task_traits<ValueType>::functor functor; /**< Type of the task functor */
     typedef compare_task_ptr<attribute, functor> compare_type; /**< Type of the priority comparison operator */
@@ -67,7 +67,8 @@ namespace pfunc { namespace detail {
                                 compare_type> queue_type; /**< Type of the priority_queue */
     typedef typename queue_type::value_type value_type; /**< Type of the items stored in the priority_queue */
     typedef unsigned int queue_index_type; /**< type to index into the queue */
-    typedef task_queue_set_data<queue_type> data_type; /**< task_queue_set data */
+    typedef task_queue_set_data<queue_type, LockType> data_type; /**< task_queue_set data */
+    typedef typename data_type::lock_type lock_type; /**< lock type */
 
     ALIGN128 data_type* data; /**< Holds all the data required */
     ALIGN128 unsigned int num_queues; /**< Number of queues */
@@ -121,7 +122,7 @@ namespace pfunc { namespace detail {
 
       PFUNC_START_TRY_BLOCK()
       queue_type& queue = data[queue_num].queue;
-      mutex& lock = data[queue_num].lock;
+      lock_type& lock = data[queue_num].lock;
 
       lock.lock ();
       if (!queue.empty () &&
@@ -181,7 +182,7 @@ namespace pfunc { namespace detail {
     void put (queue_index_type queue_num, const value_type& value) {
       PFUNC_START_TRY_BLOCK()
       queue_type& queue = data[queue_num].queue;
-      mutex& lock = data[queue_num].lock;
+      lock_type& lock = data[queue_num].lock;
 
       lock.lock ();
       queue.push (value);
@@ -0,0 +1,208 @@
+#ifndef PFUNC_QUEUE_LOCK_HPP
+#define PFUNC_QUEUE_LOCK_HPP
+
+/**
+ * \file queue_lock.hpp
+ * \brief Implementation of scalable spin locks for PFUNC
+ * \author Prabhanjan Kambadur
+ *
+ * pfunc::mutex is a test-and-set lock --- every waiter hammers the same word
+ * and, under many thieves, the cache line holding the lock bounces between
+ * all of them. The locks in this file hand the lock over in FIFO order and
+ * are meant to be used as the lock of the task queues (see task_queue_set).
+ * Both the locks model the same interface as pfunc::mutex, i.e., lock(),
+ * trylock() and unlock().
+ *
+ * 1. ticket_lock: Each waiter takes a ticket and spins on the "now serving"
+ *    counter. The time spent between two reads is proportional to the number
+ *    of waiters ahead of it, which keeps the traffic on the counter low.
+ * 2. mcs_lock: Each waiter spins on a flag that is local to it. This is the
+ *    variant of the MCS lock that was proposed for K42, which does not need
+ *    the queue node to be passed to unlock() --- the lock itself doubles up
+ *    as the queue node of the thread that holds it.
+ */
+#include <pfunc/config.h>
+#include <pfunc/pfunc_common.h>
+#include <pfunc/no_copy.hpp>
+#include <pfunc/pfunc_atomics.h>
+#include <pfunc/environ.hpp>
+
+#if PFUNC_HAVE_FUTEX == 1
+#include <pfunc/futex.h>
+#endif
+
+namespace pfunc {
+  namespace detail {
+    /**
+     * \brief Relaxes the processor while spinning on a lock word. 
+     */
+    static inline void spin_relax () {
+#if PFUNC_HAVE_FUTEX == 1
+      cpu_relax ();
+#elif PFUNC_X86 == 1 && PFUNC_WINDOWS != 1
+      __asm__ __volatile__ ("rep; nop" : : : "memory");
+#else
+      /** Do nothing as of now */
+#endif
+    }
+  } /* namespace detail */
+
+  /**
+   * \brief FIFO spin lock with proportional backoff.
+   */
+  struct ticket_lock : public detail::no_copy {
+    private:
+    ALIGN64 volatile int next_ticket; /**< Ticket given to the next waiter */
+    ALIGN64 volatile int now_serving; /**< Ticket that holds the lock */
+    static const unsigned int PFUNC_TICKET_BACKOFF_BASE = 64; /**< Backoff */
+
+    public:
+    /**
+     * Constructor
+     */
+    ticket_lock () : next_ticket (0), now_serving (0) {}
+
+    /**
+     * Locks the ticket lock.
+     */
+    void lock () {
+      const unsigned int my_ticket = 
+        static_cast<unsigned int>(pfunc_fetch_and_add_32 (&next_ticket, 1));
+      unsigned int distance;
+      while (0 != (distance = 
+                   my_ticket - static_cast<unsigned int>(now_serving))) {
+        /** Back off in proportion to the number of waiters ahead of us */
+        for (unsigned int i = 0; i < distance*PFUNC_TICKET_BACKOFF_BASE; ++i)
+          detail::spin_relax ();
+      }
+      pfunc_mem_fence ();
+    }
+
+    /**
+     * Attempt to lock the ticket lock. We only succeed when nobody holds
+     * the lock and nobody is waiting for it.
+     *
+     * \return true if we successfully locked the ticket lock.
+     * \return false if we could not lock the ticket lock.
+     */
+    bool trylock () {
+      const int my_ticket = now_serving;
+      return (my_ticket == pfunc_compare_and_swap_32 (&next_ticket,
+                                                      my_ticket+1,
+                                                      my_ticket));
+    }
+
+    /**
+     * Unlocks the ticket lock. Only the holder writes to now_serving.
+     */
+    void unlock () {
+      pfunc_write_with_fence_32 (&now_serving, now_serving+1);
+    }
+  };
+
+  /**
+   * \brief MCS queue lock (K42 variant)
+   */
+  struct mcs_lock : public detail::no_copy {
+    private:
+    /**
+     * Queue node of a waiting thread. These live on the stack of the waiter
+     * and are only used until the waiter gets the lock.
+     */
+    struct qnode {
+      qnode* volatile next; /**< Successor of this node */
+      volatile int waiting; /**< Non-zero until the lock is handed over */
+    };
+
+    ALIGN64 qnode head; /**< Queue node that stands for the lock holder */
+    ALIGN64 qnode* volatile tail; /**< Last node in the queue */
+
+    /**
+     * \return The node that stands for the holder of the lock.
+     */
+    qnode* holder () { return &head; }
+
+    /**
+     * Wrapper around pfunc_compare_and_swap_ptr for the tail.
+     *
+     * \return true if tail was changed from comprnd to exchg.
+     */
+    bool swap_tail (qnode* exchg, qnode* comprnd) {
+      return (comprnd == pfunc_compare_and_swap_ptr (&tail, exchg, comprnd));
+    }
+
+    public:
+    /**
+     * Constructor
+     */
+    mcs_lock () : tail (NULL) { 
+      head.next = NULL; 
+      head.waiting = 0; 
+    }
+
+    /**
+     * Locks the MCS lock.
+     */
+    void lock () {
+      while (true) {
+        qnode* predecessor = tail;
+        if (NULL == predecessor) {
+          /** Lock is free; the lock itself is our queue node */
+          if (swap_tail (holder (), NULL)) return;
+        } else {
+          qnode me;
+          me.next = NULL;
+          me.waiting = 1;
+          if (swap_tail (&me, predecessor)) {
+            predecessor->next = &me;
+            while (me.waiting) detail::spin_relax ();
+
+            /**
+             * We have the lock. Move our successor (if any) over to the
+             * lock so that "me" can go out of scope.
+             */
+            qnode* successor = me.next;
+            if (NULL == successor) {
+              head.next = NULL;
+              if (!swap_tail (holder (), &me)) {
+                /** Someone is in the middle of queueing up behind us */
+                while (NULL == (successor = me.next)) detail::spin_relax ();
+                head.next = successor;
+              }
+            } else {
+              head.next = successor;
+            }
+            pfunc_mem_fence ();
+            return;
+          }
+        }
+      }
+    }
+
+    /**
+     * Attempt to lock the MCS lock.
+     *
+     * \return true if we successfully locked the MCS lock.
+     * \return false if we could not lock the MCS lock.
+     */
+    bool trylock () {
+      return (NULL == tail && swap_tail (holder (), NULL));
+    }
+
+    /**
+     * Unlocks the MCS lock.
+     */
+    void unlock () {
+      qnode* successor = head.next;
+      if (NULL == successor) {
+        if (swap_tail (NULL, holder ())) return;
+        /** Someone is in the middle of queueing up behind us */
+        while (NULL == (successor = head.next)) detail::spin_relax ();
+      }
+      pfunc_mem_fence ();
+      successor->waiting = 0;
+    }
+  };
+} /* namespace pfunc */
+
+#endif // PFUNC_QUEUE_LOCK_HPP
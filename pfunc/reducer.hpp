@@ -0,0 +1,525 @@
+#ifndef PFUNC_REDUCER_HPP
+#define PFUNC_REDUCER_HPP
+
+/**
+ * \file reducer.hpp
+ * \brief Implementation of reducer hyperobjects
+ * \author Prabhanjan Kambadur
+ *
+ * A reducer lets tasks accumulate into what looks like one shared variable
+ * without locking it. Each task (strand) that updates the reducer gets a
+ * private view that starts out as the identity of a Monoid (see
+ * Monoid.concept.ipp); when a task and its children have completed, its
+ * views are reduced with those of its neighbours in the serial order of the
+ * program. So, the value is the one that the serial elision of the program
+ * computes, even when the reduction is not commutative --- appending to a
+ * list, for example:
+ *
+ *   pfunc::reducer_list_append<int> indices (global_taskmgr);
+ *   ... spawn tasks that call indices.push_back (i) and wait on them ...
+ *   std::list<int>& all = indices.get_value ();
+ *
+ * The following need to be kept in mind:
+ * 1. Create the reducer before spawning the tasks that update it. Tasks
+ *    spawned before the first reducer of a task manager was created (and
+ *    their children) do not have a strand; using a reducer from such a task
+ *    throws (or asserts, without exceptions) as its updates could never be
+ *    folded into the value.
+ * 2. A task's views are folded when it completes, not when it is waited on.
+ *    get_value() gives the full result only after the tasks that update the
+ *    reducer have completed, and only in the strand that created it.
+ * 3. The reducer must outlive the tasks that update it.
+ *
+ * Once the first reducer is created, every spawn on the task manager pays
+ * for the bookkeeping of a strand (see strand.hpp) for as long as the task
+ * manager lives.
+ */
+#include <functional>
+#include <list>
+#include <sstream>
+#include <ostream>
+#include <cassert>
+#include <pfunc/config.h>
+#include <pfunc/exception.hpp>
+#include <pfunc/no_copy.hpp>
+#include <pfunc/trampolines.hpp>
+#include <pfunc/strand.hpp>
+
+namespace pfunc {
+
+/**
+ * \brief A reducer hyperobject.
+ *
+ * \param Monoid The type of the views and of their reduction (see
+ *               Monoid.concept.ipp).
+ */
+template <typename Monoid>
+struct reducer : public detail::reducer_base, public detail::no_copy {
+  typedef Monoid monoid_type; /**< Type of the monoid */
+  typedef typename Monoid::value_type value_type; /**< Type of the views */
+
+  private:
+  detail::taskmgr_virtual_base& taskmgr; /**< Task manager of the tasks */
+  detail::strand_set& strands; /**< Strands of the task manager */
+  const Monoid monoid; /**< Creates and reduces the views */
+  value_type* leftmost; /**< The value before all the views */
+
+  /**
+   * \return The strand that the calling thread is running in. It is an
+   *         error to call this from a task that has no strand, as its
+   *         updates could never be folded into the value.
+   */
+  detail::strand& current_strand () {
+    detail::strand* my_strand = strands.current(taskmgr.current_thread_id());
+#if PFUNC_USE_EXCEPTIONS == 1
+    if (NULL == my_strand)
+      throw exception_generic_impl 
+        ("pfunc::reducer::current_strand at " FILE_AND_LINE(),
+         "Reducer used by a task spawned before the first reducer",
+         static_cast<error_code_type>(PFUNC_ERROR));
+#else
+    assert (NULL != my_strand);
+#endif
+    return *my_strand;
+  }
+
+  public:
+  /**
+   * Constructor. The reducer starts with the identity.
+   *
+   * \param [in,out] taskmgr The task manager of the tasks that update the
+   *                         reducer.
+   * \param [in] monoid The monoid to use.
+   */
+  explicit reducer (detail::taskmgr_virtual_base& taskmgr,
+                    const Monoid& monoid = Monoid ()) :
+    taskmgr (taskmgr), strands (taskmgr.reducer_strands ()),
+    monoid (monoid), leftmost (monoid.create ()) {}
+
+  /**
+   * Constructor
+   *
+   * \param [in,out] taskmgr The task manager of the tasks that update the
+   *                         reducer.
+   * \param [in] initial The value to start with.
+   * \param [in] monoid The monoid to use.
+   */
+  reducer (detail::taskmgr_virtual_base& taskmgr,
+           const value_type& initial,
+           const Monoid& monoid = Monoid ()) :
+    taskmgr (taskmgr), strands (taskmgr.reducer_strands ()),
+    monoid (monoid), leftmost (monoid.create ()) {
+    *leftmost = initial;
+  }
+
+  /**
+   * Destructor. Throws away the views that are left in the calling strand.
+   */
+  virtual ~reducer () {
+    detail::strand* my_strand = strands.current(taskmgr.current_thread_id());
+    if (NULL != my_strand) my_strand->discard (this);
+    delete leftmost;
+  }
+
+  /**
+   * \return The view of the calling strand; this is what the updates go to.
+   */
+  value_type& view () {
+    return *static_cast<value_type*>(current_strand ().view (this));
+  }
+
+  /**
+   * Reduces the views of the calling strand that are not separated from the
+   * start by a running child into the value.
+   *
+   * \return The value of the reducer.
+   */
+  value_type& get_value () {
+    detail::strand& my_strand = current_strand ();
+    my_strand.collapse ();
+    void* first_view = my_strand.extract (this);
+    if (NULL != first_view) {
+      reduce_views (leftmost, first_view);
+      destroy_view (first_view);
+    }
+    return *leftmost;
+  }
+
+  /**
+   * \return The monoid in use.
+   */
+  const Monoid& get_monoid () const { return monoid; }
+
+  /**
+   * \return A new view that holds the identity.
+   */
+  void* create_view () { return monoid.create (); }
+
+  /**
+   * Reduces right into left.
+   *
+   * \param [in,out] left The view that comes first in the serial order.
+   * \param [in,out] right The view that comes next in the serial order.
+   */
+  void reduce_views (void* left, void* right) {
+    monoid.reduce (*static_cast<value_type*>(left),
+                   *static_cast<value_type*>(right));
+  }
+
+  /**
+   * \param [in] view The view to destroy.
+   */
+  void destroy_view (void* view) { delete static_cast<value_type*>(view); }
+};
+
+/**
+ * Adds up the views with operator+=.
+ */
+template <typename T>
+struct monoid_sum {
+  typedef T value_type; /**< Type of the views */
+
+  /**
+   * \return A new view that holds T(), which is 0 for the built-in types.
+   */
+  value_type* create () const { return new value_type (); }
+
+  /**
+   * \param [in,out] left The view that comes first.
+   * \param [in] right The view that comes next.
+   */
+  void reduce (value_type& left, value_type& right) const { left += right; }
+};
+
+/**
+ * View of a minimum or a maximum; it is empty until a value is seen.
+ */
+template <typename T>
+struct min_max_view {
+  bool is_set; /**< Whether a value has been seen */
+  T value; /**< The minimum or the maximum seen so far */
+
+  /**
+   * Constructor; the view is empty.
+   */
+  min_max_view () : is_set (false), value () {}
+
+  /**
+   * \param [in] value The value to start with.
+   */
+  explicit min_max_view (const T& value) : is_set (true), value (value) {}
+};
+
+/**
+ * Keeps the smallest value according to Compare; of equal values, the one
+ * that comes first in the serial order is kept.
+ */
+template <typename T, typename Compare = std::less<T> >
+struct monoid_min {
+  typedef min_max_view<T> value_type; /**< Type of the views */
+
+  private:
+  Compare compare; /**< Ordering of the values */
+
+  public:
+  /**
+   * \param [in] compare Ordering of the values.
+   */
+  explicit monoid_min (const Compare& compare = Compare ()) :
+    compare (compare) {}
+
+  /**
+   * \return A new view that is empty.
+   */
+  value_type* create () const { return new value_type (); }
+
+  /**
+   * Keeps the smaller of the two values in the view.
+   *
+   * \param [in,out] view The view that comes first.
+   * \param [in] value The value that comes next.
+   */
+  void update (value_type& view, const T& value) const {
+    if (!view.is_set || compare (value, view.value)) {
+      view.value = value;
+      view.is_set = true;
+    }
+  }
+
+  /**
+   * \param [in,out] left The view that comes first.
+   * \param [in] right The view that comes next.
+   */
+  void reduce (value_type& left, value_type& right) const {
+    if (right.is_set) update (left, right.value);
+  }
+};
+
+/**
+ * Keeps the largest value according to Compare; of equal values, the one
+ * that comes first in the serial order is kept.
+ */
+template <typename T, typename Compare = std::less<T> >
+struct monoid_max {
+  typedef min_max_view<T> value_type; /**< Type of the views */
+
+  private:
+  Compare compare; /**< Ordering of the values */
+
+  public:
+  /**
+   * \param [in] compare Ordering of the values.
+   */
+  explicit monoid_max (const Compare& compare = Compare ()) :
+    compare (compare) {}
+
+  /**
+   * \return A new view that is empty.
+   */
+  value_type* create () const { return new value_type (); }
+
+  /**
+   * Keeps the larger of the two values in the view.
+   *
+   * \param [in,out] view The view that comes first.
+   * \param [in] value The value that comes next.
+   */
+  void update (value_type& view, const T& value) const {
+    if (!view.is_set || compare (view.value, value)) {
+      view.value = value;
+      view.is_set = true;
+    }
+  }
+
+  /**
+   * \param [in,out] left The view that comes first.
+   * \param [in] right The view that comes next.
+   */
+  void reduce (value_type& left, value_type& right) const {
+    if (right.is_set) update (left, right.value);
+  }
+};
+
+/**
+ * Concatenates lists; splicing does not copy the elements.
+ */
+template <typename T>
+struct monoid_list_append {
+  typedef std::list<T> value_type; /**< Type of the views */
+
+  /**
+   * \return A new view that is an empty list.
+   */
+  value_type* create () const { return new value_type (); }
+
+  /**
+   * \param [in,out] left The view that comes first.
+   * \param [in,out] right The view that comes next; it is emptied.
+   */
+  void reduce (value_type& left, value_type& right) const {
+    left.splice (left.end (), right);
+  }
+};
+
+/**
+ * Concatenates the text written to string streams.
+ */
+struct monoid_ostream {
+  typedef std::ostringstream value_type; /**< Type of the views */
+
+  /**
+   * \return A new view that is an empty string stream.
+   */
+  value_type* create () const { return new value_type (); }
+
+  /**
+   * \param [in,out] left The view that comes first.
+   * \param [in] right The view that comes next.
+   */
+  void reduce (value_type& left, value_type& right) const {
+    left << right.str ();
+  }
+};
+
+/**
+ * \brief A reducer that adds up values.
+ */
+template <typename T>
+struct reducer_sum : public reducer<monoid_sum<T> > {
+  typedef reducer<monoid_sum<T> > base_type; /**< Type of the reducer */
+
+  /**
+   * \param [in,out] taskmgr The task manager of the tasks that update the
+   *                         reducer.
+   * \param [in] initial The value to start with.
+   */
+  explicit reducer_sum (detail::taskmgr_virtual_base& taskmgr,
+                        const T& initial = T ()) :
+    base_type (taskmgr, initial) {}
+
+  /**
+   * \param [in] value The value to add.
+   * \return This reducer.
+   */
+  reducer_sum& operator+= (const T& value) {
+    this->view () += value;
+    return *this;
+  }
+
+  /**
+   * \param [in] value The value to subtract.
+   * \return This reducer.
+   */
+  reducer_sum& operator-= (const T& value) {
+    this->view () -= value;
+    return *this;
+  }
+};
+
+/**
+ * \brief A reducer that keeps the smallest value.
+ */
+template <typename T, typename Compare = std::less<T> >
+struct reducer_min : public reducer<monoid_min<T, Compare> > {
+  typedef reducer<monoid_min<T, Compare> > base_type; /**< Type of reducer */
+
+  /**
+   * \param [in,out] taskmgr The task manager of the tasks that update the
+   *                         reducer.
+   * \param [in] initial The value to start with.
+   * \param [in] compare Ordering of the values.
+   */
+  reducer_min (detail::taskmgr_virtual_base& taskmgr,
+               const T& initial,
+               const Compare& compare = Compare ()) :
+    base_type (taskmgr,
+               min_max_view<T> (initial),
+               monoid_min<T, Compare> (compare)) {}
+
+  /**
+   * \param [in] value The value to compare against.
+   */
+  void calc_min (const T& value) {
+    this->get_monoid ().update (this->view (), value);
+  }
+
+  /**
+   * \return The smallest value.
+   */
+  const T& get_value () { return base_type::get_value ().value; }
+};
+
+/**
+ * \brief A reducer that keeps the largest value.
+ */
+template <typename T, typename Compare = std::less<T> >
+struct reducer_max : public reducer<monoid_max<T, Compare> > {
+  typedef reducer<monoid_max<T, Compare> > base_type; /**< Type of reducer */
+
+  /**
+   * \param [in,out] taskmgr The task manager of the tasks that update the
+   *                         reducer.
+   * \param [in] initial The value to start with.
+   * \param [in] compare Ordering of the values.
+   */
+  reducer_max (detail::taskmgr_virtual_base& taskmgr,
+               const T& initial,
+               const Compare& compare = Compare ()) :
+    base_type (taskmgr,
+               min_max_view<T> (initial),
+               monoid_max<T, Compare> (compare)) {}
+
+  /**
+   * \param [in] value The value to compare against.
+   */
+  void calc_max (const T& value) {
+    this->get_monoid ().update (this->view (), value);
+  }
+
+  /**
+   * \return The largest value.
+   */
+  const T& get_value () { return base_type::get_value ().value; }
+};
+
+/**
+ * \brief A reducer that builds a list in the serial order of the appends.
+ */
+template <typename T>
+struct reducer_list_append : public reducer<monoid_list_append<T> > {
+  typedef reducer<monoid_list_append<T> > base_type; /**< Type of reducer */
+
+  /**
+   * \param [in,out] taskmgr The task manager of the tasks that update the
+   *                         reducer.
+   */
+  explicit reducer_list_append (detail::taskmgr_virtual_base& taskmgr) :
+    base_type (taskmgr) {}
+
+  /**
+   * \param [in] value The value to append.
+   */
+  void push_back (const T& value) { this->view ().push_back (value); }
+};
+
+/**
+ * \brief A reducer that writes to an output stream in the serial order of
+ * the writes.
+ *
+ * The text is held in string streams until flush() or the destructor writes
+ * it out. Each view is a fresh std::ostringstream; so, formatting flags set
+ * by one task do not carry over to the others.
+ */
+struct reducer_ostream : public reducer<monoid_ostream> {
+  typedef reducer<monoid_ostream> base_type; /**< Type of reducer */
+
+  private:
+  std::ostream& stream; /**< The stream to write to */
+
+  public:
+  /**
+   * \param [in,out] taskmgr The task manager of the tasks that write.
+   * \param [in,out] stream The stream to write to.
+   */
+  reducer_ostream (detail::taskmgr_virtual_base& taskmgr,
+                   std::ostream& stream) :
+    base_type (taskmgr), stream (stream) {}
+
+  /**
+   * Destructor. Writes out whatever is left.
+   */
+  ~reducer_ostream () { flush (); }
+
+  /**
+   * \param [in] value The value to write.
+   * \return This reducer.
+   */
+  template <typename T>
+  reducer_ostream& operator<< (const T& value) {
+    view () << value;
+    return *this;
+  }
+
+  /**
+   * \param [in] manipulator A manipulator such as std::endl.
+   * \return This reducer.
+   */
+  reducer_ostream& operator<< (std::ostream& (*manipulator)(std::ostream&)) {
+    manipulator (view ());
+    return *this;
+  }
+
+  /**
+   * Writes the text gathered so far to the stream.
+   */
+  void flush () {
+    std::ostringstream& text = get_value ();
+    stream << text.str ();
+    stream.flush ();
+    text.str ("");
+  }
+};
+
+} /* namespace pfunc */
+
+#endif // PFUNC_REDUCER_HPP
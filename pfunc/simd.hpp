@@ -0,0 +1,281 @@
+#ifndef PFUNC_SIMD_HPP
+#define PFUNC_SIMD_HPP
+
+/**
+ * \file simd.hpp
+ * \brief Vectorized leaf kernels for reductions over contiguous arrays
+ * \author Prabhanjan Kambadur
+ */
+#include <pfunc/config.h>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace pfunc { namespace detail {
+
+/**
+ * The instruction sets that the kernels are built for. Each is a superset
+ * of the ones before it.
+ */
+enum simd_isa {
+  simd_scalar, /**< No vector instructions */
+  simd_sse2, /**< 16-byte vectors */
+  simd_avx2, /**< 32-byte vectors */
+  simd_avx512 /**< 64-byte vectors */
+};
+
+/**
+ * Works out the widest instruction set that the processor (and the
+ * operating system) supports.
+ *
+ * \return The instruction set to use.
+ */
+inline simd_isa detect_simd_isa () {
+#if PFUNC_HAVE_SIMD_DISPATCH == 1
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx512f")) return simd_avx512;
+  if (__builtin_cpu_supports ("avx2")) return simd_avx2;
+  if (__builtin_cpu_supports ("sse2")) return simd_sse2;
+#endif
+  return simd_scalar;
+}
+
+/**
+ * \return The instruction set to use; detected once, on the first call.
+ */
+inline simd_isa get_simd_isa () {
+  static const simd_isa isa = detect_simd_isa ();
+  return isa;
+}
+
+/**
+ * \param [in] isa An instruction set.
+ * \return The name of the instruction set.
+ */
+inline const char* simd_isa_name (const simd_isa isa) {
+  switch (isa) {
+    case simd_sse2: return "SSE2";
+    case simd_avx2: return "AVX2";
+    case simd_avx512: return "AVX-512";
+    default: return "scalar";
+  }
+}
+
+/**
+ * Tells if a type can be held in vectors. Only the arithmetic types of up
+ * to 8 bytes can; the rest go through the kernels one element at a time.
+ */
+template <typename T> struct simd_enabled { static const bool value = false; };
+template <> struct simd_enabled<char> { static const bool value = true; };
+template <> struct simd_enabled<signed char>
+  { static const bool value = true; };
+template <> struct simd_enabled<unsigned char>
+  { static const bool value = true; };
+template <> struct simd_enabled<short> { static const bool value = true; };
+template <> struct simd_enabled<unsigned short>
+  { static const bool value = true; };
+template <> struct simd_enabled<int> { static const bool value = true; };
+template <> struct simd_enabled<unsigned int>
+  { static const bool value = true; };
+template <> struct simd_enabled<long> { static const bool value = true; };
+template <> struct simd_enabled<unsigned long>
+  { static const bool value = true; };
+template <> struct simd_enabled<long long>
+  { static const bool value = true; };
+template <> struct simd_enabled<unsigned long long>
+  { static const bool value = true; };
+template <> struct simd_enabled<float> { static const bool value = true; };
+template <> struct simd_enabled<double> { static const bool value = true; };
+
+/**
+ * A vector of Width elements of type T. Operators work on these element by
+ * element, so the kernels are written once for all the widths; a width of 1
+ * is T itself.
+ */
+template <typename T, size_t Width>
+struct simd_vector {
+#if PFUNC_HAVE_SIMD_DISPATCH == 1
+  typedef T type __attribute__((vector_size(Width*sizeof(T))));
+#else
+  typedef T type;
+#endif
+};
+
+template <typename T>
+struct simd_vector<T, 1> {
+  typedef T type;
+};
+
+/**
+ * Keeps the compiler from fusing the rounding of a value into the next
+ * operation (for example, a multiply and an add into a fused multiply-add),
+ * which only some of the instruction sets can do. Costs nothing.
+ *
+ * \param [in,out] value The value to keep rounded.
+ */
+template <typename V>
+inline void keep_rounded (V& value) {
+#if PFUNC_HAVE_SIMD_DISPATCH == 1
+  __asm__ ("" : "+x" (value));
+#endif
+}
+
+/**
+ * \brief Reduces a contiguous array with vectors of Width elements.
+ *
+ * The kernel keeps NumAccumulators partial results; element i of the
+ * array goes into partial result i%NumAccumulators, and the partial results
+ * are combined pairwise in a fixed order at the end. Several accumulators
+ * hide the latency of the reduction; and because what each element goes
+ * into does not depend on Width, kernels of different widths with the same
+ * NumAccumulators give the same answer, bit for bit, when Reproducible is
+ * set (so that fused multiply-adds are not used).
+ *
+ * Kernel must provide a static const bool binary (whether there is a second
+ * array), static transform (x, y, value) and reduce (acc, value) that work
+ * on T as well as on vectors of T, a static combine (a, b) on T and a
+ * static identity<T>(). The vectors are passed by reference, so a kernel
+ * that is not inlined still works.
+ */
+template <typename Kernel,
+          typename T,
+          size_t Width,
+          size_t NumAccumulators,
+          bool Reproducible>
+struct simd_reduce_kernel {
+  typedef typename simd_vector<T, Width>::type vector_type;
+  static const size_t num_vectors = NumAccumulators/Width;
+
+  /**
+   * \param [in] x The first array.
+   * \param [in] y The second array; ignored unless Kernel is binary.
+   * \param [in] length The number of elements in the arrays.
+   * \return The reduction of the arrays.
+   */
+  static T run (const T* x, const T* y, const size_t length) {
+    const T identity = Kernel::template identity<T> ();
+    vector_type accumulators [num_vectors];
+    T partials [NumAccumulators];
+    for (size_t j=0; j<NumAccumulators; ++j) partials[j] = identity;
+    std::memcpy (accumulators, partials, sizeof (partials));
+
+    size_t i = 0;
+    for (; i+NumAccumulators<=length; i+=NumAccumulators) {
+      for (size_t k=0; k<num_vectors; ++k) {
+        vector_type x_vector, y_vector;
+        std::memcpy (&x_vector, x+i+k*Width, sizeof (vector_type));
+        if (Kernel::binary)
+          std::memcpy (&y_vector, y+i+k*Width, sizeof (vector_type));
+        else y_vector = x_vector;
+        vector_type value;
+        Kernel::transform (x_vector, y_vector, value);
+        if (Reproducible && !std::numeric_limits<T>::is_integer)
+          keep_rounded (value);
+        Kernel::reduce (accumulators[k], value);
+      }
+    }
+    std::memcpy (partials, accumulators, sizeof (partials));
+
+    // The remainder goes into the same partial results as above.
+    for (size_t j=0; i<length; ++i, ++j) {
+      T value;
+      Kernel::transform (x[i], (Kernel::binary) ? y[i] : x[i], value);
+      if (Reproducible && !std::numeric_limits<T>::is_integer)
+        keep_rounded (value);
+      Kernel::reduce (partials[j], value);
+    }
+
+    for (size_t half=NumAccumulators/2; 0<half; half/=2)
+      for (size_t j=0; j<half; ++j)
+        partials[j] = Kernel::combine (partials[j], partials[j+half]);
+
+    return partials[0];
+  }
+};
+
+/**
+ * The number of partial results that the kernels keep when they have to
+ * be reproducible; the same for all the widths that floating point types
+ * have (integers give the same answer whatever the order).
+ */
+const size_t simd_reproducible_accumulators = 32;
+
+/**
+ * Picks the kernel of the right width for an instruction set.
+ */
+template <typename Kernel, typename T, size_t Bytes, bool Reproducible>
+struct simd_dispatch {
+  static const size_t width =
+    (simd_enabled<T>::value && Bytes >= sizeof (T)) ? Bytes/sizeof (T) : 1;
+  static const size_t num_accumulators = (!Reproducible) ? 4*width :
+    (simd_reproducible_accumulators > width) ?
+      simd_reproducible_accumulators : width;
+
+  typedef simd_reduce_kernel<Kernel, T, width, num_accumulators,
+                             Reproducible> kernel_type;
+};
+
+#if PFUNC_HAVE_SIMD_DISPATCH == 1
+
+/**
+ * The kernels built for each instruction set. Everything that they call is
+ * inlined into them, so the vectors never cross a call between functions
+ * that were built for different instruction sets.
+ */
+template <typename Kernel, typename T, bool Reproducible>
+__attribute__((target("sse2"), flatten))
+T simd_reduce_sse2 (const T* x, const T* y, const size_t length) {
+  return simd_dispatch<Kernel, T, 16, Reproducible>::kernel_type::run
+                                                           (x, y, length);
+}
+
+template <typename Kernel, typename T, bool Reproducible>
+__attribute__((target("avx2"), flatten))
+T simd_reduce_avx2 (const T* x, const T* y, const size_t length) {
+  return simd_dispatch<Kernel, T, 32, Reproducible>::kernel_type::run
+                                                           (x, y, length);
+}
+
+template <typename Kernel, typename T, bool Reproducible>
+__attribute__((target("avx512f"), flatten))
+T simd_reduce_avx512 (const T* x, const T* y, const size_t length) {
+  return simd_dispatch<Kernel, T, 64, Reproducible>::kernel_type::run
+                                                           (x, y, length);
+}
+
+#endif
+
+/**
+ * Reduces a contiguous array with the kernel built for an instruction set.
+ *
+ * \param [in] isa The instruction set to use; one the processor supports.
+ * \param [in] x The first array.
+ * \param [in] y The second array; ignored unless Kernel is binary.
+ * \param [in] length The number of elements in the arrays.
+ * \return The reduction of the arrays.
+ */
+template <typename Kernel, typename T, bool Reproducible>
+T simd_reduce (const simd_isa isa,
+               const T* x,
+               const T* y,
+               const size_t length) {
+#if PFUNC_HAVE_SIMD_DISPATCH == 1
+  switch (isa) {
+    case simd_avx512:
+      return simd_reduce_avx512<Kernel, T, Reproducible> (x, y, length);
+    case simd_avx2:
+      return simd_reduce_avx2<Kernel, T, Reproducible> (x, y, length);
+    case simd_sse2:
+      return simd_reduce_sse2<Kernel, T, Reproducible> (x, y, length);
+    default: break;
+  }
+#else
+  (void) isa; /* Only the scalar kernel is built */
+#endif
+  return simd_dispatch<Kernel, T, 1, Reproducible>::kernel_type::run
+                                                           (x, y, length);
+}
+
+} /* namespace detail */ } /* namespace pfunc */
+
+#endif // PFUNC_SIMD_HPP
@@ -2,36 +2,99 @@
 #define PFUNC_SPACE_1D_HPP
 
 #include <cassert>
-#include <utility>
-#include <vector>
+#include <iostream>
+#include <pfunc/inline_array.hpp>
 
 namespace pfunc {
+
+namespace detail {
+
+/**
+ * Holds the default base case size of the 1-D spaces; it is shared by all
+ * the arities of basic_space_1D. It is a template so that it can be defined
+ * in this header.
+ */
+template <typename Dummy>
+struct space_1D_grain {
+  static size_t base_case_size; /**< Default which we will over-ride */
+};
+
+/**
+ * Initialize base_case_size to something sensible.
+ */
+template <typename Dummy>
+size_t space_1D_grain<Dummy>::base_case_size = 100;
+
+} // namespace detail
+
 /**
  * A structure that implements a 1-D iteration space --- [begin, end).
  * It is a model of the interface Space (see Space.concept.ipp)
+ *
+ * A space is split into as many as Arity subspaces at a time: a big space
+ * is split Arity ways, which reaches all the threads in fewer levels of
+ * splitting, and a space that does not have Arity base cases in it is split
+ * into as many base cases as it has (but at least two). The subspaces are
+ * held inline; so, splitting does not allocate.
+ *
+ * A space can also be given a granularity, in which case the split points
+ * are rounded to multiples of it. If the iterations index an array, a
+ * granularity of a cache line's worth of elements (see granularity()) keeps
+ * the leaves from sharing cache lines and lets the leaves start on vector
+ * boundaries, provided that the array itself is aligned.
+ *
+ * All the arities share one base_case_size; so, setting
+ * space_1D::base_case_size sets it for basic_space_1D<8> as well.
  */
-struct space_1D {
+template <size_t Arity>
+struct basic_space_1D : public detail::space_1D_grain<void> {
   public:
-  typedef std::vector<space_1D> subspace_container; /**< Container type */
-  static size_t base_case_size; /**< Default which we will over-ride */
+  typedef detail::inline_array<basic_space_1D, Arity> 
+    subspace_container; /**< Container type */
 
-  const static size_t arity = 2;/**< Number of ways in which a space is split */
+  const static size_t arity = Arity;/**< Maximum number of subspaces */
   const static size_t dimension = 1;/**< Dimensionality of the space */
 
   private:
   size_t space_begin; /**< Beginning of the iteration space */
   size_t space_end; /**< End of the iteration space */
+  size_t space_granularity; /**< Split points are multiples of this */
   bool splittable; /**< Shortcut that tells us if we are splittable */
 
+  /**
+   * @return The first split point that is allowed.
+   */
+  size_t first_split_point () const {
+    return (space_begin/space_granularity + 1)*space_granularity;
+  }
+
   public:
   /**
    * Constructor.
    * @param[in] begin Beginning of the iteration space.
    * @param[in] end End of the iteration space.
+   * @param[in] granularity The split points are rounded to multiples of 
+   *                        granularity.
    */
-  space_1D (const size_t space_begin, const size_t space_end) : 
+  basic_space_1D (const size_t space_begin, 
+                  const size_t space_end, 
+                  const size_t granularity = 1) : 
     space_begin(space_begin), space_end(space_end), 
-    splittable ((space_end-space_begin)>base_case_size) {}
+    space_granularity ((0 == granularity) ? 1 : granularity),
+    splittable ((space_end-space_begin)>base_case_size && 
+                first_split_point ()<space_end) {}
+
+  /**
+   * Works out the granularity that aligns the split points to 'bytes' 
+   * bytes (for example, a cache line or a vector register) for an array 
+   * of T.
+   * @param[in] bytes The alignment required in bytes.
+   * @return The granularity in number of elements.
+   */
+  template <typename T>
+  static size_t granularity (const size_t bytes = 64) {
+    return (bytes > sizeof(T)) ? (bytes/sizeof(T)) : 1;
+  }
 
   /**
    * Get the beginning of the iteration space.
@@ -52,26 +115,48 @@ struct space_1D {
   bool can_split () const { return splittable; }
 
   /**
-   * Split the current space into two pieces and return an iterator pair that 
-   * gives the right and the left subspaces.
-   * @return A pair of iterators [begin, end) that will point to the split 
-   *         subspaces.
+   * Split the current space into as many as Arity pieces of (nearly) the
+   * same size and return them from left to right.
+   * @return The split subspaces.
    */
   subspace_container split () const { 
     // Make sure that the space is splittable
     assert (splittable);
 
-    // Get a vector to store the subspaces
-    subspace_container subspaces;
+    // Split Arity ways if the pieces are big enough; else, into base cases.
+    const size_t space_size = space_end-space_begin;
+    size_t num_pieces = (0 == base_case_size) ? 
+                          arity : (space_size/base_case_size);
+    if (num_pieces > arity) num_pieces = arity;
+    if (num_pieces < 2) num_pieces = 2;
 
-    const size_t split_point = space_begin + (space_end-space_begin)/2;
-    const size_t left_space_begin = space_begin;
-    const size_t left_space_end = split_point;
-    const size_t right_space_begin = split_point;
-    const size_t right_space_end = space_end;
+    // Get a container to store the subspaces
+    subspace_container subspaces;
 
-    subspaces.push_back (space_1D (left_space_begin, left_space_end));
-    subspaces.push_back (space_1D (right_space_begin, right_space_end));
+    // Round the split points to the nearest multiple of the granularity;
+    // points that end up outside the space or on top of another are dropped.
+    size_t piece_begin = space_begin;
+    for (size_t i=1; i<num_pieces; ++i) {
+      size_t piece_end = space_begin + (i*space_size)/num_pieces;
+      piece_end = ((piece_end + space_granularity/2)/space_granularity)*
+                    space_granularity;
+      if (piece_end <= piece_begin || piece_end >= space_end) continue;
+      subspaces.push_back (basic_space_1D (piece_begin, 
+                                           piece_end, 
+                                           space_granularity));
+      piece_begin = piece_end;
+    }
+
+    // Make sure that we split at least once.
+    if (subspaces.empty ()) {
+      piece_begin = first_split_point ();
+      subspaces.push_back (basic_space_1D (space_begin, 
+                                           piece_begin, 
+                                           space_granularity));
+    }
+    subspaces.push_back (basic_space_1D (piece_begin, 
+                                         space_end, 
+                                         space_granularity));
 
     return subspaces;
   }
@@ -86,9 +171,9 @@ struct space_1D {
 };
 
 /**
- * Initialize base_case_size to something sensible.
+ * The space that is split in half.
  */
-size_t pfunc::space_1D::base_case_size = 100;
+typedef basic_space_1D<2> space_1D;
 
 } // end namespace pfunc
 
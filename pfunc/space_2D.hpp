@@ -0,0 +1,204 @@
+#ifndef PFUNC_SPACE_2D_HPP
+#define PFUNC_SPACE_2D_HPP
+
+#include <cassert>
+#include <iostream>
+#include <pfunc/inline_array.hpp>
+
+namespace pfunc {
+
+namespace detail {
+
+/**
+ * Holds the default grains of space_2D. It is a template so that the grains
+ * can be defined in this header.
+ */
+template <typename Dummy>
+struct space_2D_grains {
+  static size_t base_case_size [2]; /**< Default grain of each dimension */
+};
+
+/**
+ * Initialize base_case_size to something sensible.
+ */
+template <typename Dummy>
+size_t space_2D_grains<Dummy>::base_case_size [2] = {16, 16};
+
+} // namespace detail
+
+/**
+ * A structure that implements a 2-D iteration space --- [row_begin, row_end)
+ * x [col_begin, col_end). It is a model of the interface Space (see
+ * Space.concept.ipp). Each dimension has its own base case size (grain);
+ * the space is splittable as long as any of its dimensions is longer than
+ * its grain.
+ *
+ * By default, the space is halved along its longest splittable dimension,
+ * which makes the leaves close to square tiles at every level of the
+ * recursion (cache-oblivious tiling). If morton is set, the space is halved
+ * along the rows and the columns by turns instead; the leaves are then
+ * visited in Z-order (Morton order) by a thread that runs them one after the
+ * other.
+ */
+struct space_2D : public detail::space_2D_grains<void> {
+  public:
+  typedef detail::inline_array<space_2D, 2> 
+    subspace_container; /**< Container type */
+
+  const static size_t arity = 2;/**< Number of ways in which a space is split */
+  const static size_t dimension = 2;/**< Dimensionality of the space */
+
+  private:
+  size_t space_begin [2]; /**< Beginning of the space in each dimension */
+  size_t space_end [2]; /**< End of the space in each dimension */
+  size_t grain [2]; /**< Base case size of each dimension */
+  bool morton; /**< Whether to split the dimensions by turns */
+  size_t next_split; /**< Dimension to split next when morton is set */
+  bool splittable; /**< Shortcut that tells us if we are splittable */
+
+  /**
+   * Works out which dimension to split next.
+   * @return The dimension to split; dimension if the space is not
+   *         splittable.
+   */
+  size_t split_dimension () const {
+    size_t split_dim = dimension;
+    if (morton) {
+      for (size_t i=0; i<dimension && dimension==split_dim; ++i) {
+        const size_t dim = (next_split+i)%dimension;
+        if ((space_end[dim]-space_begin[dim]) > grain[dim]) split_dim = dim;
+      }
+    } else {
+      size_t longest = 0;
+      for (size_t dim=0; dim<dimension; ++dim) {
+        const size_t length = space_end[dim]-space_begin[dim];
+        if (length > grain[dim] && length > longest) {
+          longest = length;
+          split_dim = dim;
+        }
+      }
+    }
+    return split_dim;
+  }
+
+  public:
+  /**
+   * Constructor. The grains are taken from base_case_size.
+   * @param[in] row_begin Beginning of the rows.
+   * @param[in] row_end End of the rows.
+   * @param[in] col_begin Beginning of the columns.
+   * @param[in] col_end End of the columns.
+   * @param[in] morton Whether to visit the leaves in Z-order.
+   */
+  space_2D (const size_t row_begin, const size_t row_end,
+            const size_t col_begin, const size_t col_end,
+            const bool morton = false) :
+    morton (morton), next_split (0) {
+    space_begin[0] = row_begin; space_end[0] = row_end;
+    space_begin[1] = col_begin; space_end[1] = col_end;
+    grain[0] = base_case_size[0]; grain[1] = base_case_size[1];
+    splittable = (dimension != split_dimension ());
+  }
+
+  /**
+   * Constructor.
+   * @param[in] row_begin Beginning of the rows.
+   * @param[in] row_end End of the rows.
+   * @param[in] col_begin Beginning of the columns.
+   * @param[in] col_end End of the columns.
+   * @param[in] row_grain Number of rows below which we do not split.
+   * @param[in] col_grain Number of columns below which we do not split.
+   * @param[in] morton Whether to visit the leaves in Z-order.
+   */
+  space_2D (const size_t row_begin, const size_t row_end,
+            const size_t col_begin, const size_t col_end,
+            const size_t row_grain, const size_t col_grain,
+            const bool morton = false) :
+    morton (morton), next_split (0) {
+    space_begin[0] = row_begin; space_end[0] = row_end;
+    space_begin[1] = col_begin; space_end[1] = col_end;
+    grain[0] = row_grain; grain[1] = col_grain;
+    splittable = (dimension != split_dimension ());
+  }
+
+  /**
+   * Get the beginning of the iteration space in a dimension.
+   * @param[in] dim The dimension (0 for rows, 1 for columns).
+   * @return Beginning of the iteration space in dim.
+   */
+  size_t begin (const size_t dim) const { return space_begin[dim]; }
+
+  /**
+   * Get the end of the iteration space in a dimension.
+   * @param[in] dim The dimension (0 for rows, 1 for columns).
+   * @return End of the iteration space in dim.
+   */
+  size_t end (const size_t dim) const { return space_end[dim]; }
+
+  /**
+   * @return Beginning of the rows.
+   */
+  size_t row_begin () const { return space_begin[0]; }
+
+  /**
+   * @return End of the rows.
+   */
+  size_t row_end () const { return space_end[0]; }
+
+  /**
+   * @return Beginning of the columns.
+   */
+  size_t col_begin () const { return space_begin[1]; }
+
+  /**
+   * @return End of the columns.
+   */
+  size_t col_end () const { return space_end[1]; }
+
+  /**
+   * Check if the space is splittable
+   * @return true iff splittable, false otherwise.
+   */
+  bool can_split () const { return splittable; }
+
+  /**
+   * Split the current space into two halves along one of the dimensions.
+   * @return The two subspaces; the first one comes first in the traversal.
+   */
+  subspace_container split () const {
+    // Make sure that the space is splittable
+    assert (splittable);
+
+    const size_t split_dim = split_dimension ();
+    const size_t split_point =
+      space_begin[split_dim] + (space_end[split_dim]-space_begin[split_dim])/2;
+
+    space_2D first_half (*this);
+    space_2D second_half (*this);
+    first_half.space_end[split_dim] = split_point;
+    second_half.space_begin[split_dim] = split_point;
+    first_half.next_split = second_half.next_split = (split_dim+1)%dimension;
+    first_half.splittable = (dimension != first_half.split_dimension ());
+    second_half.splittable = (dimension != second_half.split_dimension ());
+
+    // Get a container to store the subspaces
+    subspace_container subspaces;
+    subspaces.push_back (first_half);
+    subspaces.push_back (second_half);
+
+    return subspaces;
+  }
+
+  /**
+   * Pretty print
+   */
+  void pretty_print () const {
+    std::cout << "[" << row_begin() << "," << row_end() << ") x ["
+              << col_begin() << "," << col_end() << ") -- "
+              << ((splittable) ? "splittable" : "NOT splittable") << std::endl;
+  }
+};
+
+} // end namespace pfunc
+
+#endif // PFUNC_SPACE_2D_HPP
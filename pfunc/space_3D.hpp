@@ -0,0 +1,192 @@
+#ifndef PFUNC_SPACE_3D_HPP
+#define PFUNC_SPACE_3D_HPP
+
+#include <cassert>
+#include <iostream>
+#include <pfunc/inline_array.hpp>
+
+namespace pfunc {
+
+namespace detail {
+
+/**
+ * Holds the default grains of space_3D. It is a template so that the grains
+ * can be defined in this header.
+ */
+template <typename Dummy>
+struct space_3D_grains {
+  static size_t base_case_size [3]; /**< Default grain of each dimension */
+};
+
+/**
+ * Initialize base_case_size to something sensible.
+ */
+template <typename Dummy>
+size_t space_3D_grains<Dummy>::base_case_size [3] = {8, 8, 8};
+
+} // namespace detail
+
+/**
+ * A structure that implements a 3-D iteration space --- [begin(0), end(0))
+ * x [begin(1), end(1)) x [begin(2), end(2)). It is a model of the interface Space (see
+ * Space.concept.ipp). Each dimension has its own base case size (grain);
+ * the space is splittable as long as any of its dimensions is longer than
+ * its grain.
+ *
+ * By default, the space is halved along its longest splittable dimension,
+ * which makes the leaves close to square tiles at every level of the
+ * recursion (cache-oblivious tiling). If morton is set, the space is halved
+ * along each of the three dimensions by turns instead; the leaves are then
+ * visited in Z-order (Morton order) by a thread that runs them one after the
+ * other.
+ */
+struct space_3D : public detail::space_3D_grains<void> {
+  public:
+  typedef detail::inline_array<space_3D, 2> 
+    subspace_container; /**< Container type */
+
+  const static size_t arity = 2;/**< Number of ways in which a space is split */
+  const static size_t dimension = 3;/**< Dimensionality of the space */
+
+  private:
+  size_t space_begin [3]; /**< Beginning of the space in each dimension */
+  size_t space_end [3]; /**< End of the space in each dimension */
+  size_t grain [3]; /**< Base case size of each dimension */
+  bool morton; /**< Whether to split the dimensions by turns */
+  size_t next_split; /**< Dimension to split next when morton is set */
+  bool splittable; /**< Shortcut that tells us if we are splittable */
+
+  /**
+   * Works out which dimension to split next.
+   * @return The dimension to split; dimension if the space is not
+   *         splittable.
+   */
+  size_t split_dimension () const {
+    size_t split_dim = dimension;
+    if (morton) {
+      for (size_t i=0; i<dimension && dimension==split_dim; ++i) {
+        const size_t dim = (next_split+i)%dimension;
+        if ((space_end[dim]-space_begin[dim]) > grain[dim]) split_dim = dim;
+      }
+    } else {
+      size_t longest = 0;
+      for (size_t dim=0; dim<dimension; ++dim) {
+        const size_t length = space_end[dim]-space_begin[dim];
+        if (length > grain[dim] && length > longest) {
+          longest = length;
+          split_dim = dim;
+        }
+      }
+    }
+    return split_dim;
+  }
+
+  public:
+  /**
+   * Constructor. The grains are taken from base_case_size.
+   * @param[in] begin_0 Beginning of the space in dimension 0.
+   * @param[in] end_0 End of the space in dimension 0.
+   * @param[in] begin_1 Beginning of the space in dimension 1.
+   * @param[in] end_1 End of the space in dimension 1.
+   * @param[in] begin_2 Beginning of the space in dimension 2.
+   * @param[in] end_2 End of the space in dimension 2.
+   * @param[in] morton Whether to visit the leaves in Z-order.
+   */
+  space_3D (const size_t begin_0, const size_t end_0,
+            const size_t begin_1, const size_t end_1,
+            const size_t begin_2, const size_t end_2,
+            const bool morton = false) :
+    morton (morton), next_split (0) {
+    space_begin[0] = begin_0; space_end[0] = end_0;
+    space_begin[1] = begin_1; space_end[1] = end_1;
+    space_begin[2] = begin_2; space_end[2] = end_2;
+    for (size_t dim=0; dim<dimension; ++dim) grain[dim] = base_case_size[dim];
+    splittable = (dimension != split_dimension ());
+  }
+
+  /**
+   * Constructor.
+   * @param[in] begin_0 Beginning of the space in dimension 0.
+   * @param[in] end_0 End of the space in dimension 0.
+   * @param[in] begin_1 Beginning of the space in dimension 1.
+   * @param[in] end_1 End of the space in dimension 1.
+   * @param[in] begin_2 Beginning of the space in dimension 2.
+   * @param[in] end_2 End of the space in dimension 2.
+   * @param[in] grains Length of each dimension below which we do not split.
+   * @param[in] morton Whether to visit the leaves in Z-order.
+   */
+  space_3D (const size_t begin_0, const size_t end_0,
+            const size_t begin_1, const size_t end_1,
+            const size_t begin_2, const size_t end_2,
+            const size_t grains [3],
+            const bool morton = false) :
+    morton (morton), next_split (0) {
+    space_begin[0] = begin_0; space_end[0] = end_0;
+    space_begin[1] = begin_1; space_end[1] = end_1;
+    space_begin[2] = begin_2; space_end[2] = end_2;
+    for (size_t dim=0; dim<dimension; ++dim) grain[dim] = grains[dim];
+    splittable = (dimension != split_dimension ());
+  }
+
+  /**
+   * Get the beginning of the iteration space in a dimension.
+   * @param[in] dim The dimension (0, 1 or 2).
+   * @return Beginning of the iteration space in dim.
+   */
+  size_t begin (const size_t dim) const { return space_begin[dim]; }
+
+  /**
+   * Get the end of the iteration space in a dimension.
+   * @param[in] dim The dimension (0, 1 or 2).
+   * @return End of the iteration space in dim.
+   */
+  size_t end (const size_t dim) const { return space_end[dim]; }
+
+  /**
+   * Check if the space is splittable
+   * @return true iff splittable, false otherwise.
+   */
+  bool can_split () const { return splittable; }
+
+  /**
+   * Split the current space into two halves along one of the dimensions.
+   * @return The two subspaces; the first one comes first in the traversal.
+   */
+  subspace_container split () const {
+    // Make sure that the space is splittable
+    assert (splittable);
+
+    const size_t split_dim = split_dimension ();
+    const size_t split_point =
+      space_begin[split_dim] + (space_end[split_dim]-space_begin[split_dim])/2;
+
+    space_3D first_half (*this);
+    space_3D second_half (*this);
+    first_half.space_end[split_dim] = split_point;
+    second_half.space_begin[split_dim] = split_point;
+    first_half.next_split = second_half.next_split = (split_dim+1)%dimension;
+    first_half.splittable = (dimension != first_half.split_dimension ());
+    second_half.splittable = (dimension != second_half.split_dimension ());
+
+    // Get a container to store the subspaces
+    subspace_container subspaces;
+    subspaces.push_back (first_half);
+    subspaces.push_back (second_half);
+
+    return subspaces;
+  }
+
+  /**
+   * Pretty print
+   */
+  void pretty_print () const {
+    std::cout << "[" << begin(0) << "," << end(0) << ") x ["
+              << begin(1) << "," << end(1) << ") x ["
+              << begin(2) << "," << end(2) << ") -- "
+              << ((splittable) ? "splittable" : "NOT splittable") << std::endl;
+  }
+};
+
+} // end namespace pfunc
+
+#endif // PFUNC_SPACE_3D_HPP
@@ -0,0 +1,421 @@
+#ifndef PFUNC_STRAND_HPP
+#define PFUNC_STRAND_HPP
+
+/**
+ * \file strand.hpp
+ * \brief Bookkeeping of the views of reducers (see reducer.hpp)
+ * \author Prabhanjan Kambadur
+ *
+ * Every task spawned while a reducer is alive gets a strand. A strand holds
+ * the views that its task updated, in the serial order of the program:
+ * the strand is a list of entries, where each entry is either a segment
+ * (the views updated by the task between two spawns) or the strand of a
+ * child task. Spawning a child appends the child's entry and closes the
+ * current segment; so, the entries of a strand are in the order in which
+ * the serial elision of the program would have made the updates.
+ *
+ * When a task completes and all of its children have been folded into it,
+ * its segments are reduced into one and that segment replaces the task's
+ * entry in the parent's strand, where it is reduced with the neighbouring
+ * segments. The last child to complete folds the strands of the ancestors
+ * that were waiting only on it. Since views are reduced only with their
+ * neighbours, the result is that of the serial elision even when the
+ * reduction is not commutative.
+ */
+#include <list>
+#include <vector>
+#include <pfunc/no_copy.hpp>
+#include <pfunc/mutex.hpp>
+#include <pfunc/environ.hpp>
+
+namespace pfunc { namespace detail {
+
+/**
+ * \brief Type-erased interface of a reducer, used by the strands to manage
+ * the views of the reducer without knowing its type.
+ */
+struct reducer_base {
+  /**
+   * Virtual destructor
+   */
+  virtual ~reducer_base () {}
+
+  /**
+   * \return A new view that holds the identity.
+   */
+  virtual void* create_view () = 0;
+
+  /**
+   * Reduces right into left; left comes before right in the serial order.
+   *
+   * \param [in,out] left The view that receives the result.
+   * \param [in,out] right The view that is reduced into left.
+   */
+  virtual void reduce_views (void* left, void* right) = 0;
+
+  /**
+   * Destroys a view that was created by create_view.
+   *
+   * \param [in] view The view to destroy.
+   */
+  virtual void destroy_view (void* view) = 0;
+};
+
+/**
+ * A view along with the reducer that it belongs to.
+ */
+struct reducer_view {
+  reducer_base* reducer; /**< The reducer that the view belongs to */
+  void* view; /**< The view */
+
+  /**
+   * \param [in] reducer The reducer that the view belongs to.
+   * \param [in] view The view.
+   */
+  reducer_view (reducer_base* reducer, void* view) : reducer (reducer),
+                                                     view (view) {}
+};
+
+typedef std::vector<reducer_view> view_segment; /**< Views of one segment */
+
+/**
+ * Reduces the views of right into those of left and empties right. Views of
+ * reducers that are not in left are moved over.
+ *
+ * \param [in,out] left The segment that comes first in the serial order.
+ * \param [in,out] right The segment that comes next in the serial order.
+ */
+inline void merge_segments (view_segment& left, view_segment& right) {
+  for (size_t i=0; i<right.size (); ++i) {
+    size_t j = 0;
+    while (j<left.size () && left[j].reducer != right[i].reducer) ++j;
+    if (j == left.size ()) {
+      left.push_back (right[i]);
+    } else {
+      right[i].reducer->reduce_views (left[j].view, right[i].view);
+      right[i].reducer->destroy_view (right[i].view);
+    }
+  }
+  right.clear ();
+}
+
+/**
+ * \brief The views of one task, in serial order.
+ *
+ * Only the thread that runs the task (the owner) appends to the strand and
+ * updates the open segment, which is always the last entry. The entries
+ * before it are changed by the threads that fold the children of the task;
+ * the list itself is guarded by lock.
+ */
+struct strand : public no_copy {
+  /**
+   * A segment of views, or the strand of a child.
+   */
+  struct entry {
+    strand* child; /**< The child's strand; NULL if this is a segment */
+    view_segment views; /**< The views of the segment */
+
+    /**
+     * \param [in] child The child's strand; NULL for a segment.
+     */
+    explicit entry (strand* child = NULL) : child (child) {}
+  };
+  typedef std::list<entry> entry_list; /**< Type of the list of entries */
+
+  private:
+  mutex lock; /**< Guards entries and the counters */
+  entry_list entries; /**< Segments and children in serial order */
+  view_segment* open_views; /**< Segment the owner updates; NULL if closed */
+  strand* parent; /**< The strand the task was spawned from */
+  entry_list::iterator position; /**< Our entry in the parent's strand */
+  unsigned int num_children; /**< Children that are yet to be folded */
+  bool finished; /**< Whether the task has completed */
+
+  /**
+   * Replaces the entry of a completed child with its views, and reduces
+   * them with the closed segments around it. Must hold lock.
+   *
+   * \param [in,out] child_position The entry of the child.
+   * \param [in,out] child_views The views of the child.
+   */
+  void fold_child (entry_list::iterator child_position,
+                   view_segment& child_views) {
+    child_position->child = NULL;
+    child_position->views.swap (child_views);
+    --num_children;
+
+    /* The open segment comes after every child; so, left is never open */
+    if (entries.begin () != child_position) {
+      entry_list::iterator left = child_position;
+      --left;
+      if (NULL == left->child) {
+        merge_segments (left->views, child_position->views);
+        entries.erase (child_position);
+        child_position = left;
+      }
+    }
+
+    entry_list::iterator right = child_position;
+    ++right;
+    if (entries.end () != right && NULL == right->child &&
+        &(right->views) != open_views) {
+      merge_segments (child_position->views, right->views);
+      entries.erase (right);
+    }
+  }
+
+  public:
+  /**
+   * Constructor
+   *
+   * \param [in] parent The strand of the spawning task; NULL for the strand
+   *                    that a thread starts with.
+   */
+  explicit strand (strand* parent = NULL) : open_views (NULL),
+                                            parent (parent),
+                                            num_children (0),
+                                            finished (false) {}
+
+  /**
+   * Called by the owner to get its view of a reducer, which is created in
+   * the open segment if needed.
+   *
+   * \param [in] reducer The reducer whose view is needed.
+   * \return The view.
+   */
+  void* view (reducer_base* reducer) {
+    if (NULL == open_views) {
+      lock.lock ();
+      entries.push_back (entry ());
+      open_views = &(entries.back ().views);
+      lock.unlock ();
+    }
+
+    for (size_t i=0; i<open_views->size (); ++i)
+      if (reducer == (*open_views)[i].reducer) return (*open_views)[i].view;
+
+    void* new_view = reducer->create_view ();
+    open_views->push_back (reducer_view (reducer, new_view));
+    return new_view;
+  }
+
+  /**
+   * Called by the owner when it spawns a task.
+   *
+   * \return The strand of the new task.
+   */
+  strand* spawn () {
+    strand* child = new strand (this);
+    lock.lock ();
+    entries.push_back (entry (child));
+    child->position = --entries.end ();
+    ++num_children;
+    open_views = NULL;
+    lock.unlock ();
+    return child;
+  }
+
+  /**
+   * Called by the owner to reduce the segments that are no longer
+   * separated by a child.
+   */
+  void collapse () {
+    lock.lock ();
+    entry_list::iterator current = entries.begin ();
+    while (entries.end () != current) {
+      entry_list::iterator next = current;
+      ++next;
+      if (entries.end () != next &&
+          NULL == current->child && NULL == next->child) {
+        merge_segments (current->views, next->views);
+        entries.erase (next);
+      } else {
+        current = next;
+      }
+    }
+    open_views = (!entries.empty () && NULL == entries.back ().child) ?
+                                        &(entries.back ().views) : NULL;
+    lock.unlock ();
+  }
+
+  /**
+   * Called by the owner to take out the view of a reducer from the first
+   * segment, provided that nothing comes before that segment.
+   *
+   * \param [in] reducer The reducer whose view is needed.
+   * \return The view; NULL if there is no such view.
+   */
+  void* extract (reducer_base* reducer) {
+    void* extracted = NULL;
+    lock.lock ();
+    if (!entries.empty () && NULL == entries.front ().child) {
+      view_segment& views = entries.front ().views;
+      for (size_t i=0; i<views.size (); ++i) {
+        if (reducer == views[i].reducer) {
+          extracted = views[i].view;
+          views.erase (views.begin () + i);
+          break;
+        }
+      }
+    }
+    lock.unlock ();
+    return extracted;
+  }
+
+  /**
+   * Called by the owner to destroy all the views of a reducer.
+   *
+   * \param [in] reducer The reducer whose views are to be destroyed.
+   */
+  void discard (reducer_base* reducer) {
+    lock.lock ();
+    for (entry_list::iterator current = entries.begin ();
+         entries.end () != current; ++current) {
+      view_segment& views = current->views;
+      for (size_t i=0; i<views.size (); ++i) {
+        if (reducer == views[i].reducer) {
+          reducer->destroy_view (views[i].view);
+          views.erase (views.begin () + i);
+          break;
+        }
+      }
+    }
+    lock.unlock ();
+  }
+
+  /**
+   * Called by the owner when its task completes. If all the children have
+   * been folded, the strand is folded into its parent (and so on up).
+   */
+  void finish () {
+    lock.lock ();
+    finished = true;
+    const bool ready = (0 == num_children);
+    lock.unlock ();
+    if (ready) fold (this);
+  }
+
+  /**
+   * Folds a strand whose task and children have completed into its parent,
+   * and then deletes it. The folding continues with the parent if that was
+   * the last child that the parent's completed task was waiting on.
+   *
+   * \param [in] completed The strand to fold.
+   */
+  static void fold (strand* completed) {
+    while (NULL != completed) {
+      /* No one else refers to completed anymore; reduce it to one segment */
+      view_segment views;
+      for (entry_list::iterator current = completed->entries.begin ();
+           completed->entries.end () != current; ++current)
+        merge_segments (views, current->views);
+
+      strand* parent = completed->parent;
+      parent->lock.lock ();
+      parent->fold_child (completed->position, views);
+      const bool ready = parent->finished && (0 == parent->num_children);
+      parent->lock.unlock ();
+
+      delete completed;
+      completed = ready ? parent : NULL;
+    }
+  }
+};
+
+/**
+ * \brief The strands that the threads of a task manager are running in.
+ *
+ * Every thread (including the main thread) starts with a strand of its own
+ * that never completes; the views updated outside of any task end up there.
+ * A thread that runs a task without a strand (one spawned before the first
+ * reducer was created) is in no strand at all till the task completes; the
+ * task and its children cannot use reducers.
+ *
+ * The set lives as long as its task manager, even when no reducer is left:
+ * spawns read the set without a lock and running tasks may still hold
+ * strands in it, so freeing it would cost every spawn a synchronization.
+ */
+struct strand_set : public no_copy {
+  private:
+  /**
+   * Current strand of a thread, on its own cache line.
+   */
+  struct aligned_strand {
+    ALIGN128 strand* current; /**< The strand being run */
+  };
+
+  strand* thread_strands; /**< The strand that each thread starts with */
+  aligned_strand* current_strands; /**< The strand each thread is in */
+
+  public:
+  /**
+   * Constructor
+   *
+   * \param [in] num_threads The number of threads, including the main one.
+   */
+  explicit strand_set (const unsigned int& num_threads) :
+                      thread_strands (new strand [num_threads]),
+                      current_strands (new aligned_strand [num_threads]) {
+    for (unsigned int i=0; i<num_threads; ++i)
+      current_strands[i].current = thread_strands + i;
+  }
+
+  /**
+   * Destructor
+   */
+  ~strand_set () {
+    delete [] current_strands;
+    delete [] thread_strands;
+  }
+
+  /**
+   * \param [in] thread_id The thread whose strand is needed.
+   * \return The strand that the thread is running in; NULL if the thread is
+   *         running a task that has no strand.
+   */
+  strand* current (const unsigned int& thread_id) {
+    return current_strands[thread_id].current;
+  }
+
+  /**
+   * Called when a thread spawns a task.
+   *
+   * \param [in] thread_id The thread spawning the task.
+   * \return The strand of the new task; NULL if the thread is in no strand.
+   */
+  strand* spawn (const unsigned int& thread_id) {
+    strand* my_strand = current_strands[thread_id].current;
+    return (NULL == my_strand) ? NULL : my_strand->spawn ();
+  }
+
+  /**
+   * Enters the strand of a task that is about to run.
+   *
+   * \param [in] thread_id The thread running the task.
+   * \param [in] task_strand The strand of the task; NULL if it has none.
+   * \return The strand that the thread was in, for end_run.
+   */
+  strand* begin_run (const unsigned int& thread_id, strand* task_strand) {
+    strand* previous = current_strands[thread_id].current;
+    current_strands[thread_id].current = task_strand;
+    return previous;
+  }
+
+  /**
+   * Leaves the strand of a task that has completed.
+   *
+   * \param [in] thread_id The thread that ran the task.
+   * \param [in] task_strand The strand of the task; NULL if it has none.
+   * \param [in] previous The strand returned by begin_run.
+   */
+  void end_run (const unsigned int& thread_id,
+                strand* task_strand,
+                strand* previous) {
+    current_strands[thread_id].current = previous;
+    if (NULL != task_strand) task_strand->finish ();
+  }
+};
+
+} /* namespace detail */ } /* namespace pfunc */
+
+#endif // PFUNC_STRAND_HPP
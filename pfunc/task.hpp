@@ -8,6 +8,7 @@
  *
  */
 #include <cstdlib>
+#include <iterator>
 
 #include <pfunc/no_copy.hpp>
 #include <pfunc/exception.hpp>
@@ -15,6 +16,7 @@
 #include <pfunc/trampolines.hpp>
 #include <pfunc/attribute.hpp>
 #include <pfunc/group.hpp>
+#include <pfunc/strand.hpp>
 
 namespace pfunc { namespace detail {
 
@@ -43,8 +45,21 @@ struct task : public no_copy {
   functor* func; /**< Function object that represents the task */
   event<testable_event> testing_compl; /**< testable event */
   event<waitable_event> waiting_compl; /**< waitable event */
+  completion_notifier* volatile notifier; /**< Signalled on completion */
+  unsigned int notifier_index; /**< Index of this task for the notifier */
+  join_counter* joiner; /**< Signalled last on completion; may be NULL */
+  completion_hook* hook; /**< Called after joiner on completion; may be NULL*/
+  strand* task_strand; /**< Views of the reducers; NULL without reducers */
   PFUNC_DEFINE_EXCEPT_PTR()
 
+  /**
+   * \return Value of notifier that says that the task has completed. Any 
+   * address that is never that of a notifier will do.
+   */
+  completion_notifier* notifier_done () { 
+    return reinterpret_cast<completion_notifier*>(this);
+  }
+
   public:
   /**
    * \return Attribute that governs the execution of the function.
@@ -88,21 +103,39 @@ struct task : public no_copy {
    */
   void set_func (functor* fn)  { func = fn; }
 
+  /**
+   * \return The strand that holds the views of the reducers of the task.
+   */
+  strand* get_strand () const { return task_strand; }
+
+  /**
+   * \param [in] st The strand that holds the views of the reducers.
+   */
+  void set_strand (strand* st) { task_strand = st; }
+
   /**
    * \param [in] nwait Number of waiters to receive notification
    */
   void reset_completion (const unsigned int& nwait = 1) {
     if (attr.get_nested ()) testing_compl.reset (nwait);
     else waiting_compl.reset (nwait);
+    notifier = NULL;
     PFUNC_EXCEPT_PTR_CLEAR()
   }
 
   /**
-   * Run the work function 
+   * \return true if the group of this task has been cancelled.
+   */
+  bool is_cancelled () const { return (NULL != grp && grp->is_cancelled ()); }
+
+  /**
+   * Run the work function. If the group has been cancelled before the task
+   * could start, the work function is skipped; the task is still notified
+   * as usual.
    */
   void run ()  { 
     PFUNC_START_TRY_BLOCK()
-    (*func)(); 
+    if (!is_cancelled ()) (*func)(); 
     PFUNC_END_TRY_BLOCK()
     PFUNC_CATCH_AND_STORE(task,run)
   }
@@ -117,6 +150,7 @@ struct task : public no_copy {
     PFUNC_CHECK_AND_RETHROW()
 
     PFUNC_START_TRY_BLOCK()
+    taskmgr.record_wait (this);
     if (attr.get_nested ()) {
       taskmgr.progress_wait (testing_compl);
     } else {
@@ -157,12 +191,77 @@ struct task : public no_copy {
     PFUNC_CHECK_AND_RETHROW()
 
     PFUNC_START_TRY_BLOCK()
+    /**
+     * Signal the notifier, if any; no one can attach to us after this. This
+     * has to be done before the events are notified as the waiters are free
+     * to destroy the task once the events are notified.
+     */
+    completion_notifier* my_notifier = static_cast<completion_notifier*>
+                  (pfunc_fetch_and_store_ptr (&notifier, notifier_done ()));
+    if (NULL != my_notifier) my_notifier->signal (notifier_index);
+
+    /**
+     * The join counter is signalled (and the hook called) after the events,
+     * as the one waiting on it does not wait on the events; the task may be
+     * gone right after.
+     */
+    join_counter* my_joiner = joiner;
+    completion_hook* my_hook = hook;
+    joiner = NULL;
+    hook = NULL;
+
     if (attr.get_nested()) testing_compl.notify ();
     else waiting_compl.notify();
+
+    if (NULL != my_joiner) my_joiner->signal ();
+    if (NULL != my_hook) my_hook->task_completed ();
     PFUNC_END_TRY_BLOCK()
     PFUNC_CATCH_AND_RETHROW(task,run)
   }
 
+  /**
+   * Asks the task to signal the join counter once it has completed. Has to
+   * be called before the task is spawned.
+   *
+   * \param [in,out] counter The join counter to be signalled.
+   */
+  void set_join_counter (join_counter* counter) { joiner = counter; }
+
+  /**
+   * Asks the task to call the hook once it has completed. Has to be called
+   * before the task is spawned.
+   *
+   * \param [in,out] completed The hook to be called.
+   */
+  void set_completion_hook (completion_hook* completed) { hook = completed; }
+
+  /**
+   * Asks the task to signal the notifier on its completion. If the task has
+   * already completed, the notifier is signalled right away.
+   *
+   * \param [in,out] cnotifier The notifier to be signalled.
+   * \param [in] index The index of this task for the notifier.
+   */
+  void attach_notifier (completion_notifier* cnotifier, 
+                        const unsigned int& index) {
+    notifier_index = index;
+    if (NULL != pfunc_compare_and_swap_ptr (&notifier, cnotifier, NULL))
+      cnotifier->signal (index);
+  }
+
+  /**
+   * Takes back the notifier that was given in attach_notifier.
+   *
+   * \param [in] cnotifier The notifier that was attached.
+   * \return true if the notifier was detached before being signalled.
+   * \return false if the task has (or is about to) signal the notifier.
+   */
+  bool detach_notifier (completion_notifier* cnotifier) {
+    return (cnotifier == pfunc_compare_and_swap_ptr (&notifier, 
+                                                     NULL, 
+                                                     cnotifier));
+  }
+
   /**
    * Execute a barrier across all the tasks in this task's group.
    *
@@ -171,7 +270,7 @@ struct task : public no_copy {
   template <typename TaskManager>
   void barrier (TaskManager& taskmgr)   { 
     PFUNC_START_TRY_BLOCK()
-    grp->barrier(taskmgr); 
+    grp->barrier(taskmgr, grank); 
     PFUNC_END_TRY_BLOCK()
     PFUNC_CATCH_AND_RETHROW(task,run)
   }
@@ -182,7 +281,12 @@ struct task : public no_copy {
   task ()  : grp (NULL),
              gsize (0),
              grank (0),
-             func (NULL)
+             func (NULL),
+             notifier (NULL),
+             notifier_index (0),
+             joiner (NULL),
+             hook (NULL),
+             task_strand (NULL)
              PFUNC_EXCEPT_PTR_INIT() {}
 
   /**
@@ -197,7 +301,12 @@ struct task : public no_copy {
                  grp (grp),
                  gsize (0),
                  grank (0),
-                 func (NULL)
+                 func (NULL),
+                 notifier (NULL),
+                 notifier_index (0),
+                 joiner (NULL),
+                 hook (NULL),
+                 task_strand (NULL)
                  PFUNC_EXCEPT_PTR_INIT() {}
 
   /** 
@@ -230,6 +339,54 @@ struct task : public no_copy {
     grank = other.grank;
   }
 }; /* task */
+
+/**
+ * \return The task itself; lets wait_any work with sets of tasks.
+ */
+template <typename Task>
+Task& task_of (Task& tsk) { return tsk; }
+
+/**
+ * \return The task being pointed to; lets wait_any work with sets of 
+ * pointers to tasks.
+ */
+template <typename Task>
+Task& task_of (Task* tsk) { return *tsk; }
+
+/**
+ * Waits for the first of the given tasks to complete and returns its index.
+ * \see pfunc::wait_any
+ *
+ * \param [in] taskmgr The task manager that is running the tasks.
+ * \param [in] first First of the tasks to be waited on.
+ * \param [in] last End marker for the tasks to be waited on (true last+1).
+ * \return Index of the task that completed first (0 if the set is empty).
+ */
+template <typename TaskManager, typename ForwardIterator>
+unsigned int wait_any (TaskManager& taskmgr,
+                       ForwardIterator first,
+                       ForwardIterator last) {
+  if (first == last) return 0;
+
+  completion_notifier notifier (task_of (*first).get_attr ().get_nested ());
+
+  unsigned int count = 0;
+  for (ForwardIterator iter = first; iter != last; ++iter, ++count) 
+    task_of (*iter).attach_notifier (&notifier, count);
+
+  const unsigned int index = notifier.wait (taskmgr);
+
+  /* Take back the notifier; those that we cannot are about to signal */
+  unsigned int num_signals = 0;
+  for (ForwardIterator iter = first; iter != last; ++iter) 
+    if (!task_of (*iter).detach_notifier (&notifier)) ++num_signals;
+  notifier.drain (num_signals);
+
+  std::advance (first, index);
+  task_of (*first).wait (taskmgr);
+
+  return index;
+}
   
 } /* namespace detail */ } /* namespace pfunc */
 
@@ -0,0 +1,389 @@
+#ifndef PFUNC_TASK_GRAPH_HPP
+#define PFUNC_TASK_GRAPH_HPP
+
+/**
+ * \file task_graph.hpp
+ * \brief Implementation of dependency driven execution of task graphs
+ * \author Prabhanjan Kambadur
+ *
+ * A task_graph is a directed acyclic graph whose nodes are function objects
+ * and whose edges are dependencies --- an edge (u,v) means that v can only be
+ * run after u has completed. Nodes and edges are added first and the graph
+ * is then run as many times as needed:
+ *
+ *   pfunc::task_graph<generator_type, my_node> graph;
+ *   const unsigned int u = graph.add_node (my_node (...));
+ *   const unsigned int v = graph.add_node (my_node (...));
+ *   graph.add_edge (u, v);
+ *   if (!graph.run (taskmgr)) ... the edges form a cycle ...
+ *
+ * No thread waits for the predecessors of a node. Every node carries a count
+ * of its unfinished predecessors; whoever brings the count of a node down to
+ * zero runs the node itself or, if it already has other work, spawns it off
+ * into its own task queue where it can be stolen. The edges are stored in
+ * compressed sparse row form (one offset per node and one target per edge),
+ * so graphs with millions of nodes are cheap to hold and to walk.
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance. The library instance
+ *                    must use pfunc::use_default for the Functor!
+ * NodeFunction: The type of the function object stored at each node. It has
+ *               to be copy constructible and define void operator() ().
+ *
+ * NOTE: The node functions must not throw; a node that does not complete
+ * never releases its successors.
+ */
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+#include <pfunc/pfunc.hpp>
+#include <pfunc/mutex.hpp>
+
+namespace pfunc {
+
+template <typename PFuncInstanceType /*type of PFunc instantiated*/,
+          typename NodeFunction /*type of the function at each node*/>
+struct task_graph : public detail::no_copy {
+  public:
+  typedef typename PFuncInstanceType::taskmgr TaskMgrType;
+  typedef typename PFuncInstanceType::task TaskType;
+  typedef typename PFuncInstanceType::attribute AttributeType;
+  typedef unsigned int node_type; /**< Nodes are numbered from 0 */
+
+  private:
+  /**
+   * Executes a stack of nodes that are ready to run. Runners are recycled
+   * across spills and across runs of the graph; so, the number of runners
+   * ever created is bounded by the number of runners that are active at
+   * any one time.
+   */
+  struct runner : public pfunc::virtual_functor {
+    task_graph& graph; /**< The graph whose nodes are run */
+    TaskType task; /**< The task that runs this runner */
+    std::vector<node_type> ready; /**< Nodes that are ready to run */
+    bool spawned; /**< Whether task has to be reclaimed before reuse */
+
+    /**
+     * Constructor
+     *
+     * \param [in] graph The graph whose nodes are run.
+     */
+    runner (task_graph& graph) : graph (graph), spawned (false) {}
+
+    /**
+     * Runs the ready nodes, newest first, till there are none left.
+     */
+    void operator() (void) {
+      while (!ready.empty ()) {
+        const node_type node = ready.back ();
+        ready.pop_back ();
+        graph.execute (node, *this);
+      }
+      graph.retire (this);
+    }
+  };
+
+  static const unsigned int PFUNC_RUNNERS_PER_THREAD = 4; /**< Active cap */
+
+  std::vector<NodeFunction> functions; /**< Function of each node */
+  std::vector<std::pair<node_type, node_type> > edges; /**< As added */
+  std::vector<unsigned int> edge_offsets; /**< CSR offsets; one per node+1 */
+  std::vector<node_type> edge_targets; /**< CSR targets; one per edge */
+  std::vector<int> in_degree; /**< Number of predecessors of each node */
+  std::vector<node_type> sources; /**< Nodes without any predecessors */
+  bool finalized; /**< Whether the CSR form reflects all the edges */
+  bool acyclic; /**< Whether the edges are free of cycles */
+
+  std::vector<int> pending; /**< Unfinished predecessors in this run */
+  ALIGN64 volatile int num_remaining; /**< Nodes yet to run in this run */
+  ALIGN64 volatile int num_active; /**< Runners that have ready nodes */
+  int max_active; /**< Runners beyond this do not spill their nodes */
+  std::vector<runner*> all_runners; /**< Every runner ever created */
+  std::vector<runner*> idle_runners; /**< Runners that can be recycled */
+  pfunc::mutex runner_lock; /**< Protects all_runners and idle_runners */
+  TaskMgrType* taskmgr; /**< Task manager for the current run */
+  AttributeType attr; /**< Attributes of the runners of the current run */
+  detail::completion_notifier* notifier; /**< Signalled by the last node */
+
+  /**
+   * Builds the CSR form of the edges, the in-degrees and the sources.
+   */
+  void finalize () {
+    const size_t num_nodes = functions.size ();
+    edge_offsets.assign (num_nodes+1, 0);
+    in_degree.assign (num_nodes, 0);
+    for (size_t i=0; i<edges.size (); ++i) {
+      ++edge_offsets[edges[i].first+1];
+      ++in_degree[edges[i].second];
+    }
+    for (size_t i=0; i<num_nodes; ++i) edge_offsets[i+1] += edge_offsets[i];
+
+    /** Bucket the targets by their source; edge_offsets is used as cursor */
+    edge_targets.resize (edges.size ());
+    for (size_t i=0; i<edges.size (); ++i)
+      edge_targets[edge_offsets[edges[i].first]++] = edges[i].second;
+    for (size_t i=num_nodes; i>0; --i) edge_offsets[i] = edge_offsets[i-1];
+    edge_offsets[0] = 0;
+
+    sources.clear ();
+    for (size_t i=0; i<num_nodes; ++i)
+      if (0 == in_degree[i]) sources.push_back (static_cast<node_type>(i));
+
+    acyclic = is_acyclic ();
+    finalized = true;
+  }
+
+  /**
+   * \return true if every node is reachable in topological order.
+   */
+  bool is_acyclic () const {
+    std::vector<int> count (in_degree);
+    std::vector<node_type> stack (sources);
+    size_t num_visited = 0;
+    while (!stack.empty ()) {
+      const node_type node = stack.back ();
+      stack.pop_back ();
+      ++num_visited;
+      for (unsigned int i=edge_offsets[node]; i<edge_offsets[node+1]; ++i)
+        if (0 == --count[edge_targets[i]]) stack.push_back (edge_targets[i]);
+    }
+    return (num_visited == functions.size ());
+  }
+
+  /**
+   * Gets hold of a runner to spawn. Runners that have been retired are
+   * recycled if their tasks have completed.
+   *
+   * \param [in] force Whether to ignore the cap on the active runners.
+   * \return A runner with no ready nodes or NULL if there are too many
+   *         active runners.
+   */
+  runner* acquire_runner (const bool& force) {
+    runner* new_runner = NULL;
+    runner_lock.lock ();
+    if (force || num_active < max_active) {
+      for (size_t i=idle_runners.size (); i>0; --i) {
+        runner* candidate = idle_runners[i-1];
+        if (!candidate->spawned || candidate->task.test (*taskmgr)) {
+          candidate->spawned = false;
+          idle_runners[i-1] = idle_runners.back ();
+          idle_runners.pop_back ();
+          new_runner = candidate;
+          break;
+        }
+      }
+      if (NULL == new_runner) {
+        new_runner = new runner (*this);
+        all_runners.push_back (new_runner);
+      }
+      pfunc_fetch_and_add_32 (&num_active, 1);
+    }
+    runner_lock.unlock ();
+    return new_runner;
+  }
+
+  /**
+   * Called by a runner once it has run out of ready nodes. The runner must
+   * not be touched after this as it might be recycled right away.
+   *
+   * \param [in] done The runner that has run out of ready nodes.
+   */
+  void retire (runner* done) {
+    runner_lock.lock ();
+    idle_runners.push_back (done);
+    pfunc_fetch_and_add_32 (&num_active, -1);
+    runner_lock.unlock ();
+  }
+
+  /**
+   * Spawns the given runner into the task queue of the calling thread.
+   *
+   * \param [in,out] ready_runner The runner to spawn.
+   */
+  void launch (runner* ready_runner) {
+    ready_runner->spawned = true;
+    pfunc::spawn (*taskmgr, ready_runner->task, attr, *ready_runner);
+  }
+
+  /**
+   * Runs a node and releases its successors. Successors whose count drops
+   * to zero are pushed on to the runner's stack; if the runner ends up with
+   * more than one ready node and there are not too many runners about, half
+   * of the ready nodes (the oldest ones) are handed off to a new runner.
+   *
+   * \param [in] node The node to run.
+   * \param [in,out] current The runner that is running the node.
+   */
+  void execute (const node_type& node, runner& current) {
+    functions[node] ();
+
+    for (unsigned int i=edge_offsets[node]; i<edge_offsets[node+1]; ++i) {
+      const node_type successor = edge_targets[i];
+      if (1 == pfunc_fetch_and_add_32 (&pending[successor], -1))
+        current.ready.push_back (successor);
+    }
+
+    if (1 < current.ready.size () && num_active < max_active) {
+      runner* spill = acquire_runner (false);
+      if (NULL != spill) {
+        const size_t half = current.ready.size ()/2;
+        spill->ready.assign (current.ready.begin (),
+                             current.ready.begin ()+half);
+        current.ready.erase (current.ready.begin (),
+                             current.ready.begin ()+half);
+        launch (spill);
+      }
+    }
+
+    /**
+     * All the spills of a node happen before it is counted; so, once the
+     * last node is counted, no more runners are launched.
+     */
+    if (1 == pfunc_fetch_and_add_32 (&num_remaining, -1))
+      notifier->signal (0);
+  }
+
+  public:
+  /**
+   * Constructor
+   */
+  task_graph () : finalized (true),
+                  acyclic (true),
+                  num_remaining (0),
+                  num_active (0),
+                  max_active (0),
+                  taskmgr (NULL),
+                  notifier (NULL) {
+    edge_offsets.push_back (0);
+  }
+
+  /**
+   * Destructor. Reclaims the runners.
+   */
+  ~task_graph () {
+    for (size_t i=0; i<all_runners.size (); ++i) delete all_runners[i];
+  }
+
+  /**
+   * Reserves space for the given number of nodes and edges.
+   *
+   * \param [in] num_nodes The expected number of nodes.
+   * \param [in] num_edges The expected number of edges.
+   */
+  void reserve (const size_t& num_nodes, const size_t& num_edges) {
+    functions.reserve (num_nodes);
+    edges.reserve (num_edges);
+  }
+
+  /**
+   * Adds a node to the graph.
+   *
+   * \param [in] func The function to run at the node.
+   * \return The number of the node, which is the number of nodes that were
+   *         added before it.
+   */
+  node_type add_node (const NodeFunction& func) {
+    functions.push_back (func);
+    finalized = false;
+    return static_cast<node_type>(functions.size ()-1);
+  }
+
+  /**
+   * Adds an edge to the graph. The edge must not close a cycle; if it does,
+   * run() refuses to run the graph.
+   *
+   * \param [in] source The node that has to run first.
+   * \param [in] target The node that has to wait for source.
+   */
+  void add_edge (const node_type& source, const node_type& target) {
+    assert (source < functions.size () && target < functions.size ());
+    edges.push_back (std::make_pair (source, target));
+    finalized = false;
+  }
+
+  /**
+   * \return The number of nodes in the graph.
+   */
+  size_t num_nodes () const { return functions.size (); }
+
+  /**
+   * \return The number of edges in the graph.
+   */
+  size_t num_edges () const { return edges.size (); }
+
+  /**
+   * \param [in] node The node whose function is required.
+   * \return The function stored at the node.
+   */
+  NodeFunction& get_node (const node_type& node) { return functions[node]; }
+
+  /**
+   * \return true if the edges do not form a cycle. The check is done once
+   *         after nodes or edges have been added.
+   */
+  bool is_dag () {
+    if (!finalized) finalize ();
+    return acyclic;
+  }
+
+  /**
+   * Runs every node of the graph once, respecting the edges, and returns
+   * once all of them have run. A graph can be run any number of times, but
+   * not concurrently with itself or with add_node/add_edge.
+   *
+   * \param [in,out] taskmgr The task manager to run the nodes with.
+   * \param [in] attr Attributes with which to spawn the nodes. When run() is
+   *                  called from within a task, the attributes have to be
+   *                  nested so that the waiting thread keeps working.
+   * \return false if the edges form a cycle, in which case no node is run
+   *         (the nodes on the cycle could never be released); true otherwise.
+   */
+  bool run (TaskMgrType& taskmgr,
+            const AttributeType& attr = AttributeType (false /*nested*/)) {
+    if (!is_dag ()) return false;
+    if (functions.empty ()) return true;
+
+    this->taskmgr = &taskmgr;
+    this->attr = attr;
+    this->attr.set_grouped (false);
+    max_active = static_cast<int>(PFUNC_RUNNERS_PER_THREAD*
+                                  (taskmgr.get_num_threads ()+1));
+    pending = in_degree;
+    num_remaining = static_cast<int>(functions.size ());
+
+    detail::completion_notifier done (attr.get_nested ());
+    notifier = &done;
+    pfunc_mem_fence ();
+
+    /** Deal the sources out to as many runners as we are allowed */
+    const size_t num_initial =
+      std::min (sources.size (), static_cast<size_t>(max_active));
+    for (size_t i=0; i<num_initial; ++i) {
+      runner* initial = acquire_runner (true);
+      initial->ready.assign
+        (sources.begin ()+(i*sources.size ())/num_initial,
+         sources.begin ()+((i+1)*sources.size ())/num_initial);
+      launch (initial);
+    }
+
+    done.wait (taskmgr);
+    done.drain (1);
+
+    /** Every runner is done or about to be; reclaim all of them */
+    for (size_t i=0; i<all_runners.size (); ++i) {
+      if (all_runners[i]->spawned) {
+        all_runners[i]->task.wait (taskmgr);
+        all_runners[i]->spawned = false;
+      }
+    }
+    idle_runners = all_runners;
+    num_active = 0;
+    notifier = NULL;
+    return true;
+  }
+};
+
+} /* namespace pfunc */
+
+#endif // PFUNC_TASK_GRAPH_HPP
@@ -5,6 +5,7 @@
 #include <pfunc/environ.hpp>
 #include <pfunc/pfunc_atomics.h>
 #include <pfunc/mutex.hpp>
+#include <pfunc/queue_lock.hpp>
 
 #if PFUNC_HAVE_ERRNO_H == 1
 #include <errno.h>
@@ -31,10 +32,15 @@ namespace pfunc {
     /**
      * Template class whose specializations give us the different scheduling
      * policy based task queues. SchedPolicyType is one of the schedS 
-     * specializations and ValueType is always a pointer to a task. 
+     * specializations and ValueType is always a pointer to a task. LockType
+     * is the lock that guards each of the task queues; it has to provide 
+     * lock(), trylock() and unlock(). pfunc::mutex is the default and
+     * pfunc::ticket_lock and pfunc::mcs_lock (see queue_lock.hpp) scale 
+     * better when many threads steal from the same queue.
      */
     template <typename PolicyName, 
-              typename ValueType>
+              typename ValueType,
+              typename LockType = mutex>
     struct task_queue_set {
       typedef errorS queue_index_type; /**< Declare error if no specialization is found */
       typedef errorS queue_type; /**< Declare error if no specialization is found */
@@ -43,10 +49,11 @@ namespace pfunc {
     /**
      * Data stored in a task_queue_set. QueueType is one of schedS.
      */
-    template <typename QueueType>
+    template <typename QueueType, typename LockType = mutex>
     struct task_queue_set_data {
+      typedef LockType lock_type; /**< Type of the lock */
       ALIGN128 QueueType queue; /**< Internal queue */
-      ALIGN128 mutex lock; /**< Lock associated with this internal queue */
+      ALIGN128 lock_type lock; /**< Lock associated with this internal queue */
     };
   } /* namespace detail */ 
 } /* namespace pfunc */
@@ -0,0 +1,249 @@
+#ifndef PFUNC_TASK_RECORDING_HPP
+#define PFUNC_TASK_RECORDING_HPP
+
+/**
+ * \file task_recording.hpp
+ * \brief Implementation of capture and replay of spawn/wait sequences
+ * \author Prabhanjan Kambadur
+ *
+ * Iterative codes (for example, conjugate gradient) spawn and wait on the
+ * same set of tasks in every iteration. A task_recording captures the tasks
+ * spawned and waited on by one thread during one iteration and then replays
+ * them in the same order for the remaining iterations. The recording owns
+ * the tasks and the attributes; so, a replay does not construct anything
+ * and only pays for putting the tasks in the queues and waiting on them:
+ *
+ *   pfunc::task_recording<generator_type> iteration;
+ *   iteration.begin_capture (taskmgr);
+ *   ... spawn and wait on the tasks of the first iteration as usual ...
+ *   iteration.end_capture ();
+ *   for (int i=1; i<num_iterations; ++i) iteration.replay (true);
+ *
+ * The function objects are not copied; the recording holds on to the
+ * function objects that were spawned. To change the arguments between
+ * replays, either update the state of those function objects or point a
+ * recorded task at another function object with rebind().
+ *
+ * Only the spawns and the waits made by the capturing thread are recorded.
+ * Tasks spawned by the recorded tasks are part of their work and are
+ * spawned again when the recorded tasks run.
+ *
+ * Types:
+ * PFuncInstanceType: The type of PFunc library instance. The library instance
+ *                    must use pfunc::use_default for the Functor!
+ */
+#include <vector>
+#include <map>
+#include <pfunc/pfunc.hpp>
+
+namespace pfunc {
+
+template <typename PFuncInstanceType /*type of PFunc instantiated*/>
+struct task_recording :
+  public detail::spawn_recorder<typename PFuncInstanceType::task>,
+  public detail::no_copy {
+  public:
+  typedef typename PFuncInstanceType::taskmgr TaskMgrType;
+  typedef typename PFuncInstanceType::task TaskType;
+  typedef typename PFuncInstanceType::attribute AttributeType;
+  typedef typename PFuncInstanceType::group GroupType;
+  typedef typename PFuncInstanceType::functor FunctorType;
+
+  private:
+  /**
+   * A task that was spawned during the capture. While capturing, this runs
+   * in place of the spawned function object and notes down the task queue
+   * of the thread that ran it.
+   */
+  struct recorded_task : public pfunc::virtual_functor {
+    TaskMgrType& taskmgr; /**< Task manager that the task was spawned on */
+    TaskType task; /**< Task used for the replays */
+    AttributeType attr; /**< Attributes that the task was spawned with */
+    AttributeType placed_attr; /**< attr with the queue that ran the task */
+    GroupType* grp; /**< Group that the task was spawned in */
+    FunctorType* func; /**< Function object that the task runs */
+    unsigned int queue_number; /**< Queue of the thread that ran the task */
+
+    /**
+     * Constructor
+     *
+     * \param [in] taskmgr The task manager that the task was spawned on.
+     * \param [in] attr The attributes that the task was spawned with.
+     * \param [in] grp The group that the task was spawned in.
+     * \param [in] func The function object that the task runs.
+     */
+    recorded_task (TaskMgrType& taskmgr,
+                   const AttributeType& attr,
+                   GroupType& grp,
+                   FunctorType& func) :
+      taskmgr (taskmgr), attr (attr), placed_attr (attr), grp (&grp),
+      func (&func), queue_number (detail::QUEUE_CURRENT_THREAD) {}
+
+    /**
+     * Runs the function object, noting down who ran it.
+     */
+    void operator() (void) {
+      queue_number = taskmgr.current_queue_number ();
+      (*func) ();
+    }
+  };
+
+  /**
+   * One step of the recorded sequence.
+   */
+  struct step {
+    bool is_wait; /**< Whether this step is a spawn or a wait */
+    size_t index; /**< The recorded task that is spawned or waited on */
+
+    step (const bool& is_wait, const size_t& index) : is_wait (is_wait),
+                                                      index (index) {}
+  };
+
+  TaskMgrType* taskmgr; /**< Task manager to replay on */
+  std::vector<recorded_task*> tasks; /**< Recorded tasks in spawn order */
+  std::vector<step> steps; /**< Spawns and waits in the order made */
+  std::vector<size_t> unwaited; /**< Tasks that were not waited on */
+  std::map<const TaskType*, size_t> spawned; /**< Used while capturing */
+
+  public:
+  /**
+   * Constructor
+   */
+  task_recording () : taskmgr (NULL) {}
+
+  /**
+   * Destructor
+   */
+  ~task_recording () { clear (); }
+
+  /**
+   * Throws away whatever has been recorded.
+   */
+  void clear () {
+    for (size_t i=0; i<tasks.size (); ++i) delete tasks[i];
+    tasks.clear ();
+    steps.clear ();
+    unwaited.clear ();
+    spawned.clear ();
+  }
+
+  /**
+   * Starts recording the spawns and the waits made by the calling thread.
+   * Anything recorded earlier is thrown away.
+   *
+   * \param [in,out] taskmgr The task manager to capture on.
+   */
+  void begin_capture (TaskMgrType& taskmgr) {
+    clear ();
+    this->taskmgr = &taskmgr;
+    taskmgr.begin_capture (*this);
+  }
+
+  /**
+   * Stops recording. All the tasks spawned during the capture must have
+   * completed --- typically, they have all been waited on --- since the
+   * replays refer to the queues that they ran on.
+   */
+  void end_capture () {
+    taskmgr->end_capture ();
+    spawned.clear ();
+
+    std::vector<bool> waited (tasks.size (), false);
+    for (size_t i=0; i<steps.size (); ++i)
+      if (steps[i].is_wait) waited[steps[i].index] = true;
+
+    for (size_t i=0; i<tasks.size (); ++i) {
+      if (!waited[i]) unwaited.push_back (i);
+      tasks[i]->placed_attr.set_queue_number (tasks[i]->queue_number);
+    }
+  }
+
+  /**
+   * Spawns and waits on the recorded tasks in the order of the capture, and
+   * then waits on any recorded task that was not waited on.
+   *
+   * \param [in] same_placement Whether to spawn each task into the queue
+   *                            that it ran on during the capture rather
+   *                            than into the queue it was spawned into.
+   */
+  void replay (const bool& same_placement = false) {
+    for (size_t i=0; i<steps.size (); ++i) {
+      recorded_task& current = *tasks[steps[i].index];
+      if (steps[i].is_wait) {
+        pfunc::wait (*taskmgr, current.task);
+      } else {
+        pfunc::spawn (*taskmgr,
+                      current.task,
+                      same_placement ? current.placed_attr : current.attr,
+                      *current.grp,
+                      *current.func);
+      }
+    }
+    for (size_t i=0; i<unwaited.size (); ++i)
+      pfunc::wait (*taskmgr, tasks[unwaited[i]]->task);
+  }
+
+  /**
+   * \return The number of tasks recorded.
+   */
+  size_t size () const { return tasks.size (); }
+
+  /**
+   * \param [in] index The position of the task in the order of the spawns.
+   * \return The function object run by the recorded task.
+   */
+  FunctorType& get_function (const size_t& index) {
+    return *(tasks[index]->func);
+  }
+
+  /**
+   * Makes a recorded task run another function object from the next replay
+   * on. The function object is not copied.
+   *
+   * \param [in] index The position of the task in the order of the spawns.
+   * \param [in] func The function object to run.
+   */
+  void rebind (const size_t& index, FunctorType& func) {
+    tasks[index]->func = &func;
+  }
+
+  /**
+   * Called by the task manager for every spawn made while capturing.
+   *
+   * \param [in] new_task The task being spawned.
+   * \param [in] new_attr The attributes of the task.
+   * \param [in] new_group The group of the task.
+   * \param [in] new_work The function object of the task.
+   * \return The recorded task, which runs new_work.
+   */
+  FunctorType* record_spawn (TaskType& new_task,
+                             const AttributeType& new_attr,
+                             GroupType& new_group,
+                             FunctorType& new_work) {
+    recorded_task* recorded =
+      new recorded_task (*taskmgr, new_attr, new_group, new_work);
+    spawned[&new_task] = tasks.size ();
+    steps.push_back (step (false, tasks.size ()));
+    tasks.push_back (recorded);
+    return recorded;
+  }
+
+  /**
+   * Called by the task manager for every wait made while capturing. Waits
+   * on tasks that were not spawned during the capture are ignored.
+   *
+   * \param [in] waited_task The task being waited on.
+   */
+  void record_wait (const TaskType& waited_task) {
+    typename std::map<const TaskType*, size_t>::iterator
+      position = spawned.find (&waited_task);
+    if (spawned.end () != position) {
+      steps.push_back (step (true, position->second));
+      spawned.erase (position);
+    }
+  }
+};
+
+} /* namespace pfunc */
+
+#endif // PFUNC_TASK_RECORDING_HPP
@@ -29,6 +29,7 @@
 #include <pfunc/group.hpp>
 #include <pfunc/attribute.hpp>
 #include <pfunc/task.hpp>
+#include <pfunc/strand.hpp>
 #include <pfunc/trampolines.hpp>
 #include <pfunc/task_queue_set.hpp>
 #include <pfunc/predicate.hpp>
@@ -46,11 +47,52 @@
  */ 
 namespace pfunc { namespace detail {
 
+/**
+ * \brief Interface through which the task manager reports the spawns and
+ * the waits of the capturing thread while a capture is on.
+ *
+ * \param Task The type of the task to use.
+ */
+template <typename Task>
+struct spawn_recorder {
+  typedef typename Task::attribute attribute; /**< Type of the attribute */
+  typedef typename Task::functor functor; /**< Type of the functor */
+
+  /**
+   * Virtual destructor
+   */
+  virtual ~spawn_recorder () {}
+
+  /**
+   * Records a spawn.
+   *
+   * \param [in] new_task The task being spawned.
+   * \param [in] new_attr The attributes of the task.
+   * \param [in] new_group The group of the task.
+   * \param [in] new_work The function object of the task.
+   * \return The function object that the task should run instead.
+   */
+  virtual functor* record_spawn (Task& new_task,
+                                 const attribute& new_attr,
+                                 group& new_group,
+                                 functor& new_work) = 0;
+
+  /**
+   * Records a wait.
+   *
+   * \param [in] waited_task The task being waited on.
+   */
+  virtual void record_wait (const Task& waited_task) = 0;
+};
+
 /** 
  * \brief Main class that implements the tasking aspect
  *
  * @param SchedPolicyName The scheduling policy to use.
  * @param Task The type of the task to use.
+ * @param QueueLock The type of the lock guarding each task queue. Defaults 
+ *                  to pfunc::mutex; pfunc::ticket_lock and pfunc::mcs_lock
+ *                  hold up better when there are many thieves.
  *
  * This is the main struct that implements the functionality provided
  * in pfunc tool kit. Of the many things implemented in this class,
@@ -61,15 +103,20 @@ namespace pfunc { namespace detail {
  *
  */    
 template <typename SchedPolicyName,
-          typename Task>
+          typename Task,
+          typename QueueLock = mutex>
 struct taskmgr : public taskmgr_virtual_base  {
   typedef Task task; /**< type of task */
   typedef typename task::functor functor; /**< Type of the functor */
   typedef SchedPolicyName sched_policy_name; /**< Type of scheduler in use */
-  typedef task_queue_set<sched_policy_name, task> queue_type; /**< scheduler */
+  typedef QueueLock queue_lock_type; /**< Lock guarding each task queue */
+  typedef task_queue_set<sched_policy_name, 
+                         task, 
+                         queue_lock_type> queue_type; /**< scheduler */
   typedef typename task::attribute attribute; /**< To know the attribute */
   typedef typename attribute::priority_type priority_type; /**< To know what priority exit_job */
   typedef thread::native_thread_id_type native_thread_id_type; /**< used for storage */
+  typedef spawn_recorder<task> recorder_type; /**< Used to capture spawns */
 
   typedef regular_predicate_pair<sched_policy_name, task> regular_predicate;
   typedef waiting_predicate_pair<sched_policy_name, task> waiting_predicate;
@@ -109,6 +156,9 @@ struct taskmgr : public taskmgr_virtual_base  {
   };
   aligned_bool* thread_state; /**< Denote thread cancellations */
   unsigned int task_max_attempts; /**< Number of attempts before backoff */
+  recorder_type* volatile recorder; /**< Non-NULL while capturing */
+  unsigned int recorder_thread; /**< Thread whose spawns are captured */
+  strand_set* volatile strands; /**< Non-NULL once a reducer is created */
   PFUNC_DEFINE_EXCEPT_PTR() /**< Place to store the exception */
 
   /**
@@ -130,6 +180,28 @@ struct taskmgr : public taskmgr_virtual_base  {
     bool operator ()() const { return compl_event.test(); }
   };
 
+  /**
+   * Runs a task in its strand, so that the reducers that it updates see its
+   * views. The views are folded back once the task and its children have
+   * completed. A task spawned before the first reducer was created has no
+   * strand; it runs in none, so that the reducers catch its updates instead
+   * of losing them.
+   *
+   * \param [in,out] my_task The task to run.
+   * \param [in] my_thread_id The ID of the calling thread.
+   */
+  void run_task (task* my_task, const unsigned int& my_thread_id) {
+    strand_set* my_strands = strands;
+    if (NULL == my_strands) {
+      my_task->run ();
+    } else {
+      strand* task_strand = my_task->get_strand ();
+      strand* previous = my_strands->begin_run (my_thread_id, task_strand);
+      my_task->run ();
+      my_strands->end_run (my_thread_id, task_strand, previous);
+    }
+  }
+
   public:
   /**
    * \brief Returns information regarding the current thread.
@@ -209,6 +281,106 @@ struct taskmgr : public taskmgr_virtual_base  {
     return gsize;
   }
 
+  /**
+   * \brief Checks if the group of the calling task has been cancelled.
+   *
+   * \return true if the group of the task being currently executed has been
+   * cancelled; false if it has not been or if the caller is not a task.
+   */
+  bool current_task_cancelled () {
+    bool cancelled = false;
+    PFUNC_START_TRY_BLOCK()
+    const unsigned int my_thread_id = current_thread_id ();
+    if (num_threads != my_thread_id) 
+      cancelled = task_cache[my_thread_id].is_cancelled ();
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CATCH_AND_RETHROW(taskmgr,current_task_cancelled)
+    return cancelled;
+  }
+
+  /**
+   * \brief Returns the task queue of the calling thread.
+   *
+   * \return The number of the task queue that the calling thread (or the
+   * main thread) takes its tasks from.
+   */
+  unsigned int current_queue_number () {
+    unsigned int queue_number;
+    PFUNC_START_TRY_BLOCK()
+    queue_number = (thread_manager.tls_get ())->get_task_queue_number ();
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CATCH_AND_RETHROW(taskmgr,current_queue_number)
+    return queue_number;
+  }
+
+  /**
+   * \brief Starts capturing the spawns and waits made by the calling thread.
+   *
+   * \details
+   * Till end_capture() is called, every task spawned by the calling thread
+   * and every wait on a task made by the calling thread is reported to the
+   * recorder. Spawns and waits made by the other threads (for example, the
+   * ones made by the spawned tasks themselves) are not reported. Only one
+   * capture can be on at a time.
+   *
+   * \param [in,out] new_recorder The recorder to report to.
+   */
+  void begin_capture (recorder_type& new_recorder) {
+    PFUNC_START_TRY_BLOCK()
+    recorder_thread = current_thread_id ();
+    pfunc_mem_fence ();
+    recorder = &new_recorder;
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CATCH_AND_RETHROW(taskmgr,begin_capture)
+  }
+
+  /**
+   * \brief Stops the capture started by begin_capture().
+   */
+  void end_capture () {
+    recorder = NULL;
+    pfunc_mem_fence ();
+  }
+
+  /**
+   * \brief Reports a wait to the recorder if a capture is on.
+   *
+   * \details
+   * Called by the tasks before they are waited on. This function call is 
+   * type UNSAFE for the same reason as spawn_task (void*, void*).
+   *
+   * \param [in] waited_task The task that is being waited on.
+   */
+  void record_wait (void* waited_task) {
+    PFUNC_START_TRY_BLOCK()
+    if (NULL != recorder && recorder_thread == current_thread_id ())
+      recorder->record_wait (*(static_cast<task*>(waited_task)));
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CATCH_AND_RETHROW(taskmgr,record_wait)
+  }
+
+  /**
+   * \brief Returns the strands that hold the views of the reducers.
+   *
+   * \details
+   * The strands are created when the first reducer is created; tasks
+   * spawned before that do not get a strand and cannot use reducers. The
+   * strands are freed along with the task manager (see strand_set).
+   *
+   * \return The strands of this task manager.
+   */
+  strand_set& reducer_strands () {
+    PFUNC_START_TRY_BLOCK()
+    if (NULL == strands) {
+      strand_set* new_strands = new strand_set (num_threads+1/*main*/);
+      if (NULL != pfunc_compare_and_swap_ptr (&strands, new_strands, NULL))
+        delete new_strands;
+    }
+    PFUNC_END_TRY_BLOCK()
+    PFUNC_CATCH_AND_RETHROW(taskmgr,reducer_strands)
+    return *strands;
+  }
+
   /**
    * \brief Executes a barrier accross the group of the currently executing 
    * task (and hence, thread). Most of the details regarding the barrier are 
@@ -283,9 +455,15 @@ struct taskmgr : public taskmgr_virtual_base  {
                    group& new_group,
                    functor& new_work)  {
     PFUNC_START_TRY_BLOCK()
+    functor* work = &new_work;
+    if (NULL != recorder && recorder_thread == current_thread_id ())
+      work = recorder->record_spawn (new_task, new_attr, new_group, new_work);
+
     new_task.set_attr (new_attr);
     new_task.set_group (&new_group);
-    new_task.set_func (&new_work);
+    new_task.set_func (work);
+    new_task.set_strand ((NULL == strands) ? NULL : 
+                         strands->spawn (current_thread_id ()));
     new_task.reset_completion (new_attr.get_num_waiters());
     unsigned int task_queue_number = new_attr.get_queue_number();
 
@@ -405,7 +583,10 @@ struct taskmgr : public taskmgr_virtual_base  {
                       perf_event_values (NULL),
 #endif
                       thread_state (NULL),
-                      task_max_attempts (2000000)
+                      task_max_attempts (2000000),
+                      recorder (NULL),
+                      recorder_thread (0),
+                      strands (NULL)
                       PFUNC_EXCEPT_PTR_INIT() {
     PFUNC_START_TRY_BLOCK()
     /* Allocate memory for threads_per_queue */
@@ -517,6 +698,7 @@ struct taskmgr : public taskmgr_virtual_base  {
     delete [] threads_per_queue;
     delete [] thread_state;
     delete main_thread_attr;
+    delete strands;
 
     PFUNC_EXCEPT_PTR_CLEAR()
     PFUNC_END_TRY_BLOCK()
@@ -650,7 +832,7 @@ struct taskmgr : public taskmgr_virtual_base  {
                                         my_task_queue_number,
                                         regular_predicate(NULL)))) {
       task_cache [my_thread_id].shallow_copy(*my_task); /* Set the cache */
-      my_task->run (); /* Now, lets run the job */
+      run_task (my_task, my_thread_id); /* Now, lets run the job */
       my_task->notify (); /* signal whoever was waiting */
     }
 
@@ -711,7 +893,7 @@ struct taskmgr : public taskmgr_virtual_base  {
         task_cache[my_thread_id].shallow_copy(*my_task);
        
         /* run the task */
-        my_task->run (); 
+        run_task (my_task, my_thread_id);
        
         /* Notify the waiters on the second task */
         my_task->notify ();
@@ -752,7 +934,7 @@ struct taskmgr : public taskmgr_virtual_base  {
     task_cache[my_thread_id].shallow_copy(*my_task);
 
     /* run the task */
-    my_task->run (); 
+    run_task (my_task, my_thread_id);
 
     /* Notify the waiters on the second task */
     my_task->notify ();
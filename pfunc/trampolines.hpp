@@ -11,6 +11,8 @@
  */
 namespace pfunc { namespace detail {
 
+struct strand_set; /* see strand.hpp */
+
 /*************************************************************************/
 /**
  * \brief This strucure is used for dynamic casting purposes ONLY. 
@@ -56,6 +58,25 @@ struct taskmgr_virtual_base {
    */
   virtual void current_task_group_barrier () = 0;
 
+  /**
+   * Returns true if the group of the task being currently executed by the 
+   * calling thread has been cancelled.
+   */
+  virtual bool current_task_cancelled () = 0;
+
+  /**
+   * Reports a wait on the given task if the calling thread is being 
+   * captured. This function call is type UNSAFE as we do not know the type
+   * of the task.
+   */
+  virtual void record_wait (void*) = 0;
+
+  /**
+   * Returns the strands that hold the views of the reducers, creating them
+   * on the first call; till then, spawns do not pay for reducers.
+   */
+  virtual strand_set& reducer_strands () = 0;
+
   /**
    * Executes a task (from own queue or otherwise) while waiting on a task
    * to complete.